@@ -3,3 +3,43 @@
 //
 
 #include "MeshBSA.h"
+#include <bs_archive_writer.hpp>
+
+#include <iostream>
+
+MeshBSA::MeshBSA(std::filesystem::path bsaPath, struct OptimizerSettings settings) {
+    this->bsaPath = std::move(bsaPath);
+    this->settings = std::move(settings);
+    this->estimatedSize = 36; // header
+}
+
+size_t MeshBSA::entrySize(const std::string &path, size_t size) {
+    // file record (16) and, worst case, a folder record (24) and folder name of its own, plus the file name
+    return size + 16 + 24 + (path.size() + 2) * 2;
+}
+
+void MeshBSA::add(const std::string &path, DirectX::Blob data) {
+    estimatedSize += entrySize(path, data.GetBufferSize());
+    files.push_back(File{path, std::move(data)});
+}
+
+bool MeshBSA::save() {
+    bool saved = true;
+    try {
+        // The blobs are added without a copy, they are only released once the archive is written
+        libbsarch::bs_archive_writer writer(libbsarch::bs_archive_writer::format::sse);
+        writer.set_share_data(true);
+        for (const File &file : files) {
+            writer.add_file(file.path, libbsarch::byte_span{static_cast<const uint8_t *>(file.data.GetBufferPointer()),
+                                                            file.data.GetBufferSize()});
+        }
+        writer.save(bsaPath);
+    } catch (const std::exception &e) {
+        std::wcerr << L"Failed to write BSA " << bsaPath << L": " << e.what() << std::endl;
+        saved = false;
+    }
+
+    files.clear();
+    files.shrink_to_fit();
+    return saved;
+}
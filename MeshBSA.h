@@ -3,16 +3,55 @@
 
 #include <filesystem>
 #include <utility>
+#include <vector>
 #include "main.h"
+#include "libs/DirectXTex/DirectXTex.h"
 
+/*!
+ * \brief One Skyrim SE archive being built in memory. Files are kept until save(), which hands them to the native
+ * libbsarch writer without copying them: it hashes them on worker threads, stores identical textures once and writes
+ * the archive in one sequential pass.
+ */
 class MeshBSA {
 private:
+    struct File {
+        std::string path;
+        DirectX::Blob data;
+    };
+
     std::filesystem::path bsaPath;
     struct OptimizerSettings settings;
+    std::vector<File> files;
+    size_t estimatedSize;
 public:
-    explicit MeshBSA(std::filesystem::path& bsaPath, struct OptimizerSettings settings) {
-        this->bsaPath = std::move(bsaPath);
-        this->settings = std::move(settings);
+    // The game reads offsets as signed 32 bits values
+    static constexpr size_t MaxSize = 0x7FFFFFFFu;
+
+    explicit MeshBSA(std::filesystem::path bsaPath, struct OptimizerSettings settings);
+
+    /*!
+     * \brief Upper bound of what adding a file of size bytes at path grows the archive by, records and names included
+     */
+    static size_t entrySize(const std::string &path, size_t size);
+
+    void add(const std::string &path, DirectX::Blob data);
+
+    /*!
+     * \brief Write the archive to bsaPath and release the files
+     * \return False if the archive couldn't be written
+     */
+    bool save();
+
+    [[nodiscard]] size_t size() const {
+        return estimatedSize;
+    }
+
+    [[nodiscard]] size_t count() const {
+        return files.size();
+    }
+
+    [[nodiscard]] const std::filesystem::path &path() const {
+        return bsaPath;
     }
 };
 
@@ -0,0 +1,24 @@
+#include "archive_index.h"
+
+#include <bs_hash.hpp>
+
+#include <string>
+
+ArchiveIndex::Key ArchiveIndex::keyOf(std::string_view path) {
+    const std::string normalized = libbsarch::normalize_path(path);
+    std::string_view folder, file;
+    libbsarch::split_path(normalized, folder, file);
+    return Key{libbsarch::hash_tes4_folder(folder), libbsarch::hash_tes4_file(file)};
+}
+
+void ArchiveIndex::add(const libbsarch::bs_archive_reader &archive) {
+    entries.reserve(entries.size() + archive.files().size());
+    for (const auto &entry : archive.files()) {
+        entries[Key{entry.folder_hash, entry.file_hash}] = Location{&archive, &entry};
+    }
+}
+
+const ArchiveIndex::Location *ArchiveIndex::find(const Key &key) const {
+    const auto it = entries.find(key);
+    return it == entries.end() ? nullptr : &it->second;
+}
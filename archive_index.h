@@ -0,0 +1,62 @@
+#ifndef STO_ARCHIVE_INDEX_H
+#define STO_ARCHIVE_INDEX_H
+
+#include <bs_archive_reader.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+/*!
+ * \brief Every file of every loaded archive, keyed on the (folder hash, file hash) pair the archives already store.
+ * It is built from the records without creating a single path string. Archives added later override earlier ones,
+ * like the load order. A lookup hashes its path once and covers all archives at the same time.
+ * Names aren't compared, so two paths with the same hashes are the same file, as they are for the game.
+ */
+class ArchiveIndex {
+public:
+    struct Key {
+        uint64_t folder;
+        uint64_t file;
+
+        bool operator==(const Key &other) const {
+            return folder == other.folder && file == other.file;
+        }
+    };
+
+    struct Location {
+        const libbsarch::bs_archive_reader *archive;
+        const libbsarch::bs_archive_reader::file_entry *entry;
+    };
+
+    //! \brief Hashes of a path such as textures\\architecture\\wall.dds, case and slashes don't matter
+    static Key keyOf(std::string_view path);
+
+    /*!
+     * \brief Index every file of an open TES4, FO3 or SSE archive, which must outlive the index
+     */
+    void add(const libbsarch::bs_archive_reader &archive);
+
+    //! \return nullptr if no archive contains the file
+    [[nodiscard]] const Location *find(const Key &key) const;
+
+    [[nodiscard]] const Location *find(std::string_view path) const {
+        return find(keyOf(path));
+    }
+
+    [[nodiscard]] size_t size() const {
+        return entries.size();
+    }
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            // Both halves are already well mixed, the multiply keeps folder ^ file collisions apart
+            return static_cast<size_t>(key.folder ^ (key.file * 0x9E3779B97F4A7C15ull));
+        }
+    };
+
+    std::unordered_map<Key, Location, KeyHash> entries;
+};
+
+#endif //STO_ARCHIVE_INDEX_H
@@ -0,0 +1,129 @@
+#include "synthetic.h"
+
+#include <bs_archive_reader.hpp>
+#include <bs_archive_writer.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    const Synthetic::Corpus &corpus() {
+        static const Synthetic::Corpus instance = Synthetic::generateCorpus(256);
+        return instance;
+    }
+
+    std::filesystem::path archivePath(bool compressed) {
+        return std::filesystem::temp_directory_path() / (compressed ? "sto_bench_compressed.bsa" : "sto_bench.bsa");
+    }
+
+    void writeArchive(const std::filesystem::path &path, bool compressed, bool shareData, unsigned threads) {
+        const Synthetic::Corpus &files = corpus();
+        libbsarch::bs_archive_writer writer(libbsarch::bs_archive_writer::format::sse);
+        writer.set_compressed(compressed);
+        writer.set_share_data(shareData);
+        for (size_t i = 0; i < files.paths.size(); i++) {
+            writer.add_file(files.paths[i], libbsarch::byte_span{files.files[i].data(), files.files[i].size()});
+        }
+        writer.save(path, threads);
+    }
+
+    // Written once per process, the read benchmarks only need it to exist. Throws if libbsarch lacks the codec
+    const std::filesystem::path &preparedArchive(bool compressed) {
+        if (compressed) {
+            static const std::filesystem::path packed = [] {
+                writeArchive(archivePath(true), true, false, 0);
+                return archivePath(true);
+            }();
+            return packed;
+        }
+        static const std::filesystem::path plain = [] {
+            writeArchive(archivePath(false), false, false, 0);
+            return archivePath(false);
+        }();
+        return plain;
+    }
+}
+
+static void BM_ArchiveWrite(benchmark::State &state) {
+    const bool compressed = state.range(0) != 0;
+    const auto threads = static_cast<unsigned>(state.range(1));
+    const auto path = std::filesystem::temp_directory_path() / "sto_bench_write.bsa";
+    corpus();
+    for (auto _ : state) {
+        try {
+            writeArchive(path, compressed, true, threads);
+        } catch (const std::exception &e) {
+            state.SkipWithError(e.what());
+            break;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * corpus().bytes));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus().files.size()));
+    std::error_code ignored;
+    std::filesystem::remove(path, ignored);
+}
+BENCHMARK(BM_ArchiveWrite)->ArgNames({"compressed", "threads"})->ArgsProduct({{0, 1}, {1, 0}})
+        ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ArchiveOpen(benchmark::State &state) {
+    std::filesystem::path path;
+    try {
+        path = preparedArchive(state.range(0) != 0);
+    } catch (const std::exception &e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+    for (auto _ : state) {
+        libbsarch::bs_archive_reader reader(path);
+        benchmark::DoNotOptimize(reader.files().size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus().files.size()));
+}
+BENCHMARK(BM_ArchiveOpen)->ArgNames({"compressed"})->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+static void BM_ArchiveFind(benchmark::State &state) {
+    const libbsarch::bs_archive_reader reader(preparedArchive(false));
+    const auto &paths = corpus().paths;
+    for (auto _ : state) {
+        for (const auto &path : paths) {
+            benchmark::DoNotOptimize(reader.find(path));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * paths.size()));
+}
+BENCHMARK(BM_ArchiveFind)->Unit(benchmark::kMicrosecond);
+
+static void BM_ArchiveExtract(benchmark::State &state) {
+    std::filesystem::path path;
+    try {
+        path = preparedArchive(state.range(0) != 0);
+    } catch (const std::exception &e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+    const libbsarch::bs_archive_reader reader(path);
+    const auto threads = static_cast<unsigned>(state.range(1));
+
+    std::vector<const libbsarch::bs_archive_reader::file_entry *> entries;
+    std::vector<std::unique_ptr<uint8_t[]>> buffers(reader.files().size());
+    for (const auto &entry : reader.files()) {
+        buffers[entries.size()].reset(new uint8_t[reader.extracted_size(entry)]);
+        entries.push_back(&entry);
+    }
+    const auto *first = reader.files().data();
+
+    for (auto _ : state) {
+        reader.extract_parallel(entries, [&](const libbsarch::bs_archive_reader::file_entry &entry, uint32_t) {
+            return static_cast<void *>(buffers[&entry - first].get());
+        }, threads);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * corpus().bytes));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * entries.size()));
+}
+BENCHMARK(BM_ArchiveExtract)->ArgNames({"compressed", "threads"})->ArgsProduct({{0, 1}, {1, 0}})
+        ->Unit(benchmark::kMillisecond)->UseRealTime();
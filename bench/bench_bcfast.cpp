@@ -0,0 +1,164 @@
+#include "synthetic.h"
+
+#include "libs/DirectXTex/BCFast.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+/*
+ * DirectXTex's integer block codecs on their own, without the session's gathering and threading. They are the only
+ * part of DirectXTex that builds without the Windows SDK, so these are the texture kernels measured everywhere.
+ */
+
+namespace {
+    constexpr const char *FormatNames[] = {"BC1", "BC3", "BC4", "BC5"};
+    constexpr size_t BlockSizes[] = {8, 16, 8, 16};
+    constexpr int64_t Size = 1024;
+
+    // Every 4x4 block of a synthetic image, 16 RGBA texels each in rows of 4
+    std::vector<uint8_t> blocksOf(bool alpha) {
+        const auto pixels = Synthetic::generateRGBA(Size, Size, alpha);
+        const size_t blocksWide = Size / 4;
+        std::vector<uint8_t> blocks(pixels.size());
+        for (size_t by = 0; by < blocksWide; by++) {
+            for (size_t bx = 0; bx < blocksWide; bx++) {
+                uint8_t *block = blocks.data() + (by * blocksWide + bx) * BCFast::NUM_PIXELS_PER_BLOCK * 4;
+                for (size_t y = 0; y < 4; y++) {
+                    std::memcpy(block + y * 16, pixels.data() + ((by * 4 + y) * Size + bx * 4) * 4, 16);
+                }
+            }
+        }
+        return blocks;
+    }
+
+    // One plane of a channel, 16 bytes per block, as the BC4/BC5 encoders take them
+    std::vector<uint8_t> channelOf(const std::vector<uint8_t> &blocks, size_t channel) {
+        std::vector<uint8_t> plane(blocks.size() / 4);
+        for (size_t i = 0; i < plane.size(); i++) {
+            plane[i] = blocks[i * 4 + channel];
+        }
+        return plane;
+    }
+
+    void encode(size_t format, const std::vector<uint8_t> &blocks, const std::vector<uint8_t> &red,
+                const std::vector<uint8_t> &green, bool exhaustive, uint8_t *out) {
+        const size_t nBlocks = blocks.size() / (BCFast::NUM_PIXELS_PER_BLOCK * 4);
+        switch (format) {
+            case 0:
+                for (size_t i = 0; i < nBlocks; i++) {
+                    BCFast::EncodeBC1(out + i * 8, blocks.data() + i * BCFast::NUM_PIXELS_PER_BLOCK * 4, 128);
+                }
+                break;
+            case 1:
+                for (size_t i = 0; i < nBlocks; i++) {
+                    BCFast::EncodeBC3(out + i * 16, blocks.data() + i * BCFast::NUM_PIXELS_PER_BLOCK * 4);
+                }
+                break;
+            case 2:
+                BCFast::EncodeBC4UBlocks(out, red.data(), nBlocks, exhaustive);
+                break;
+            default:
+                BCFast::EncodeBC5UBlocks(out, red.data(), green.data(), nBlocks, exhaustive);
+                break;
+        }
+    }
+
+    // Decodes every block back to RGBA, channels the format doesn't store are left at zero
+    void decode(size_t format, const uint8_t *encoded, size_t nBlocks, uint8_t *rgba) {
+        uint8_t red[BCFast::NUM_PIXELS_PER_BLOCK];
+        uint8_t green[BCFast::NUM_PIXELS_PER_BLOCK];
+        for (size_t i = 0; i < nBlocks; i++) {
+            uint8_t *block = rgba + i * BCFast::NUM_PIXELS_PER_BLOCK * 4;
+            const uint8_t *bc = encoded + i * BlockSizes[format];
+            switch (format) {
+                case 0:
+                    BCFast::DecodeBC1(block, bc);
+                    break;
+                case 1:
+                    BCFast::DecodeBC3(block, bc);
+                    break;
+                case 2:
+                    BCFast::DecodeBC4U(red, bc);
+                    for (size_t t = 0; t < BCFast::NUM_PIXELS_PER_BLOCK; t++) {
+                        block[t * 4] = red[t];
+                    }
+                    break;
+                default:
+                    BCFast::DecodeBC5U(red, green, bc);
+                    for (size_t t = 0; t < BCFast::NUM_PIXELS_PER_BLOCK; t++) {
+                        block[t * 4] = red[t];
+                        block[t * 4 + 1] = green[t];
+                    }
+                    break;
+            }
+        }
+    }
+
+    // Mean squared error and PSNR over the channels the format stores, in the [0, 1] range ComputeMSE uses
+    void reportError(benchmark::State &state, size_t format, const std::vector<uint8_t> &reference,
+                     const std::vector<uint8_t> &encoded) {
+        const size_t nBlocks = reference.size() / (BCFast::NUM_PIXELS_PER_BLOCK * 4);
+        std::vector<uint8_t> decoded(reference.size());
+        decode(format, encoded.data(), nBlocks, decoded.data());
+
+        const size_t channels = format == 2 ? 1 : format == 3 ? 2 : 4;
+        double sum = 0;
+        for (size_t i = 0; i < reference.size(); i += 4) {
+            for (size_t c = 0; c < channels; c++) {
+                const double d = (double(reference[i + c]) - double(decoded[i + c])) / 255.0;
+                sum += d * d;
+            }
+        }
+        const double mse = sum / double(reference.size() / 4 * channels);
+        state.counters["mse"] = mse;
+        state.counters["psnr"] = mse > 0 ? 10.0 * std::log10(1.0 / mse) : 0.0;
+    }
+}
+
+// Every block of a 1024x1024 image, BC4/BC5 with and without the exhaustive endpoint search
+static void BM_BCFastEncode(benchmark::State &state) {
+    const auto format = static_cast<size_t>(state.range(0));
+    const auto blocks = blocksOf(state.range(1) != 0);
+    const auto red = channelOf(blocks, 0);
+    const auto green = channelOf(blocks, 1);
+    const bool exhaustive = state.range(2) != 0;
+    state.SetLabel(FormatNames[format]);
+
+    const size_t nBlocks = blocks.size() / (BCFast::NUM_PIXELS_PER_BLOCK * 4);
+    std::vector<uint8_t> encoded(nBlocks * BlockSizes[format]);
+    for (auto _ : state) {
+        encode(format, blocks, red, green, exhaustive, encoded.data());
+        benchmark::DoNotOptimize(encoded.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * blocks.size()));
+    reportError(state, format, blocks, encoded);
+}
+BENCHMARK(BM_BCFastEncode)->Apply([](auto *b) {
+    b->ArgNames({"format", "alpha", "exhaustive"});
+    b->ArgsProduct({{0, 1}, {0, 1}, {0}});
+    b->ArgsProduct({{2, 3}, {0}, {0, 1}});
+})->Unit(benchmark::kMillisecond);
+
+static void BM_BCFastDecode(benchmark::State &state) {
+    const auto format = static_cast<size_t>(state.range(0));
+    const auto blocks = blocksOf(state.range(1) != 0);
+    state.SetLabel(FormatNames[format]);
+
+    const size_t nBlocks = blocks.size() / (BCFast::NUM_PIXELS_PER_BLOCK * 4);
+    std::vector<uint8_t> encoded(nBlocks * BlockSizes[format]);
+    encode(format, blocks, channelOf(blocks, 0), channelOf(blocks, 1), false, encoded.data());
+
+    std::vector<uint8_t> decoded(blocks.size());
+    for (auto _ : state) {
+        decode(format, encoded.data(), nBlocks, decoded.data());
+        benchmark::DoNotOptimize(decoded.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * decoded.size()));
+}
+BENCHMARK(BM_BCFastDecode)->Apply([](auto *b) {
+    b->ArgNames({"format", "alpha"});
+    b->ArgsProduct({{0, 1, 2, 3}, {0, 1}});
+})->Unit(benchmark::kMillisecond);
@@ -0,0 +1,45 @@
+#include "synthetic.h"
+
+#include "encoder.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace {
+    constexpr EncoderSession::Format Formats[] = {EncoderSession::Format::BC1, EncoderSession::Format::BC3,
+                                                  EncoderSession::Format::BC4, EncoderSession::Format::BC5,
+                                                  EncoderSession::Format::BC7};
+
+    void sessionFormats(benchmark::internal::Benchmark *bench, std::vector<int64_t> sizes) {
+        bench->ArgNames({"format", "size", "alpha"});
+        bench->ArgsProduct({{0, 1, 2, 3, 4}, std::move(sizes), {0, 1}});
+    }
+}
+
+/*!
+ * \brief The CPU backend's session on one RGBA8 image, as the resizers use it. Runs everywhere, BC7 only where
+ * DirectXTex builds
+ */
+static void BM_EncoderSession(benchmark::State &state) {
+    const auto size = static_cast<uint32_t>(state.range(1));
+    const auto pixels = Synthetic::generateRGBA(size, size, state.range(2) != 0);
+    const EncoderImage image{size, size, size_t(size) * 4, pixels.data()};
+
+    const EncoderSession::Format format = Formats[state.range(0)];
+    const size_t blocksWide = (size + 3) / 4;
+    std::vector<uint8_t> blocks(blocksWide * blocksWide * EncoderSession::blockSize(format));
+    const EncodedImage result{blocksWide * EncoderSession::blockSize(format), blocks.data()};
+
+    const auto backend = EncoderBackend::create(EncoderBackend::Type::CPU, 0);
+    const auto session = backend->createSession();
+    for (auto _ : state) {
+        if (!session->compress(&image, 1, format, &result)) {
+            state.SkipWithError("compress failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * pixels.size()));
+}
+BENCHMARK(BM_EncoderSession)->Apply([](auto *b) { sessionFormats(b, {256, 1024, 2048}); })
+        ->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,359 @@
+#include "synthetic.h"
+
+#include "texture_sizes.h"
+
+#include "libs/NIF/NifFile.h"
+#include "libs/NIF/utils/KDMatcher.h"
+#include "libs/NIF/utils/VertexCache.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+// Shapes, vertices per shape and extra nodes, from a single small mesh to a heavy multi-part one
+static void nifShapes(benchmark::internal::Benchmark *bench) {
+    bench->ArgNames({"shapes", "vertices", "nodes"});
+    bench->ArgsProduct({{1, 8, 64}, {256, 4096, 32768}, {0}});
+    bench->Args({8, 1024, 500});
+}
+
+// The spec nifShapes describes, with generateNIF's defaults for the rest
+static Synthetic::NIFSpec specOf(const benchmark::State &state) {
+    Synthetic::NIFSpec spec;
+    spec.shapes = static_cast<uint32_t>(state.range(0));
+    spec.verticesPerShape = static_cast<uint32_t>(state.range(1));
+    spec.extraNodes = static_cast<uint32_t>(state.range(2));
+    return spec;
+}
+
+// The processor's path: the archive buffer is copied into a string stream and parsed
+static void BM_NifLoad(benchmark::State &state) {
+    const Synthetic::NIFSpec spec = specOf(state);
+    const std::string bytes = Synthetic::generateNIF(spec);
+
+    NifFile nif;
+    for (auto _ : state) {
+        std::string copy(bytes.data(), bytes.size());
+        std::stringstream ss(copy);
+        if (nif.Load(ss) != 0) {
+            state.SkipWithError("Failed to load the synthetic NIF");
+            break;
+        }
+        benchmark::DoNotOptimize(nif.GetShapes().size());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes.size()));
+    state.SetItemsProcessed(state.iterations());
+    state.counters["blocks"] = nif.GetHeader().GetNumBlocks();
+}
+BENCHMARK(BM_NifLoad)->Apply(nifShapes)->Unit(benchmark::kMicrosecond);
+
+// The processor's size calculation on an already loaded file
+static void BM_NifTextureSizes(benchmark::State &state) {
+    Synthetic::NIFSpec spec = specOf(state);
+    spec.texturesPerShape = 9;
+    std::stringstream ss(Synthetic::generateNIF(spec));
+
+    NifFile nif;
+    if (nif.Load(ss) != 0) {
+        state.SkipWithError("Failed to load the synthetic NIF");
+        return;
+    }
+
+    std::unordered_map<std::string, float> sizes;
+    for (auto _ : state) {
+        sizes.clear();
+        forEachTextureSize(nif, [&](const std::string &texture, float radius) {
+            if (radius > sizes[texture]) {
+                sizes[texture] = radius;
+            }
+        });
+        benchmark::DoNotOptimize(sizes.size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * spec.shapes));
+}
+BENCHMARK(BM_NifTextureSizes)->Apply(nifShapes)->Unit(benchmark::kMicrosecond);
+
+static void BM_NifSave(benchmark::State &state) {
+    std::stringstream in(Synthetic::generateNIF(specOf(state)));
+
+    NifFile nif;
+    if (nif.Load(in) != 0) {
+        state.SkipWithError("Failed to load the synthetic NIF");
+        return;
+    }
+
+    NifSaveOptions options;
+    options.optimize = false;
+    options.sortBlocks = false;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+        if (nif.Save(out, options) != 0) {
+            state.SkipWithError("Failed to save the NIF");
+            break;
+        }
+        // Save leaves the put pointer on the block size table it rewrote
+        out.seekp(0, std::ios::end);
+        bytes = static_cast<size_t>(out.tellp());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+}
+BENCHMARK(BM_NifSave)->Apply(nifShapes)->Unit(benchmark::kMicrosecond);
+
+static float meanACMR(NifFile &nif) {
+    float total = 0.0f;
+    size_t shapes = 0;
+    for (const auto &shape : nif.GetShapes()) {
+        std::vector<Triangle> tris;
+        if (shape->GetTriangles(tris) && !tris.empty()) {
+            total += VertexCacheOptimizer::CalcACMR(tris, shape->GetNumVertices());
+            shapes++;
+        }
+    }
+    return shapes > 0 ? total / static_cast<float>(shapes) : 0.0f;
+}
+
+// Triangle and vertex reordering for the post-transform cache, with the average cache miss ratio of a 16 entry FIFO
+// before and after. The synthetic grids are in row order, about as good as exported meshes get before optimising
+static void BM_NifVertexCache(benchmark::State &state) {
+    const Synthetic::NIFSpec spec = specOf(state);
+    const std::string bytes = Synthetic::generateNIF(spec);
+
+    float before = 0.0f;
+    float after = 0.0f;
+    uint64_t triangles = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        NifFile nif;
+        std::stringstream ss(bytes);
+        if (nif.Load(ss) != 0) {
+            state.SkipWithError("Failed to load the synthetic NIF");
+            break;
+        }
+        before = meanACMR(nif);
+        triangles = 0;
+        for (const auto &shape : nif.GetShapes()) {
+            triangles += shape->GetNumTriangles();
+        }
+        state.ResumeTiming();
+
+        for (const auto &shape : nif.GetShapes()) {
+            nif.OptimizeVertexCache(shape);
+        }
+
+        state.PauseTiming();
+        after = meanACMR(nif);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * triangles));
+    state.counters["acmrBefore"] = before;
+    state.counters["acmrAfter"] = after;
+}
+BENCHMARK(BM_NifVertexCache)->Apply(nifShapes)->Unit(benchmark::kMicrosecond);
+
+// What reordering must keep on a skinned shape, keyed by position since the indices change: the skin partition of
+// every triangle (rotated to start at its smallest corner, keeping the winding) and the bone weights of every vertex,
+// both from the vertex data and from NiSkinData
+struct SkinSignature {
+    std::map<std::array<float, 9>, int> triParts;
+    std::map<std::array<float, 3>, std::vector<float>> weights;
+
+    bool operator==(const SkinSignature &other) const {
+        return triParts == other.triParts && weights == other.weights;
+    }
+};
+
+static std::vector<SkinSignature> skinSignatures(NifFile &nif) {
+    std::vector<SkinSignature> result;
+    for (const auto &shape : nif.GetShapes()) {
+        SkinSignature signature;
+        const std::vector<Vector3> *verts = nif.GetRawVertsForShape(shape);
+        std::vector<Triangle> tris;
+        std::vector<BSDismemberSkinInstance::PartitionInfo> partitions;
+        std::vector<int> triParts;
+        if (!verts || !shape->GetTriangles(tris) || !nif.GetShapePartitions(shape, partitions, triParts)) {
+            result.push_back(signature);
+            continue;
+        }
+
+        const auto position = [&](ushort index) {
+            const Vector3 &p = (*verts)[index];
+            return std::array<float, 3>{p.x, p.y, p.z};
+        };
+        for (size_t t = 0; t < tris.size(); t++) {
+            std::array<std::array<float, 3>, 3> corners = {position(tris[t].p1), position(tris[t].p2),
+                                                           position(tris[t].p3)};
+            const auto first = std::min_element(corners.begin(), corners.end()) - corners.begin();
+            std::array<float, 9> key{};
+            for (size_t c = 0; c < 3; c++) {
+                std::copy(corners[(first + c) % 3].begin(), corners[(first + c) % 3].end(), key.begin() + c * 3);
+            }
+            signature.triParts[key] = triParts[t];
+        }
+
+        std::vector<int> bones;
+        const int numBones = nif.GetShapeBoneIDList(shape, bones);
+        auto skinInst = nif.GetHeader().GetBlock<NiSkinInstance>(shape->GetSkinInstanceRef());
+        auto skinData = skinInst ? nif.GetHeader().GetBlock<NiSkinData>(skinInst->GetDataRef()) : nullptr;
+        for (size_t v = 0; v < verts->size(); v++) {
+            signature.weights[position(static_cast<ushort>(v))].assign(numBones * 2, 0.0f);
+        }
+        for (int b = 0; b < numBones; b++) {
+            std::unordered_map<ushort, float> weights;
+            nif.GetShapeBoneWeights(shape, b, weights);
+            for (const auto &[v, weight] : weights) {
+                signature.weights[position(v)][b] = weight;
+            }
+            if (skinData && b < static_cast<int>(skinData->bones.size())) {
+                for (const auto &sw : skinData->bones[b].vertexWeights) {
+                    signature.weights[position(sw.index)][numBones + b] = sw.weight;
+                }
+            }
+        }
+        result.push_back(std::move(signature));
+    }
+    return result;
+}
+
+// BM_NifVertexCache on shapes with two bones and two partitions. The last result is saved and loaded again, the
+// way SSE keeps skinned geometry in the partitions, and has to match the input triangle for triangle
+static void BM_NifVertexCacheSkinned(benchmark::State &state) {
+    Synthetic::NIFSpec spec = specOf(state);
+    spec.skinned = true;
+    const std::string bytes = Synthetic::generateNIF(spec);
+
+    NifFile nif;
+    std::vector<SkinSignature> expected;
+    float before = 0.0f;
+    uint64_t triangles = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::stringstream ss(bytes);
+        if (nif.Load(ss) != 0) {
+            state.SkipWithError("Failed to load the synthetic NIF");
+            return;
+        }
+        if (expected.empty()) {
+            expected = skinSignatures(nif);
+            before = meanACMR(nif);
+        }
+        triangles = 0;
+        for (const auto &shape : nif.GetShapes()) {
+            triangles += shape->GetNumTriangles();
+        }
+        state.ResumeTiming();
+
+        for (const auto &shape : nif.GetShapes()) {
+            nif.OptimizeVertexCache(shape);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * triangles));
+    state.counters["acmrBefore"] = before;
+    state.counters["acmrAfter"] = meanACMR(nif);
+
+    NifSaveOptions options;
+    options.optimize = false;
+    std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+    NifFile reloaded;
+    if (nif.Save(out, options) != 0 || reloaded.Load(out) != 0) {
+        state.SkipWithError("Failed to save and reload the optimised NIF");
+        return;
+    }
+    if (skinSignatures(reloaded) != expected) {
+        state.SkipWithError("Vertex cache optimisation changed the skin partitions or bone weights");
+    }
+}
+BENCHMARK(BM_NifVertexCacheSkinned)->Apply(nifShapes)->Unit(benchmark::kMicrosecond);
+
+// Duplicate vertex welding on skinned sheets with a seam down the middle. The last result is saved and loaded again,
+// and must have lost exactly the seam copies while keeping every triangle, partition and bone weight
+static void BM_NifWeldVertices(benchmark::State &state) {
+    Synthetic::NIFSpec spec = specOf(state);
+    spec.skinned = true;
+    spec.seam = true;
+    const std::string bytes = Synthetic::generateNIF(spec);
+
+    NifFile nif;
+    std::vector<SkinSignature> expected;
+    int64_t vertices = 0;
+    int welded = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::stringstream ss(bytes);
+        if (nif.Load(ss) != 0) {
+            state.SkipWithError("Failed to load the synthetic NIF");
+            return;
+        }
+        if (expected.empty()) {
+            expected = skinSignatures(nif);
+        }
+        vertices = 0;
+        for (const auto &shape : nif.GetShapes()) {
+            vertices += shape->GetNumVertices();
+        }
+        welded = 0;
+        state.ResumeTiming();
+
+        for (const auto &shape : nif.GetShapes()) {
+            welded += nif.WeldVertices(shape);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * vertices);
+    state.counters["welded"] = welded;
+
+    // One copied vertex per grid row
+    const auto grid = static_cast<int>(std::sqrt(static_cast<double>(spec.verticesPerShape)));
+    const int seams = static_cast<int>(spec.shapes) * std::min(grid, 182);
+    NifSaveOptions options;
+    options.optimize = false;
+    std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+    NifFile reloaded;
+    if (nif.Save(out, options) != 0 || reloaded.Load(out) != 0) {
+        state.SkipWithError("Failed to save and reload the welded NIF");
+        return;
+    }
+    int64_t remaining = 0;
+    for (const auto &shape : reloaded.GetShapes()) {
+        remaining += shape->GetNumVertices();
+    }
+    if (welded != seams || remaining != vertices - seams) {
+        state.SkipWithError("Welding didn't remove exactly the seam copies");
+    }
+    else if (skinSignatures(reloaded) != expected) {
+        state.SkipWithError("Welding changed the triangles, skin partitions or bone weights");
+    }
+}
+BENCHMARK(BM_NifWeldVertices)->Apply(nifShapes)->Unit(benchmark::kMicrosecond);
+
+// Coincident vertex search on a sorted grid with every fourth vertex duplicated, as along UV seams. Sorted input is
+// kd_matcher's worst case, since its tree degenerates to a list
+template<typename Matcher>
+static void BM_VertexMatcher(benchmark::State &state) {
+    const auto side = static_cast<int>(std::sqrt(static_cast<double>(state.range(0))));
+    std::vector<Vector3> points;
+    points.reserve(side * side * 5 / 4);
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            points.emplace_back(static_cast<float>(x) * 0.1f, static_cast<float>(y) * 0.1f, 0.0f);
+            if ((x + y) % 4 == 0) {
+                points.push_back(points.back());
+            }
+        }
+    }
+
+    size_t matches = 0;
+    for (auto _ : state) {
+        Matcher matcher(points.data(), static_cast<int>(points.size()));
+        matches = matcher.matches.size();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * points.size()));
+    state.counters["matches"] = static_cast<double>(matches);
+}
+BENCHMARK_TEMPLATE(BM_VertexMatcher, kd_matcher)->ArgName("vertices")->Arg(1024)->Arg(8192)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_VertexMatcher, SortingMatcher)->ArgName("vertices")->Arg(1024)->Arg(8192)->Arg(32768)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_VertexMatcher, HashMatcher)->ArgName("vertices")->Arg(1024)->Arg(8192)->Arg(32768)->Unit(benchmark::kMicrosecond);
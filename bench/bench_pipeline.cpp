@@ -0,0 +1,101 @@
+#include "synthetic.h"
+
+#include "texture_sizes.h"
+
+#include <bs_archive_reader.hpp>
+#include <bs_archive_writer.hpp>
+#include <utils/parallel_for.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    // Meshes only, the mesh pass never touches the textures. Compressed like the game's archives when libbsarch has LZ4
+    const std::filesystem::path &meshArchive(bool &compressed) {
+        static bool written_compressed = true;
+        static const std::filesystem::path path = [] {
+            const Synthetic::Corpus corpus = Synthetic::generateCorpus(512);
+            const auto result = std::filesystem::temp_directory_path() / "sto_bench_meshes.bsa";
+            for (bool compress : {true, false}) {
+                libbsarch::bs_archive_writer writer(libbsarch::bs_archive_writer::format::sse);
+                writer.set_compressed(compress);
+                for (size_t i = 0; i < corpus.paths.size(); i++) {
+                    if (corpus.paths[i].rfind("meshes", 0) == 0) {
+                        writer.add_file(corpus.paths[i], corpus.files[i]);
+                    }
+                }
+                try {
+                    writer.save(result);
+                    written_compressed = compress;
+                    break;
+                } catch (const std::runtime_error &) {
+                    if (!compress) {
+                        throw;
+                    }
+                }
+            }
+            return result;
+        }();
+        compressed = written_compressed;
+        return path;
+    }
+}
+
+/*!
+ * \brief The whole mesh pass: open the archive, extract every mesh, parse it and collect the biggest bounding sphere
+ * per texture, with one NifFile and size map per worker like the processor threads
+ */
+static void BM_MeshPass(benchmark::State &state) {
+    const auto threads = static_cast<unsigned>(state.range(0));
+    bool compressed;
+    const auto &path = meshArchive(compressed);
+    state.SetLabel(compressed ? "lz4" : "uncompressed");
+
+    uint64_t bytes = 0;
+    size_t meshes = 0;
+    for (auto _ : state) {
+        const libbsarch::bs_archive_reader reader(path);
+        std::vector<const libbsarch::bs_archive_reader::file_entry *> entries;
+        for (const auto &entry : reader.files()) {
+            entries.push_back(&entry);
+        }
+        meshes = entries.size();
+
+        const unsigned workers = threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+        std::vector<std::unordered_map<std::string, float>> sizes(workers);
+        std::atomic<uint64_t> extracted{0};
+        libbsarch::parallel_for(workers, workers, [&](size_t worker) {
+            NifFile nif;
+            std::vector<uint8_t> buffer;
+            for (size_t i = worker; i < entries.size(); i += workers) {
+                const uint32_t size = reader.extracted_size(*entries[i]);
+                buffer.resize(size);
+                reader.extract(*entries[i], buffer.data(), buffer.size());
+                extracted += size;
+
+                std::stringstream ss(std::string(reinterpret_cast<const char *>(buffer.data()), size));
+                if (nif.Load(ss) != 0) {
+                    continue;
+                }
+                forEachTextureSize(nif, [&](const std::string &texture, float radius) {
+                    if (radius > sizes[worker][texture]) {
+                        sizes[worker][texture] = radius;
+                    }
+                });
+            }
+        });
+        bytes = extracted;
+        benchmark::DoNotOptimize(sizes.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * meshes));
+}
+BENCHMARK(BM_MeshPass)->ArgNames({"threads"})->Arg(1)->Arg(4)->Arg(0)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,325 @@
+#include "synthetic.h"
+
+#include "textures.hpp"
+#include "encoder.h"
+
+#include "libs/DirectXTex/DirectXTex.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <memory>
+
+namespace {
+    constexpr Synthetic::DDSFormat Formats[] = {Synthetic::DDSFormat::BC1, Synthetic::DDSFormat::BC3,
+                                                Synthetic::DDSFormat::BC5, Synthetic::DDSFormat::BC7,
+                                                Synthetic::DDSFormat::RGBA8};
+
+    DXGI_FORMAT dxgiFormat(Synthetic::DDSFormat format) {
+        switch (format) {
+            case Synthetic::DDSFormat::BC1: return DXGI_FORMAT_BC1_UNORM;
+            case Synthetic::DDSFormat::BC3: return DXGI_FORMAT_BC3_UNORM;
+            case Synthetic::DDSFormat::BC5: return DXGI_FORMAT_BC5_UNORM;
+            case Synthetic::DDSFormat::BC7: return DXGI_FORMAT_BC7_UNORM;
+            case Synthetic::DDSFormat::RGBA8: return DXGI_FORMAT_R8G8B8A8_UNORM;
+        }
+        return DXGI_FORMAT_UNKNOWN;
+    }
+
+    // Format index, size and alpha, as the benchmark arguments carry them
+    Synthetic::DDSSpec specOf(const benchmark::State &state) {
+        Synthetic::DDSSpec spec;
+        spec.format = Formats[state.range(0)];
+        spec.width = spec.height = static_cast<uint32_t>(state.range(1));
+        spec.alpha = state.range(2) != 0;
+        return spec;
+    }
+
+    bool load(const std::vector<uint8_t> &dds, DirectX::ScratchImage &image) {
+        return SUCCEEDED(DirectX::LoadFromDDSMemory(dds.data(), dds.size(), DirectX::DDS_FLAGS_NONE, nullptr, image));
+    }
+
+    // The RGBA8 base level the resize, mipmap and compression kernels start from
+    bool loadUncompressed(const benchmark::State &state, DirectX::ScratchImage &image) {
+        Synthetic::DDSSpec spec;
+        spec.format = Synthetic::DDSFormat::RGBA8;
+        spec.width = spec.height = static_cast<uint32_t>(state.range(1));
+        spec.alpha = state.range(2) != 0;
+        spec.mipmaps = false;
+        return load(Synthetic::generateDDS(spec), image);
+    }
+
+    void allFormats(benchmark::internal::Benchmark *bench, std::vector<int64_t> sizes) {
+        bench->ArgNames({"format", "size", "alpha"});
+        bench->ArgsProduct({{0, 1, 2, 3, 4}, std::move(sizes), {0, 1}});
+    }
+
+    void compressedFormats(benchmark::internal::Benchmark *bench, std::vector<int64_t> sizes) {
+        bench->ArgNames({"format", "size", "alpha"});
+        bench->ArgsProduct({{0, 1, 2, 3}, std::move(sizes), {0, 1}});
+    }
+
+    // Mean squared error over the channels on a 0-1 scale, and its PSNR, next to the timings
+    void reportError(benchmark::State &state, const DirectX::Image &reference, const DirectX::Image &encoded,
+                     DWORD flags = DirectX::CMSE_DEFAULT) {
+        float mse = 0;
+        float channels[4] = {};
+        if (FAILED(DirectX::ComputeMSE(reference, encoded, mse, channels, flags))) {
+            state.SkipWithError("ComputeMSE failed");
+            return;
+        }
+        state.counters["mse"] = mse;
+        state.counters["mse_alpha"] = channels[3];
+        state.counters["psnr"] = mse > 0 ? 10.0 * std::log10(1.0 / mse) : 0.0;
+    }
+
+    // The kernels only look at the size and alpha, the format argument stays so the names line up
+    void uncompressedOnly(benchmark::internal::Benchmark *bench, std::vector<int64_t> sizes) {
+        bench->ArgNames({"format", "size", "alpha"});
+        bench->ArgsProduct({{4}, std::move(sizes), {0, 1}});
+    }
+}
+
+static void BM_LoadDDS(benchmark::State &state) {
+    const auto dds = Synthetic::generateDDS(specOf(state));
+    for (auto _ : state) {
+        DirectX::ScratchImage image;
+        if (!load(dds, image)) {
+            state.SkipWithError("LoadFromDDSMemory failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * dds.size()));
+}
+BENCHMARK(BM_LoadDDS)->Apply([](auto *b) { allFormats(b, {256, 1024, 4096, 8192}); })->Unit(benchmark::kMicrosecond);
+
+static void BM_Decompress(benchmark::State &state) {
+    DirectX::ScratchImage source;
+    if (!load(Synthetic::generateDDS(specOf(state)), source)) {
+        state.SkipWithError("LoadFromDDSMemory failed");
+        return;
+    }
+    for (auto _ : state) {
+        DirectX::ScratchImage result;
+        if (FAILED(DirectX::Decompress(source.GetImages(), source.GetImageCount(), source.GetMetadata(),
+                                       DXGI_FORMAT_UNKNOWN, DirectX::TEX_COMPRESS_DEFAULT, result))) {
+            state.SkipWithError("Decompress failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.GetPixelsSize()));
+}
+BENCHMARK(BM_Decompress)->Apply([](auto *b) { compressedFormats(b, {256, 1024, 4096, 8192}); })
+        ->Unit(benchmark::kMillisecond);
+
+// Halving, what the resizer does to most textures, with the filter textures.cpp picks
+static void BM_Resize(benchmark::State &state) {
+    DirectX::ScratchImage source;
+    if (!loadUncompressed(state, source)) {
+        state.SkipWithError("LoadFromDDSMemory failed");
+        return;
+    }
+    const auto &info = source.GetMetadata();
+    DWORD filter = DirectX::TEX_FILTER_FANT | DirectX::TEX_FILTER_SEPARATE_ALPHA;
+    if (info.width * info.height >= 4096 * 4096) {
+        filter |= DirectX::TEX_FILTER_PARALLEL;
+    }
+    for (auto _ : state) {
+        DirectX::ScratchImage result;
+        if (FAILED(DirectX::Resize(source.GetImages(), source.GetImageCount(), info, info.width / 2, info.height / 2,
+                                   filter, result))) {
+            state.SkipWithError("Resize failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.GetPixelsSize()));
+}
+BENCHMARK(BM_Resize)->Apply([](auto *b) { uncompressedOnly(b, {256, 1024, 4096, 8192}); })
+        ->Unit(benchmark::kMillisecond);
+
+static void BM_GenerateMipMaps(benchmark::State &state) {
+    DirectX::ScratchImage source;
+    if (!loadUncompressed(state, source)) {
+        state.SkipWithError("LoadFromDDSMemory failed");
+        return;
+    }
+    for (auto _ : state) {
+        DirectX::ScratchImage result;
+        if (FAILED(DirectX::GenerateMipMaps(source.GetImages(), source.GetImageCount(), source.GetMetadata(),
+                                            DirectX::TEX_FILTER_FANT | DirectX::TEX_FILTER_SEPARATE_ALPHA, 0,
+                                            result))) {
+            state.SkipWithError("GenerateMipMaps failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.GetPixelsSize()));
+}
+BENCHMARK(BM_GenerateMipMaps)->Apply([](auto *b) { uncompressedOnly(b, {256, 1024, 4096, 8192}); })
+        ->Unit(benchmark::kMillisecond);
+
+// Software encoders, the format argument is the target. BC7 is slow enough to keep to the smaller sizes
+static void BM_Compress(benchmark::State &state) {
+    DirectX::ScratchImage source;
+    if (!loadUncompressed(state, source)) {
+        state.SkipWithError("LoadFromDDSMemory failed");
+        return;
+    }
+    const DXGI_FORMAT format = dxgiFormat(Formats[state.range(0)]);
+    for (auto _ : state) {
+        DirectX::ScratchImage result;
+        if (FAILED(DirectX::Compress(source.GetImages(), source.GetImageCount(), source.GetMetadata(), format,
+                                     DirectX::TEX_COMPRESS_DEFAULT | DirectX::TEX_FILTER_SEPARATE_ALPHA,
+                                     DirectX::TEX_THRESHOLD_DEFAULT, result))) {
+            state.SkipWithError("Compress failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.GetPixelsSize()));
+}
+BENCHMARK(BM_Compress)->Apply([](auto *b) { compressedFormats(b, {256, 1024, 2048}); })
+        ->Unit(benchmark::kMillisecond);
+
+// The integer BC1/BC3 encoder against the float one on the same source, time and error
+static void BM_CompressBC13(benchmark::State &state) {
+    DirectX::ScratchImage source;
+    if (!loadUncompressed(state, source)) {
+        state.SkipWithError("LoadFromDDSMemory failed");
+        return;
+    }
+    const DXGI_FORMAT format = dxgiFormat(Formats[state.range(0)]);
+    DWORD flags = DirectX::TEX_COMPRESS_DEFAULT | DirectX::TEX_FILTER_SEPARATE_ALPHA;
+    if (state.range(3)) {
+        flags |= DirectX::TEX_COMPRESS_BC13_FAST;
+    }
+    DirectX::ScratchImage result;
+    for (auto _ : state) {
+        result.Release();
+        if (FAILED(DirectX::Compress(*source.GetImage(0, 0, 0), format, flags, DirectX::TEX_THRESHOLD_DEFAULT,
+                                     result))) {
+            state.SkipWithError("Compress failed");
+            return;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.GetPixelsSize()));
+    reportError(state, *source.GetImage(0, 0, 0), *result.GetImage(0, 0, 0));
+}
+BENCHMARK(BM_CompressBC13)->Apply([](auto *b) {
+    b->ArgNames({"format", "size", "alpha", "fast"});
+    b->ArgsProduct({{0, 1}, {256, 1024, 2048}, {0, 1}, {0, 1}});
+})->Unit(benchmark::kMillisecond);
+
+// The integer BC4/BC5 encoder, with and without the exhaustive endpoint search, against the float one
+static void BM_CompressBC45(benchmark::State &state) {
+    DirectX::ScratchImage source;
+    if (!loadUncompressed(state, source)) {
+        state.SkipWithError("LoadFromDDSMemory failed");
+        return;
+    }
+    const bool bc5 = state.range(0) == 2;
+    DWORD flags = DirectX::TEX_COMPRESS_DEFAULT;
+    if (state.range(3) >= 1) {
+        flags |= DirectX::TEX_COMPRESS_BC45_FAST;
+    }
+    if (state.range(3) == 2) {
+        flags |= DirectX::TEX_COMPRESS_BC45_EXHAUSTIVE;
+    }
+    DirectX::ScratchImage result;
+    for (auto _ : state) {
+        result.Release();
+        if (FAILED(DirectX::Compress(*source.GetImage(0, 0, 0), bc5 ? DXGI_FORMAT_BC5_UNORM : DXGI_FORMAT_BC4_UNORM,
+                                     flags, DirectX::TEX_THRESHOLD_DEFAULT, result))) {
+            state.SkipWithError("Compress failed");
+            return;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.GetPixelsSize()));
+    // Only the channels the format keeps
+    DWORD ignored = DirectX::CMSE_IGNORE_BLUE | DirectX::CMSE_IGNORE_ALPHA;
+    if (!bc5) {
+        ignored |= DirectX::CMSE_IGNORE_GREEN;
+    }
+    reportError(state, *source.GetImage(0, 0, 0), *result.GetImage(0, 0, 0), ignored);
+}
+BENCHMARK(BM_CompressBC45)->Apply([](auto *b) {
+    // channels 1 is BC4 and 2 BC5; encoder 0 is the float one, 1 the integer one and 2 the exhaustive search
+    b->ArgNames({"channels", "size", "alpha", "encoder"});
+    b->ArgsProduct({{1, 2}, {256, 1024, 2048}, {0}, {0, 1, 2}});
+})->Unit(benchmark::kMillisecond);
+
+static void BM_SaveDDS(benchmark::State &state) {
+    DirectX::ScratchImage source;
+    if (!load(Synthetic::generateDDS(specOf(state)), source)) {
+        state.SkipWithError("LoadFromDDSMemory failed");
+        return;
+    }
+    for (auto _ : state) {
+        DirectX::Blob blob;
+        if (FAILED(DirectX::SaveToDDSMemory(source.GetImages(), source.GetImageCount(), source.GetMetadata(),
+                                            DirectX::DDS_FLAGS_NONE, blob))) {
+            state.SkipWithError("SaveToDDSMemory failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.GetPixelsSize()));
+}
+BENCHMARK(BM_SaveDDS)->Apply([](auto *b) { allFormats(b, {1024, 8192}); })->Unit(benchmark::kMicrosecond);
+
+// Halve, mipmap and compress to BC7 in one streamed pass, from any source format
+static void BM_StreamCompress(benchmark::State &state) {
+    DirectX::ScratchImage source;
+    if (!load(Synthetic::generateDDS(specOf(state)), source)) {
+        state.SkipWithError("LoadFromDDSMemory failed");
+        return;
+    }
+    const auto &info = source.GetMetadata();
+    for (auto _ : state) {
+        DirectX::ScratchImage result;
+        if (FAILED(DirectX::StreamCompress(*source.GetImage(0, 0, 0), info.width / 2, info.height / 2, 0,
+                                           DXGI_FORMAT_BC7_UNORM,
+                                           DirectX::TEX_COMPRESS_DEFAULT | DirectX::TEX_FILTER_SEPARATE_ALPHA,
+                                           DirectX::TEX_THRESHOLD_DEFAULT, result))) {
+            state.SkipWithError("StreamCompress failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StreamCompress)->Apply([](auto *b) { allFormats(b, {512, 2048}); })->Unit(benchmark::kMillisecond);
+
+/*!
+ * \brief One texture through the resizer: read, quarter the size, mipmap, encode to BC7 on the CPU and save, taking the
+ * streamed path when the resizer would
+ */
+static void BM_TexturePipeline(benchmark::State &state) {
+    const auto dds = Synthetic::generateDDS(specOf(state));
+    const auto backend = EncoderBackend::create(EncoderBackend::Type::CPU, 0);
+    const auto session = backend->createSession();
+    const size_t target = static_cast<size_t>(state.range(1)) / 4;
+
+    DirectX::ScratchImagePool pool(size_t(1) << 30u);
+    DirectX::ScratchImagePool::Scope poolScope(pool);
+
+    for (auto _ : state) {
+        TexturesOptimizer opt(*session);
+        if (!opt.read("bench.dds", reinterpret_cast<const char *>(dds.data()), dds.size(),
+                      TexturesOptimizer::TextureType::DDS)) {
+            state.SkipWithError("read failed");
+            break;
+        }
+        bool done;
+        if (session->prefersStreaming() && opt.canStreamWork(target, target)) {
+            done = opt.doStreamedWork(target, target);
+        } else {
+            done = opt.doCPUWork(target, target) && opt.doEncoderWork();
+        }
+        DirectX::Blob blob;
+        if (!done || !opt.saveToMemory(blob)) {
+            state.SkipWithError("Texture processing failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * dds.size()));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TexturePipeline)->Apply([](auto *b) { allFormats(b, {1024, 4096}); })
+        ->Unit(benchmark::kMillisecond)->UseRealTime();
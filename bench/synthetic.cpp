@@ -0,0 +1,451 @@
+#include "synthetic.h"
+
+#include "libs/NIF/NifFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+    // xorshift64*, fixed so the corpus doesn't change with the standard library
+    class Random {
+    public:
+        explicit Random(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 0x2545F4914F6CDD1Dull) {
+            if (state == 0) {
+                state = 1;
+            }
+        }
+
+        uint64_t next() {
+            state ^= state >> 12u;
+            state ^= state << 25u;
+            state ^= state >> 27u;
+            return state * 0x2545F4914F6CDD1Dull;
+        }
+
+        uint32_t below(uint32_t bound) {
+            return static_cast<uint32_t>(next() % bound);
+        }
+
+    private:
+        uint64_t state;
+    };
+
+    struct Colour {
+        uint8_t r, g, b, a;
+    };
+
+    // Smooth gradients and a few waves, what a block of a real texture looks like from far away
+    Colour field(uint32_t x, uint32_t y, uint32_t width, uint32_t height, bool alpha) {
+        const float u = static_cast<float>(x) / static_cast<float>(std::max(width, 1u));
+        const float v = static_cast<float>(y) / static_cast<float>(std::max(height, 1u));
+        const auto channel = [](float value) {
+            return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+        };
+        return Colour{
+                channel(0.5f + 0.4f * std::sin(u * 12.0f) * std::cos(v * 7.0f)),
+                channel(u * 0.7f + v * 0.3f),
+                channel(0.3f + 0.5f * std::sin((u + v) * 9.0f) * std::sin(u * 3.0f)),
+                alpha ? channel(0.5f + 0.5f * std::sin(u * 20.0f + v * 5.0f)) : uint8_t(255),
+        };
+    }
+
+    uint8_t jitter(Random &random, uint8_t value, uint32_t spread) {
+        const int offset = static_cast<int>(random.below(spread * 2 + 1)) - static_cast<int>(spread);
+        return static_cast<uint8_t>(std::clamp(static_cast<int>(value) + offset, 0, 255));
+    }
+
+    uint16_t to565(const Colour &colour) {
+        return static_cast<uint16_t>(((colour.r >> 3u) << 11u) | ((colour.g >> 2u) << 5u) | (colour.b >> 3u));
+    }
+
+    template<typename T>
+    void put(std::vector<uint8_t> &out, T value) {
+        const size_t at = out.size();
+        out.resize(at + sizeof(T));
+        std::memcpy(out.data() + at, &value, sizeof(T));
+    }
+
+    void putBC1(std::vector<uint8_t> &out, Random &random, const Colour &centre, bool punchThrough) {
+        uint16_t c0 = to565(Colour{jitter(random, centre.r, 24), jitter(random, centre.g, 24),
+                                   jitter(random, centre.b, 24), 255});
+        uint16_t c1 = to565(Colour{jitter(random, centre.r, 24), jitter(random, centre.g, 24),
+                                   jitter(random, centre.b, 24), 255});
+        // c0 > c1 selects four colours, c0 <= c1 three colours and transparent black
+        if ((c0 > c1) == punchThrough) {
+            std::swap(c0, c1);
+        }
+        uint32_t indices = static_cast<uint32_t>(random.next());
+        if (c0 == c1) {
+            indices = 0;
+        }
+        put(out, c0);
+        put(out, c1);
+        put(out, indices);
+    }
+
+    // BC3 alpha and BC4/BC5 channel blocks share this layout: two endpoints and 16 three bits indices
+    void putBC4(std::vector<uint8_t> &out, Random &random, uint8_t centre, uint32_t spread) {
+        const uint8_t e0 = jitter(random, centre, spread);
+        const uint8_t e1 = jitter(random, centre, spread);
+        put(out, std::max(e0, e1));
+        put(out, std::min(e0, e1));
+        const uint64_t indices = e0 == e1 ? 0 : random.next();
+        for (int i = 0; i < 6; i++) {
+            put(out, static_cast<uint8_t>(indices >> (i * 8u)));
+        }
+    }
+
+    class BitWriter {
+    public:
+        void write(uint32_t value, uint32_t bits) {
+            for (uint32_t i = 0; i < bits; i++, position++) {
+                if (value & (1u << i)) {
+                    block[position / 8] |= static_cast<uint8_t>(1u << (position % 8));
+                }
+            }
+        }
+
+        uint8_t block[16] = {};
+
+    private:
+        uint32_t position = 0;
+    };
+
+    // Mode 6: one subset, 7 bits RGBA endpoints with a p-bit each and 4 bits indices
+    void putBC7(std::vector<uint8_t> &out, Random &random, const Colour &centre, bool alpha) {
+        BitWriter bits;
+        bits.write(1u << 6u, 7);
+        const uint8_t channels[4] = {centre.r, centre.g, centre.b, centre.a};
+        uint32_t endpoints[4][2];
+        for (int c = 0; c < 4; c++) {
+            for (auto &endpoint : endpoints[c]) {
+                endpoint = (c == 3 && !alpha) ? 127u : jitter(random, channels[c], 20) >> 1u;
+            }
+        }
+        for (auto &channel : endpoints) {
+            bits.write(channel[0], 7);
+            bits.write(channel[1], 7);
+        }
+        bits.write(1, 1);
+        bits.write(1, 1);
+        // The anchor index drops its top bit, which is implicitly zero
+        bits.write(random.below(8), 3);
+        for (int i = 1; i < 16; i++) {
+            bits.write(random.below(16), 4);
+        }
+        out.insert(out.end(), std::begin(bits.block), std::end(bits.block));
+    }
+
+    void putRGBA(std::vector<uint8_t> &out, Random &random, uint32_t width, uint32_t height, bool alpha) {
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                const Colour colour = field(x, y, width, height, alpha);
+                out.push_back(jitter(random, colour.r, 6));
+                out.push_back(jitter(random, colour.g, 6));
+                out.push_back(jitter(random, colour.b, 6));
+                out.push_back(colour.a);
+            }
+        }
+    }
+
+    uint32_t fourCC(char a, char b, char c, char d) {
+        return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8u) | (static_cast<uint32_t>(c) << 16u)
+               | (static_cast<uint32_t>(d) << 24u);
+    }
+
+    uint32_t mipCount(uint32_t width, uint32_t height) {
+        uint32_t count = 1;
+        while (width > 1 || height > 1) {
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+            count++;
+        }
+        return count;
+    }
+}
+
+const char *Synthetic::formatName(DDSFormat format) {
+    switch (format) {
+        case DDSFormat::BC1: return "BC1";
+        case DDSFormat::BC3: return "BC3";
+        case DDSFormat::BC5: return "BC5";
+        case DDSFormat::BC7: return "BC7";
+        case DDSFormat::RGBA8: return "RGBA8";
+    }
+    return "unknown";
+}
+
+std::vector<uint8_t> Synthetic::generateDDS(const DDSSpec &spec) {
+    const bool compressed = spec.format != DDSFormat::RGBA8;
+    const uint32_t mips = spec.mipmaps ? mipCount(spec.width, spec.height) : 1;
+    const uint32_t blockBytes = (spec.format == DDSFormat::BC1) ? 8 : 16;
+    const uint32_t topSize = compressed
+                             ? std::max(1u, (spec.width + 3) / 4) * std::max(1u, (spec.height + 3) / 4) * blockBytes
+                             : spec.width * spec.height * 4;
+
+    std::vector<uint8_t> out;
+    out.reserve(128 + 20 + static_cast<size_t>(topSize) * 4 / 3 + 64);
+
+    // DDS_HEADER
+    put(out, fourCC('D', 'D', 'S', ' '));
+    put<uint32_t>(out, 124);
+    put<uint32_t>(out, 0x1u | 0x2u | 0x4u | 0x1000u | (mips > 1 ? 0x20000u : 0u) | (compressed ? 0x80000u : 0x8u));
+    put(out, spec.height);
+    put(out, spec.width);
+    put(out, compressed ? topSize : spec.width * 4);
+    put<uint32_t>(out, 0); // depth
+    put(out, mips);
+    for (int i = 0; i < 11; i++) {
+        put<uint32_t>(out, 0);
+    }
+
+    // DDS_PIXELFORMAT
+    put<uint32_t>(out, 32);
+    switch (spec.format) {
+        case DDSFormat::BC1:
+        case DDSFormat::BC3:
+        case DDSFormat::BC5:
+        case DDSFormat::BC7:
+            put<uint32_t>(out, 0x4u); // DDPF_FOURCC
+            put(out, spec.format == DDSFormat::BC1 ? fourCC('D', 'X', 'T', '1')
+                     : spec.format == DDSFormat::BC3 ? fourCC('D', 'X', 'T', '5')
+                     : spec.format == DDSFormat::BC5 ? fourCC('A', 'T', 'I', '2')
+                     : fourCC('D', 'X', '1', '0'));
+            for (int i = 0; i < 5; i++) {
+                put<uint32_t>(out, 0);
+            }
+            break;
+        case DDSFormat::RGBA8:
+            put<uint32_t>(out, 0x40u | (spec.alpha ? 0x1u : 0u)); // DDPF_RGB, DDPF_ALPHAPIXELS
+            put<uint32_t>(out, 0);
+            put<uint32_t>(out, 32);
+            put<uint32_t>(out, 0x000000FFu);
+            put<uint32_t>(out, 0x0000FF00u);
+            put<uint32_t>(out, 0x00FF0000u);
+            put<uint32_t>(out, spec.alpha ? 0xFF000000u : 0u);
+            break;
+    }
+
+    put<uint32_t>(out, 0x1000u | (mips > 1 ? 0x400000u | 0x8u : 0u)); // DDSCAPS_TEXTURE, MIPMAP, COMPLEX
+    for (int i = 0; i < 4; i++) {
+        put<uint32_t>(out, 0);
+    }
+
+    if (spec.format == DDSFormat::BC7) {
+        // DDS_HEADER_DXT10
+        put<uint32_t>(out, 98); // DXGI_FORMAT_BC7_UNORM
+        put<uint32_t>(out, 3); // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+        put<uint32_t>(out, 0);
+        put<uint32_t>(out, 1);
+        put<uint32_t>(out, spec.alpha ? 0u : 3u); // DDS_ALPHA_MODE_OPAQUE when there is no alpha
+    }
+
+    Random random(spec.seed);
+    uint32_t width = spec.width, height = spec.height;
+    for (uint32_t mip = 0; mip < mips; mip++) {
+        if (compressed) {
+            const uint32_t blocksX = std::max(1u, (width + 3) / 4);
+            const uint32_t blocksY = std::max(1u, (height + 3) / 4);
+            for (uint32_t by = 0; by < blocksY; by++) {
+                for (uint32_t bx = 0; bx < blocksX; bx++) {
+                    const Colour centre = field(bx * 4 + 2, by * 4 + 2, width, height, spec.alpha);
+                    switch (spec.format) {
+                        case DDSFormat::BC1:
+                            putBC1(out, random, centre, spec.alpha && random.below(4) == 0);
+                            break;
+                        case DDSFormat::BC3:
+                            if (spec.alpha) {
+                                putBC4(out, random, centre.a, 32);
+                            } else {
+                                putBC4(out, random, 255, 0);
+                            }
+                            putBC1(out, random, centre, false);
+                            break;
+                        case DDSFormat::BC5:
+                            putBC4(out, random, centre.r, 24);
+                            putBC4(out, random, centre.g, 24);
+                            break;
+                        case DDSFormat::BC7:
+                            putBC7(out, random, centre, spec.alpha);
+                            break;
+                        case DDSFormat::RGBA8:
+                            break;
+                    }
+                }
+            }
+        } else {
+            putRGBA(out, random, width, height, spec.alpha);
+        }
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    return out;
+}
+
+std::vector<uint8_t> Synthetic::generateRGBA(uint32_t width, uint32_t height, bool alpha, uint64_t seed) {
+    std::vector<uint8_t> out;
+    out.reserve(static_cast<size_t>(width) * height * 4);
+    Random random(seed);
+    putRGBA(out, random, width, height, alpha);
+    return out;
+}
+
+std::string Synthetic::texturePath(uint64_t seed, uint32_t shape, uint32_t slot) {
+    static const char *const suffixes[] = {"d", "n", "g", "p", "h", "e", "em", "m", "s"};
+    return "textures\\bench\\" + std::to_string(seed) + "\\shape" + std::to_string(shape) + "_"
+           + suffixes[std::min<uint32_t>(slot, 8)] + ".dds";
+}
+
+std::string Synthetic::generateNIF(const NIFSpec &spec) {
+    NiVersion version;
+    version.SetFile(V20_2_0_7);
+    version.SetUser(12);
+    version.SetStream(100);
+
+    NifFile nif;
+    nif.Create(version);
+    NiHeader &header = nif.GetHeader();
+    NiNode *root = nif.GetRootNode();
+
+    for (uint32_t i = 0; i < spec.extraNodes; i++) {
+        nif.AddNode("BenchNode" + std::to_string(i), MatTransform(), root);
+    }
+
+    std::vector<int> bones;
+    if (spec.skinned) {
+        for (int b = 0; b < 2; b++) {
+            bones.push_back(nif.GetBlockID(nif.AddNode("BenchBone" + std::to_string(b), MatTransform(), root)));
+        }
+    }
+
+    Random random(spec.seed);
+    // SSE stores the triangle count in 16 bits, a 182x182 grid is the largest whose triangles still fit
+    const auto side = static_cast<uint32_t>(std::sqrt(static_cast<double>(spec.verticesPerShape)));
+    const uint32_t grid = std::min(std::max(side, 2u), 182u);
+
+    for (uint32_t s = 0; s < spec.shapes; s++) {
+        // A wavy sheet, offset per shape so every bounding sphere differs
+        std::vector<Vector3> vertices;
+        std::vector<Vector2> uvs;
+        vertices.reserve(grid * grid);
+        uvs.reserve(grid * grid);
+        const float scale = 4.0f + static_cast<float>(random.below(64));
+        for (uint32_t y = 0; y < grid; y++) {
+            for (uint32_t x = 0; x < grid; x++) {
+                const float u = static_cast<float>(x) / static_cast<float>(grid - 1);
+                const float v = static_cast<float>(y) / static_cast<float>(grid - 1);
+                const float noise = static_cast<float>(random.below(1000)) / 1000.0f;
+                vertices.emplace_back(u * scale + static_cast<float>(s) * 10.0f, v * scale,
+                                      std::sin(u * 6.0f) * std::cos(v * 4.0f) * scale * 0.1f + noise);
+                uvs.emplace_back(u, v);
+            }
+        }
+        const uint32_t middle = (grid - 1) / 2;
+        if (spec.seam) {
+            for (uint32_t y = 0; y < grid; y++) {
+                vertices.push_back(vertices[y * grid + middle]);
+                uvs.push_back(uvs[y * grid + middle]);
+            }
+        }
+        std::vector<Triangle> triangles;
+        triangles.reserve((grid - 1) * (grid - 1) * 2);
+        for (uint32_t y = 0; y + 1 < grid; y++) {
+            for (uint32_t x = 0; x + 1 < grid; x++) {
+                const auto at = [&](uint32_t ix, uint32_t iy) {
+                    if (spec.seam && ix == middle && x >= middle) {
+                        return static_cast<ushort>(grid * grid + iy);
+                    }
+                    return static_cast<ushort>(iy * grid + ix);
+                };
+                triangles.emplace_back(at(x, y), at(x + 1, y), at(x, y + 1));
+                triangles.emplace_back(at(x + 1, y), at(x + 1, y + 1), at(x, y + 1));
+            }
+        }
+
+        auto shape = new BSTriShape();
+        shape->Create(&vertices, &triangles, &uvs, nullptr);
+        shape->SetSkinned(false); // new BSTriShapes start out skinned, which keeps the geometry out of the file
+        shape->SetName("BenchShape" + std::to_string(s));
+        const int shapeId = header.AddBlock(shape);
+
+        auto shader = new BSLightingShaderProperty(header.GetVersion());
+        shader->SetTextureSetRef(header.AddBlock(new BSShaderTextureSet(header.GetVersion())));
+        shape->SetShaderPropertyRef(header.AddBlock(shader));
+        root->GetChildren().AddBlockRef(shapeId);
+
+        for (uint32_t slot = 0; slot < std::min(spec.texturesPerShape, 9u); slot++) {
+            std::string texture = texturePath(spec.seed, s, slot);
+            nif.SetTextureSlot(shader, texture, static_cast<int>(slot));
+        }
+
+        if (spec.skinned) {
+            // The first bone fades out left to right as the second fades in
+            nif.CreateSkinning(shape);
+            nif.SetShapeBoneIDList(shape, bones);
+            std::unordered_map<ushort, float> weights[2];
+            for (uint32_t v = 0; v < vertices.size(); v++) {
+                const float u = uvs[v].u;
+                std::vector<byte> vertBones = {0, 1};
+                std::vector<float> vertWeights = {1.0f - u, u};
+                nif.SetShapeVertWeights(shape->GetName(), static_cast<int>(v), vertBones, vertWeights);
+                weights[0][static_cast<ushort>(v)] = 1.0f - u;
+                weights[1][static_cast<ushort>(v)] = u;
+            }
+            nif.SetShapeBoneWeights(shape->GetName(), 0, weights[0]);
+            nif.SetShapeBoneWeights(shape->GetName(), 1, weights[1]);
+
+            // Row order alternates between the halves, so every row is two partition runs
+            std::vector<int> triParts;
+            triParts.reserve(triangles.size());
+            for (uint32_t y = 0; y + 1 < grid; y++) {
+                for (uint32_t x = 0; x + 1 < grid; x++) {
+                    const int part = x < middle ? 0 : 1;
+                    triParts.push_back(part);
+                    triParts.push_back(part);
+                }
+            }
+            std::vector<BSDismemberSkinInstance::PartitionInfo> partitions(2);
+            partitions[0].partID = 32;
+            partitions[1].partID = 34;
+            nif.SetShapePartitions(shape, partitions, triParts);
+            nif.UpdateSkinPartitions(shape);
+        }
+    }
+
+    std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+    NifSaveOptions options;
+    options.optimize = false;
+    nif.Save(out, options);
+    return out.str();
+}
+
+Synthetic::Corpus Synthetic::generateCorpus(uint32_t meshes) {
+    const DDSFormat formats[] = {DDSFormat::BC1, DDSFormat::BC3, DDSFormat::BC5, DDSFormat::BC7, DDSFormat::RGBA8};
+
+    Corpus result;
+    for (uint32_t i = 0; i < meshes; i++) {
+        NIFSpec mesh;
+        mesh.shapes = 1 + i % 8;
+        mesh.verticesPerShape = 256u << (i % 4);
+        mesh.texturesPerShape = 1;
+        mesh.seed = i;
+        const std::string nif = generateNIF(mesh);
+        result.paths.push_back("meshes\\bench\\" + std::to_string(i) + ".nif");
+        result.files.emplace_back(nif.begin(), nif.end());
+
+        DDSSpec texture;
+        texture.width = texture.height = 256u << (i % 3);
+        texture.format = formats[i % 5];
+        texture.alpha = (i / 5) % 2 == 1;
+        texture.seed = i;
+        result.paths.push_back(texturePath(i, 0, 0));
+        result.files.push_back(generateDDS(texture));
+    }
+    for (const auto &file : result.files) {
+        result.bytes += file.size();
+    }
+    return result;
+}
@@ -0,0 +1,73 @@
+#ifndef STO_BENCH_SYNTHETIC_H
+#define STO_BENCH_SYNTHETIC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief Deterministic inputs for sto_bench. The same spec and seed always give the same bytes, so runs on
+ * different machines and commits measure the same work.
+ */
+namespace Synthetic {
+    enum class DDSFormat {
+        BC1, // DXT1
+        BC3, // DXT5
+        BC5, // ATI2, as used by normal maps
+        BC7, // DX10 header, mode 6 blocks
+        RGBA8,
+    };
+
+    const char *formatName(DDSFormat format);
+
+    struct DDSSpec {
+        uint32_t width = 1024;
+        uint32_t height = 1024;
+        DDSFormat format = DDSFormat::BC7;
+        bool alpha = false;
+        bool mipmaps = true; // full chain down to 1x1
+        uint64_t seed = 1;
+    };
+
+    /*!
+     * \brief A complete .dds file. Blocks are built directly from a smooth colour field with some noise, so it
+     * costs no encoder time and decodes to something closer to a real texture than random bytes
+     */
+    std::vector<uint8_t> generateDDS(const DDSSpec &spec);
+
+    //! \brief The pixels of an RGBA8 generateDDS without mipmaps, 4 bytes per pixel with no header
+    std::vector<uint8_t> generateRGBA(uint32_t width, uint32_t height, bool alpha, uint64_t seed = 1);
+
+    struct NIFSpec {
+        uint32_t shapes = 8;
+        uint32_t verticesPerShape = 1024; // rounded down to a square grid, at most 182x182
+        uint32_t texturesPerShape = 2; // diffuse, normal, then the other slots in order, up to 9
+        uint32_t extraNodes = 0; // empty NiNodes, to vary the block count independently of the geometry
+        bool skinned = false; // two bones blended across each sheet, left and right halves in separate partitions
+        bool seam = false; // the right half uses its own copy of the middle column, duplicates for welding to find
+        uint64_t seed = 1;
+    };
+
+    /*!
+     * \brief A Skyrim SE .nif with BSTriShapes, each with a BSLightingShaderProperty and texture set. Texture paths
+     * are textures\\bench\\<seed>\\<shape>_<slot>.dds
+     */
+    std::string generateNIF(const NIFSpec &spec);
+
+    //! \brief Path of the texture generateNIF puts in a slot, as stored in the texture set
+    std::string texturePath(uint64_t seed, uint32_t shape, uint32_t slot);
+
+    struct Corpus {
+        std::vector<std::string> paths; // inside the data folder, meshes\\... and textures\\...
+        std::vector<std::vector<uint8_t>> files;
+        uint64_t bytes = 0;
+    };
+
+    /*!
+     * \brief A mod sized mix of meshes and textures: every mesh has one to eight shapes and its own diffuse texture,
+     * cycling through the sizes 256 to 1024, every format and with or without alpha
+     */
+    Corpus generateCorpus(uint32_t meshes);
+}
+
+#endif //STO_BENCH_SYNTHETIC_H
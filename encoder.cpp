@@ -0,0 +1,263 @@
+#include "encoder.h"
+
+#ifdef _WIN32
+#include "encoder_dxtex.h"
+#else
+#include "libs/DirectXTex/BCFast.h"
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+#ifdef _WIN32
+    class CPUEncoderSession final : public EncoderSession {
+    public:
+        bool compress(const EncoderImage *images, size_t nimages, Format format, const EncodedImage *results) override {
+            const DWORD flags = softwareCompressFlags(format, _quality);
+            for (size_t i = 0; i < nimages; i++) {
+                DirectX::ScratchImage encoded;
+                const HRESULT hr = Compress(dxtexImage(images[i]),
+                                            dxgiFormat(format),
+                                            flags,
+                                            DirectX::TEX_THRESHOLD_DEFAULT,
+                                            encoded);
+                if (FAILED(hr)) {
+                    return false;
+                }
+                copyBlocks(*encoded.GetImage(0, 0, 0), results[i]);
+            }
+            return true;
+        }
+
+        [[nodiscard]] bool prefersStreaming() const override {
+            return true;
+        }
+    };
+#else
+    // Where the encoders take their texels: 4 bytes per texel, edges repeated into partial blocks
+    void gatherBlock(const EncoderImage &image, size_t bx, size_t by, uint8_t *block) {
+        for (size_t y = 0; y < 4; y++) {
+            const uint8_t *row = image.pixels + std::min(by * 4 + y, image.height - 1) * image.rowPitch;
+            for (size_t x = 0; x < 4; x++) {
+                std::memcpy(block + (y * 4 + x) * 4, row + std::min(bx * 4 + x, image.width - 1) * 4, 4);
+            }
+        }
+    }
+
+    void encodeBlockRow(const EncoderImage &image, size_t by, EncoderSession::Format format, bool exhaustive,
+                        uint8_t *dest) {
+        const size_t blocksWide = (image.width + 3) / 4;
+        uint8_t block[BCFast::NUM_PIXELS_PER_BLOCK * 4];
+
+        if (format == EncoderSession::Format::BC1 || format == EncoderSession::Format::BC3) {
+            for (size_t bx = 0; bx < blocksWide; bx++) {
+                gatherBlock(image, bx, by, block);
+                if (format == EncoderSession::Format::BC1) {
+                    // Keyed below half alpha, like DirectXTex's default threshold
+                    BCFast::EncodeBC1(dest + bx * 8, block, 128);
+                } else {
+                    BCFast::EncodeBC3(dest + bx * 16, block);
+                }
+            }
+            return;
+        }
+
+        // BC4 and BC5 take the whole row of blocks in one call, one plane per channel
+        std::vector<uint8_t> red(blocksWide * BCFast::NUM_PIXELS_PER_BLOCK);
+        std::vector<uint8_t> green(format == EncoderSession::Format::BC5 ? red.size() : 0);
+        for (size_t bx = 0; bx < blocksWide; bx++) {
+            gatherBlock(image, bx, by, block);
+            for (size_t i = 0; i < BCFast::NUM_PIXELS_PER_BLOCK; i++) {
+                red[bx * BCFast::NUM_PIXELS_PER_BLOCK + i] = block[i * 4];
+                if (!green.empty()) {
+                    green[bx * BCFast::NUM_PIXELS_PER_BLOCK + i] = block[i * 4 + 1];
+                }
+            }
+        }
+        if (green.empty()) {
+            BCFast::EncodeBC4UBlocks(dest, red.data(), blocksWide, exhaustive);
+        } else {
+            BCFast::EncodeBC5UBlocks(dest, red.data(), green.data(), blocksWide, exhaustive);
+        }
+    }
+
+    class CPUEncoderSession final : public EncoderSession {
+    public:
+        bool compress(const EncoderImage *images, size_t nimages, Format format, const EncodedImage *results) override {
+            if (format == Format::BC7) {
+                if (!_warned) {
+                    std::cerr << "BC7 needs DirectXTex, the CPU encoder only writes BC1, BC3, BC4 and BC5 here"
+                              << std::endl;
+                    _warned = true;
+                }
+                return false;
+            }
+
+            // Best searches BC4/BC5 endpoints around the extremes for the lowest error
+            const bool exhaustive = _quality == Quality::Best;
+            for (size_t i = 0; i < nimages; i++) {
+                const EncoderImage &image = images[i];
+                const auto blocksHigh = static_cast<int>((image.height + 3) / 4);
+                // Textures are encoded one at a time, their block rows are spread over the cores instead
+#ifdef _OPENMP
+#pragma omp parallel for if (image.width * image.height >= 256 * 256)
+#endif
+                for (int by = 0; by < blocksHigh; by++) {
+                    encodeBlockRow(image, by, format, exhaustive, results[i].blocks + by * results[i].rowPitch);
+                }
+            }
+            return true;
+        }
+
+        [[nodiscard]] bool prefersStreaming() const override {
+            return true;
+        }
+
+    private:
+        bool _warned = false;
+    };
+#endif
+
+    class CPUEncoderBackend final : public EncoderBackend {
+    public:
+        [[nodiscard]] const char *name() const override {
+            return "cpu";
+        }
+
+        std::unique_ptr<EncoderSession> createSession() override {
+            return std::make_unique<CPUEncoderSession>();
+        }
+    };
+}
+
+std::unique_ptr<EncoderBackend> createCPUEncoderBackend() {
+    return std::make_unique<CPUEncoderBackend>();
+}
+
+size_t EncoderSession::blockSize(EncoderSession::Format format) {
+    return format == Format::BC1 || format == Format::BC4 ? 8 : 16;
+}
+
+const char *EncoderSession::qualityName(EncoderSession::Quality quality) {
+    switch (quality) {
+        case Quality::Fast: return "fast";
+        case Quality::Default: return "default";
+        case Quality::Best: return "best";
+        default: return "unknown";
+    }
+}
+
+bool EncoderBackend::parseType(const std::string &name, EncoderBackend::Type &type) {
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (lower == "auto") {
+        type = Type::Auto;
+    } else if (lower == "cpu") {
+        type = Type::CPU;
+    } else if (lower == "d3d11" || lower == "gpu") {
+        type = Type::D3D11;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<EncoderBackend> EncoderBackend::create(EncoderBackend::Type type, uint32_t adapter) {
+    switch (type) {
+        case Type::CPU:
+            return createCPUEncoderBackend();
+
+        case Type::D3D11:
+#ifdef _WIN32
+            return createD3D11EncoderBackend(adapter);
+#else
+            return nullptr;
+#endif
+
+        case Type::Auto:
+        default:
+#ifdef _WIN32
+            if (auto backend = createD3D11EncoderBackend(adapter)) {
+                return backend;
+            }
+            std::cerr << "No D3D11 device on adapter " << adapter << ", compressing on the CPU" << std::endl;
+#else
+            (void) adapter;
+#endif
+            return createCPUEncoderBackend();
+    }
+}
+
+#ifdef _WIN32
+DXGI_FORMAT dxgiFormat(EncoderSession::Format format) {
+    switch (format) {
+        case EncoderSession::Format::BC1: return DXGI_FORMAT_BC1_UNORM;
+        case EncoderSession::Format::BC3: return DXGI_FORMAT_BC3_UNORM;
+        case EncoderSession::Format::BC4: return DXGI_FORMAT_BC4_UNORM;
+        case EncoderSession::Format::BC5: return DXGI_FORMAT_BC5_UNORM;
+        case EncoderSession::Format::BC7: return DXGI_FORMAT_BC7_UNORM;
+        default: return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
+DWORD softwareCompressFlags(EncoderSession::Format format, EncoderSession::Quality quality) {
+    DWORD flags = DirectX::TEX_COMPRESS_DEFAULT | DirectX::TEX_FILTER_SEPARATE_ALPHA;
+#ifdef _OPENMP
+    // Textures are encoded one at a time, their blocks are spread over the cores instead
+    flags |= DirectX::TEX_COMPRESS_PARALLEL;
+#endif
+    switch (format) {
+        case EncoderSession::Format::BC1:
+        case EncoderSession::Format::BC3:
+            // The integer encoder works on the 8-bit texels, the float one refines every block in HDRColorA
+            if (quality == EncoderSession::Quality::Fast) {
+                flags |= DirectX::TEX_COMPRESS_BC13_FAST;
+            }
+            break;
+        case EncoderSession::Format::BC4:
+        case EncoderSession::Format::BC5:
+            // Default keeps the float endpoint fit, Best searches endpoints around the extremes for the lowest error
+            if (quality == EncoderSession::Quality::Fast) {
+                flags |= DirectX::TEX_COMPRESS_BC45_FAST;
+            } else if (quality == EncoderSession::Quality::Best) {
+                flags |= DirectX::TEX_COMPRESS_BC45_FAST | DirectX::TEX_COMPRESS_BC45_EXHAUSTIVE;
+            }
+            break;
+        case EncoderSession::Format::BC7:
+            // Quick only tries mode 6, the 3 subset modes 0 and 2 are skipped unless asked for
+            if (quality == EncoderSession::Quality::Fast) {
+                flags |= DirectX::TEX_COMPRESS_BC7_QUICK;
+            } else if (quality == EncoderSession::Quality::Best) {
+                flags |= DirectX::TEX_COMPRESS_BC7_USE_3SUBSETS;
+            }
+            break;
+        default:
+            break;
+    }
+    return flags;
+}
+
+DirectX::Image dxtexImage(const EncoderImage &image) {
+    DirectX::Image result{};
+    result.width = image.width;
+    result.height = image.height;
+    result.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    result.rowPitch = image.rowPitch;
+    result.slicePitch = image.rowPitch * image.height;
+    // DirectXTex only reads its source, Image has no const pixels
+    result.pixels = const_cast<uint8_t *>(image.pixels);
+    return result;
+}
+
+void copyBlocks(const DirectX::Image &encoded, const EncodedImage &result) {
+    const size_t blockRows = std::max<size_t>(1, (encoded.height + 3) / 4);
+    for (size_t row = 0; row < blockRows; row++) {
+        std::memcpy(result.blocks + row * result.rowPitch, encoded.pixels + row * encoded.rowPitch, encoded.rowPitch);
+    }
+}
+#endif
@@ -0,0 +1,129 @@
+#ifndef STO_ENCODER_H
+#define STO_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/*!
+ * \brief An uncompressed image handed to an encoder, 4 bytes per pixel in R, G, B, A order
+ */
+struct EncoderImage {
+    size_t width;
+    size_t height;
+    size_t rowPitch;
+    const uint8_t *pixels;
+};
+
+/*!
+ * \brief Where an encoder writes the blocks of one image, rows of 4x4 blocks rowPitch bytes apart
+ */
+struct EncodedImage {
+    size_t rowPitch;
+    uint8_t *blocks;
+};
+
+/*!
+ * \brief Compression context owned by a single worker thread. Sessions are created once per worker
+ * and reused for every texture that worker handles; they are not thread safe.
+ */
+class EncoderSession {
+public:
+    //! \brief Block compressed formats, all UNORM
+    enum class Format {
+        BC1,
+        BC3,
+        BC4,
+        BC5,
+        BC7,
+    };
+
+    /*!
+     * \brief Compression speed against quality. Fast takes the integer encoders for BC1 to BC5 and BC7's quick mode,
+     * Best the widened BC4/BC5 endpoint search and BC7's 3 subset modes
+     */
+    enum class Quality {
+        Fast,
+        Default,
+        Best,
+    };
+
+    virtual ~EncoderSession() = default;
+
+    //! \brief Used by the following compress calls, Default until changed
+    void setQuality(Quality quality) {
+        _quality = quality;
+    }
+
+    [[nodiscard]] Quality quality() const {
+        return _quality;
+    }
+
+    static const char *qualityName(Quality quality);
+
+    //! \brief Bytes per 4x4 block, 8 for BC1 and BC4, 16 for the others
+    static size_t blockSize(Format format);
+
+    /*!
+     * \brief Compress images, each into the result at the same index
+     * \return False if an error happens or the format isn't supported
+     */
+    virtual bool compress(const EncoderImage *images, size_t nimages, Format format, const EncodedImage *results) = 0;
+
+    /*!
+     * \brief True if this session compresses on the CPU, so the streamed resize/mipmap/compress path applies
+     */
+    [[nodiscard]] virtual bool prefersStreaming() const = 0;
+
+protected:
+    Quality _quality = Quality::Default;
+};
+
+class EncoderBackend {
+public:
+    enum class Type {
+        Auto,
+        CPU,
+        D3D11,
+    };
+
+    virtual ~EncoderBackend() = default;
+
+    [[nodiscard]] virtual const char *name() const = 0;
+
+    /*!
+     * \brief Create a session for the calling worker thread
+     * \return nullptr if the backend can't run on this thread
+     */
+    virtual std::unique_ptr<EncoderSession> createSession() = 0;
+
+    /*!
+     * \brief Parse "auto", "cpu" or "d3d11"
+     * \return False if the name is unknown
+     */
+    static bool parseType(const std::string &name, Type &type);
+
+    /*!
+     * \brief Create the backend for type. Auto uses D3D11 when a device can be created on adapter and the CPU otherwise
+     * \return nullptr if the requested backend is unavailable
+     */
+    static std::unique_ptr<EncoderBackend> create(Type type, uint32_t adapter);
+};
+
+/*!
+ * \brief Encodes on the CPU; needs no COM, D3D or GPU. On Windows DirectXTex's codecs handle every format.
+ * Elsewhere only the integer BC1, BC3, BC4 and BC5 encoders are built and BC7 fails. The texture pipeline writes
+ * BC7, so off Windows this backend is not a working pipeline backend, it serves sto_bench and BC1 to BC5 callers
+ */
+std::unique_ptr<EncoderBackend> createCPUEncoderBackend();
+
+#ifdef _WIN32
+/*!
+ * \brief Encodes BC7 with DirectCompute on adapter, other formats on the CPU
+ * \return nullptr if no suitable device can be created
+ */
+std::unique_ptr<EncoderBackend> createD3D11EncoderBackend(uint32_t adapter);
+#endif
+
+#endif //STO_ENCODER_H
@@ -0,0 +1,183 @@
+#ifdef _WIN32
+
+#include <d3d11.h>
+#include <dxgi.h>
+#include <wrl/client.h>
+
+#include "encoder_dxtex.h"
+
+#include <iostream>
+#include <system_error>
+#include <utility>
+
+namespace {
+    bool getDXGIFactory(IDXGIFactory1 **pFactory) {
+        if (!pFactory)
+            return false;
+
+        *pFactory = nullptr;
+
+        typedef HRESULT(WINAPI *pfn_CreateDXGIFactory1)(REFIID riid, _Out_ void **ppFactory);
+
+        static pfn_CreateDXGIFactory1 sCreateDXGIFactory1 = nullptr;
+
+        if (!sCreateDXGIFactory1) {
+            const HMODULE hModDXGI = LoadLibraryW(L"dxgi.dll");
+            if (!hModDXGI)
+                return false;
+
+            sCreateDXGIFactory1 = reinterpret_cast<pfn_CreateDXGIFactory1>(
+                    reinterpret_cast<void *>(GetProcAddress(hModDXGI, "CreateDXGIFactory1")));
+            if (!sCreateDXGIFactory1)
+                return false;
+        }
+
+        return SUCCEEDED(sCreateDXGIFactory1(IID_PPV_ARGS(pFactory)));
+    }
+
+    bool createDevice(const uint32_t adapter, ID3D11Device **pDevice) {
+        if (!pDevice)
+            return false;
+
+        *pDevice = nullptr;
+
+        static PFN_D3D11_CREATE_DEVICE s_DynamicD3D11CreateDevice = nullptr;
+
+        if (!s_DynamicD3D11CreateDevice) {
+            const HMODULE hModD3D11 = LoadLibraryW(L"d3d11.dll");
+            if (!hModD3D11)
+                return false;
+
+            s_DynamicD3D11CreateDevice = reinterpret_cast<PFN_D3D11_CREATE_DEVICE>(
+                    reinterpret_cast<void *>(GetProcAddress(hModD3D11, "D3D11CreateDevice")));
+            if (!s_DynamicD3D11CreateDevice)
+                return false;
+        }
+
+        D3D_FEATURE_LEVEL featureLevels[] = {
+                D3D_FEATURE_LEVEL_11_0,
+                D3D_FEATURE_LEVEL_10_1,
+                D3D_FEATURE_LEVEL_10_0,
+        };
+
+        const UINT createDeviceFlags = 0;
+
+        Microsoft::WRL::ComPtr<IDXGIAdapter> pAdapter;
+        Microsoft::WRL::ComPtr<IDXGIFactory1> dxgiFactory;
+        if (getDXGIFactory(dxgiFactory.GetAddressOf())) {
+            if (FAILED(dxgiFactory->EnumAdapters(adapter, pAdapter.GetAddressOf()))) {
+                return false;
+            }
+        }
+
+        D3D_FEATURE_LEVEL fl;
+        HRESULT hr = s_DynamicD3D11CreateDevice(pAdapter.Get(),
+                                                (pAdapter) ? D3D_DRIVER_TYPE_UNKNOWN : D3D_DRIVER_TYPE_HARDWARE,
+                                                nullptr,
+                                                createDeviceFlags,
+                                                featureLevels,
+                                                _countof(featureLevels),
+                                                D3D11_SDK_VERSION,
+                                                pDevice,
+                                                &fl,
+                                                nullptr);
+        if (SUCCEEDED(hr)) {
+            if (fl < D3D_FEATURE_LEVEL_11_0) {
+                D3D11_FEATURE_DATA_D3D10_X_HARDWARE_OPTIONS hwopts;
+                hr = (*pDevice)->CheckFeatureSupport(D3D11_FEATURE_D3D10_X_HARDWARE_OPTIONS, &hwopts, sizeof(hwopts));
+                if (FAILED(hr))
+                    memset(&hwopts, 0, sizeof(hwopts));
+
+                if (!hwopts.ComputeShaders_Plus_RawAndStructuredBuffers_Via_Shader_4_x) {
+                    if (*pDevice) {
+                        (*pDevice)->Release();
+                        *pDevice = nullptr;
+                    }
+                    hr = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                }
+            }
+        }
+
+        if (SUCCEEDED(hr)) {
+            Microsoft::WRL::ComPtr<IDXGIDevice> dxgiDevice;
+            hr = (*pDevice)->QueryInterface(IID_PPV_ARGS(dxgiDevice.GetAddressOf()));
+
+            return SUCCEEDED(hr);
+        }
+        std::cerr << "Failed to create GPU device: " << std::system_category().message(hr) << std::endl;
+        return false;
+    }
+
+    class D3D11EncoderSession final : public EncoderSession {
+    public:
+        explicit D3D11EncoderSession(Microsoft::WRL::ComPtr<ID3D11Device> device) : _pDevice(std::move(device)) {}
+
+        bool compress(const EncoderImage *images, size_t nimages, Format format, const EncodedImage *results) override {
+            for (size_t i = 0; i < nimages; i++) {
+                DirectX::ScratchImage encoded;
+                HRESULT hr;
+                if (format == Format::BC7) {
+                    // The shaders have no quick mode, Fast only skips the 3 subset modes and Best is the default
+                    hr = Compress(_pDevice.Get(),
+                                  dxtexImage(images[i]),
+                                  dxgiFormat(format),
+                                  _quality == Quality::Fast ? DirectX::TEX_COMPRESS_DEFAULT
+                                                            : DirectX::TEX_COMPRESS_BC7_USE_3SUBSETS,
+                                  1.f,
+                                  encoded);
+                } else {
+                    // DirectCompute only covers BC6H/BC7
+                    hr = Compress(dxtexImage(images[i]),
+                                  dxgiFormat(format),
+                                  softwareCompressFlags(format, _quality),
+                                  DirectX::TEX_THRESHOLD_DEFAULT,
+                                  encoded);
+                }
+                if (FAILED(hr)) {
+                    return false;
+                }
+                copyBlocks(*encoded.GetImage(0, 0, 0), results[i]);
+            }
+            return true;
+        }
+
+        [[nodiscard]] bool prefersStreaming() const override {
+            return false;
+        }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D11Device> _pDevice;
+    };
+
+    class D3D11EncoderBackend final : public EncoderBackend {
+    public:
+        explicit D3D11EncoderBackend(uint32_t adapter) : _adapter(adapter) {}
+
+        [[nodiscard]] const char *name() const override {
+            return "d3d11";
+        }
+
+        std::unique_ptr<EncoderSession> createSession() override {
+            // Each worker gets its own device, the immediate context can't be shared between threads
+            Microsoft::WRL::ComPtr<ID3D11Device> device;
+            if (!createDevice(_adapter, device.GetAddressOf())) {
+                return nullptr;
+            }
+            return std::make_unique<D3D11EncoderSession>(std::move(device));
+        }
+
+    private:
+        uint32_t _adapter;
+    };
+}
+
+std::unique_ptr<EncoderBackend> createD3D11EncoderBackend(uint32_t adapter) {
+    // Probe once so a missing GPU is reported up front rather than by every worker
+    Microsoft::WRL::ComPtr<ID3D11Device> device;
+    if (!createDevice(adapter, device.GetAddressOf())) {
+        return nullptr;
+    }
+    return std::make_unique<D3D11EncoderBackend>(adapter);
+}
+
+#endif // _WIN32
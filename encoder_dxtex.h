@@ -0,0 +1,22 @@
+#ifndef STO_ENCODER_DXTEX_H
+#define STO_ENCODER_DXTEX_H
+
+#include "encoder.h"
+#include "libs/DirectXTex/DirectXTex.h"
+
+/*
+ * What the sessions built on DirectXTex share, Windows only like DirectXTex itself
+ */
+
+DXGI_FORMAT dxgiFormat(EncoderSession::Format format);
+
+//! \brief Flags for DirectXTex's software Compress at a session quality
+DWORD softwareCompressFlags(EncoderSession::Format format, EncoderSession::Quality quality);
+
+//! \brief A DirectXTex view of an image handed to a session, nothing is copied
+DirectX::Image dxtexImage(const EncoderImage &image);
+
+//! \brief Copy the blocks DirectXTex compressed into the session's result
+void copyBlocks(const DirectX::Image &encoded, const EncodedImage &result);
+
+#endif //STO_ENCODER_DXTEX_H
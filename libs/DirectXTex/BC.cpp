@@ -16,6 +16,7 @@
 //#define COLOR_AVG_0WEIGHTS
 
 #include "BC.h"
+#include "BCFast.h"
 
 using namespace DirectX;
 using namespace DirectX::PackedVector;
@@ -315,14 +316,11 @@ namespace
 
 
     //-------------------------------------------------------------------------------------
-    inline void DecodeBC1(
-        _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor,
+    inline void DecodeBC1Palette(
+        _Out_writes_(4) XMVECTOR *pPalette,
         _In_ const D3DX_BC1 *pBC,
         bool isbc1)
     {
-        assert(pColor && pBC);
-        static_assert(sizeof(D3DX_BC1) == 8, "D3DX_BC1 should be 8 bytes");
-
         static XMVECTORF32 s_Scale = { { { 1.f / 31.f, 1.f / 63.f, 1.f / 31.f, 1.f } } };
 
         XMVECTOR clr0 = XMLoadU565(reinterpret_cast<const XMU565*>(&pBC->rgb[0]));
@@ -337,31 +335,93 @@ namespace
         clr0 = XMVectorSelect(g_XMIdentityR3, clr0, g_XMSelect1110);
         clr1 = XMVectorSelect(g_XMIdentityR3, clr1, g_XMSelect1110);
 
-        XMVECTOR clr2, clr3;
+        pPalette[0] = clr0;
+        pPalette[1] = clr1;
+
         if (isbc1 && (pBC->rgb[0] <= pBC->rgb[1]))
         {
-            clr2 = XMVectorLerp(clr0, clr1, 0.5f);
-            clr3 = XMVectorZero();  // Alpha of 0
+            pPalette[2] = XMVectorLerp(clr0, clr1, 0.5f);
+            pPalette[3] = XMVectorZero();  // Alpha of 0
         }
         else
         {
-            clr2 = XMVectorLerp(clr0, clr1, 1.f / 3.f);
-            clr3 = XMVectorLerp(clr0, clr1, 2.f / 3.f);
+            pPalette[2] = XMVectorLerp(clr0, clr1, 1.f / 3.f);
+            pPalette[3] = XMVectorLerp(clr0, clr1, 2.f / 3.f);
         }
+    }
+
+    inline void DecodeBC1(
+        _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor,
+        _In_ const D3DX_BC1 *pBC,
+        bool isbc1)
+    {
+        assert(pColor && pBC);
+        static_assert(sizeof(D3DX_BC1) == 8, "D3DX_BC1 should be 8 bytes");
+
+        XMVECTOR clr[4];
+        DecodeBC1Palette(clr, pBC, isbc1);
 
         uint32_t dw = pBC->bitmap;
 
         for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 2)
         {
-            switch (dw & 3)
-            {
-            case 0: pColor[i] = clr0; break;
-            case 1: pColor[i] = clr1; break;
-            case 2: pColor[i] = clr2; break;
+            pColor[i] = clr[dw & 3];
+        }
+    }
 
-            case 3:
-            default: pColor[i] = clr3; break;
-            }
+
+    //-------------------------------------------------------------------------------------
+    // Decoding straight to 8-bit RGBA. Palettes are computed as above and quantized the
+    // way _StoreScanline writes DXGI_FORMAT_R8G8B8A8_UNORM, so the bytes are identical.
+    //-------------------------------------------------------------------------------------
+    inline XMUBYTEN4 QuantizeRGBA8(FXMVECTOR v)
+    {
+        static const XMVECTORF32 s_Bias = { { { 0.5f / 255.f, 0.5f / 255.f, 0.5f / 255.f, 0.5f / 255.f } } };
+
+        XMUBYTEN4 result;
+        XMStoreUByteN4(&result, XMVectorAdd(v, s_Bias));
+        return result;
+    }
+
+    inline void DecodeBC1Fast(
+        _Out_writes_(NUM_PIXELS_PER_BLOCK * 4) uint8_t *pRGBA,
+        _In_ const D3DX_BC1 *pBC,
+        bool isbc1)
+    {
+        assert(pRGBA && pBC);
+
+        XMVECTOR clr[4];
+        DecodeBC1Palette(clr, pBC, isbc1);
+
+        XMUBYTEN4 palette[4];
+        for (size_t i = 0; i < 4; ++i)
+            palette[i] = QuantizeRGBA8(clr[i]);
+
+        uint32_t dw = pBC->bitmap;
+
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 2)
+        {
+            memcpy(pRGBA + i * 4, &palette[dw & 3], 4);
+        }
+    }
+
+    inline void DecodeBC3AlphaPalette(_Out_writes_(8) float *pAlpha, _In_ const D3DX_BC3 *pBC)
+    {
+        pAlpha[0] = static_cast<float>(pBC->alpha[0]) * (1.0f / 255.0f);
+        pAlpha[1] = static_cast<float>(pBC->alpha[1]) * (1.0f / 255.0f);
+
+        if (pBC->alpha[0] > pBC->alpha[1])
+        {
+            for (size_t i = 1; i < 7; ++i)
+                pAlpha[i + 1] = (pAlpha[0] * (7 - i) + pAlpha[1] * i) * (1.0f / 7.0f);
+        }
+        else
+        {
+            for (size_t i = 1; i < 5; ++i)
+                pAlpha[i + 1] = (pAlpha[0] * (5 - i) + pAlpha[1] * i) * (1.0f / 5.0f);
+
+            pAlpha[6] = 0.0f;
+            pAlpha[7] = 1.0f;
         }
     }
 
@@ -717,6 +777,7 @@ namespace
         pBC->bitmap = 0x00000000;
     }
 #endif // COLOR_WEIGHTS
+
 }
 
 
@@ -911,23 +972,7 @@ void DirectX::D3DXDecodeBC3(XMVECTOR *pColor, const uint8_t *pBC)
 
     // Adaptive 3-bit alpha part
     float fAlpha[8];
-
-    fAlpha[0] = static_cast<float>(pBC3->alpha[0]) * (1.0f / 255.0f);
-    fAlpha[1] = static_cast<float>(pBC3->alpha[1]) * (1.0f / 255.0f);
-
-    if (pBC3->alpha[0] > pBC3->alpha[1])
-    {
-        for (size_t i = 1; i < 7; ++i)
-            fAlpha[i + 1] = (fAlpha[0] * (7 - i) + fAlpha[1] * i) * (1.0f / 7.0f);
-    }
-    else
-    {
-        for (size_t i = 1; i < 5; ++i)
-            fAlpha[i + 1] = (fAlpha[0] * (5 - i) + fAlpha[1] * i) * (1.0f / 5.0f);
-
-        fAlpha[6] = 0.0f;
-        fAlpha[7] = 1.0f;
-    }
+    DecodeBC3AlphaPalette(fAlpha, pBC3);
 
     DWORD dw = uint32_t(pBC3->bitmap[0]) | uint32_t(pBC3->bitmap[1] << 8) | uint32_t(pBC3->bitmap[2] << 16);
 
@@ -1139,3 +1184,96 @@ void DirectX::D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
         pBC3->bitmap[2 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[2];
     }
 }
+
+
+//-------------------------------------------------------------------------------------
+// BC1/BC3 Compression from 8-bit RGBA
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC1Fast(uint8_t *pBC, const uint8_t *pRGBA, float threshold, DWORD flags)
+{
+    UNREFERENCED_PARAMETER(flags);
+    assert(pBC && pRGBA);
+
+    // Same test as EncodeBC1: a pixel is keyed when alpha / 255 < threshold
+    const int alphaRef = static_cast<int>(ceilf(threshold * 255.0f));
+
+    BCFast::EncodeBC1(pBC, pRGBA, alphaRef);
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC3Fast(uint8_t *pBC, const uint8_t *pRGBA, DWORD flags)
+{
+    UNREFERENCED_PARAMETER(flags);
+    assert(pBC && pRGBA);
+
+    BCFast::EncodeBC3(pBC, pRGBA);
+}
+
+
+//-------------------------------------------------------------------------------------
+// BC1/BC2/BC3 Decompression to 8-bit RGBA
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC1Fast(uint8_t *pRGBA, const uint8_t *pBC)
+{
+    auto pBC1 = reinterpret_cast<const D3DX_BC1 *>(pBC);
+    DecodeBC1Fast(pRGBA, pBC1, true);
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC2Fast(uint8_t *pRGBA, const uint8_t *pBC)
+{
+    assert(pRGBA && pBC);
+    static_assert(sizeof(D3DX_BC2) == 16, "D3DX_BC2 should be 16 bytes");
+
+    // Every 4-bit alpha value, quantized like the float path
+    static const struct BC2AlphaTable
+    {
+        uint8_t value[16];
+
+        BC2AlphaTable()
+        {
+            for (size_t i = 0; i < 16; ++i)
+                value[i] = QuantizeRGBA8(XMVectorReplicate(static_cast<float>(i) * (1.0f / 15.0f))).w;
+        }
+    } s_alpha;
+
+    auto pBC2 = reinterpret_cast<const D3DX_BC2 *>(pBC);
+
+    // RGB part
+    DecodeBC1Fast(pRGBA, &pBC2->bc1, false);
+
+    // 4-bit alpha part
+    uint64_t dw = uint64_t(pBC2->bitmap[0]) | (uint64_t(pBC2->bitmap[1]) << 32);
+
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 4)
+        pRGBA[i * 4 + 3] = s_alpha.value[dw & 0xf];
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC3Fast(uint8_t *pRGBA, const uint8_t *pBC)
+{
+    assert(pRGBA && pBC);
+    static_assert(sizeof(D3DX_BC3) == 16, "D3DX_BC3 should be 16 bytes");
+
+    auto pBC3 = reinterpret_cast<const D3DX_BC3 *>(pBC);
+
+    // RGB part
+    DecodeBC1Fast(pRGBA, &pBC3->bc1, false);
+
+    // Adaptive 3-bit alpha part
+    float fAlpha[8];
+    DecodeBC3AlphaPalette(fAlpha, pBC3);
+
+    const XMUBYTEN4 lo = QuantizeRGBA8(XMVectorSet(fAlpha[0], fAlpha[1], fAlpha[2], fAlpha[3]));
+    const XMUBYTEN4 hi = QuantizeRGBA8(XMVectorSet(fAlpha[4], fAlpha[5], fAlpha[6], fAlpha[7]));
+    const uint8_t alpha[8] = { lo.x, lo.y, lo.z, lo.w, hi.x, hi.y, hi.z, hi.w };
+
+    uint64_t dw = 0;
+    for (size_t i = 0; i < 6; ++i)
+        dw |= uint64_t(pBC3->bitmap[i]) << (8 * i);
+
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 3)
+        pRGBA[i * 4 + 3] = alpha[dw & 0x7];
+}
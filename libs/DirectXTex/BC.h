@@ -36,6 +36,9 @@ enum BC_FLAGS
     BC_FLAGS_UNIFORM            = 0x40000,  // By default, uses perceptual weighting for BC1-3; this flag makes it a uniform weighting
     BC_FLAGS_USE_3SUBSETS       = 0x80000,  // By default, BC7 skips mode 0 & 2; this flag adds those modes back
     BC_FLAGS_FORCE_BC7_MODE6    = 0x100000, // BC7 should only use mode 6; skip other modes
+    BC_FLAGS_FAST_BC13          = 0x200000, // BC1/BC3 use the integer encoder on 8-bit RGBA input (see D3DXEncodeBC1Fast)
+    BC_FLAGS_FAST_BC45          = 0x400000, // BC4U/BC5U use the integer encoder on 8-bit input (see D3DXEncodeBC4UBlocks)
+    BC_FLAGS_BC45_EXHAUSTIVE    = 0x800000, // Integer BC4U/BC5U encoder tries endpoints up to 16 values inside the block extremes
 };
 
 //-------------------------------------------------------------------------------------
@@ -296,6 +299,7 @@ template <bool bRange> void OptimizeAlpha(float *pX, float *pY, const float *pPo
 //-------------------------------------------------------------------------------------
 
 typedef void (*BC_DECODE)(XMVECTOR *pColor, const uint8_t *pBC);
+typedef void (*BC_DECODE_FAST)(uint8_t *pOut, const uint8_t *pBC);
 typedef void (*BC_ENCODE)(uint8_t *pDXT, const XMVECTOR *pColor, DWORD flags);
 
 void D3DXDecodeBC1(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(8) const uint8_t *pBC);
@@ -309,6 +313,14 @@ void D3DXDecodeBC6HU(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_re
 void D3DXDecodeBC6HS(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 void D3DXDecodeBC7(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 
+void D3DXDecodeBC1Fast(_Out_writes_(NUM_PIXELS_PER_BLOCK * 4) uint8_t *pRGBA, _In_reads_(8) const uint8_t *pBC);
+void D3DXDecodeBC2Fast(_Out_writes_(NUM_PIXELS_PER_BLOCK * 4) uint8_t *pRGBA, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC3Fast(_Out_writes_(NUM_PIXELS_PER_BLOCK * 4) uint8_t *pRGBA, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC4UFast(_Out_writes_(NUM_PIXELS_PER_BLOCK) uint8_t *pRed, _In_reads_(8) const uint8_t *pBC);
+void D3DXDecodeBC5UFast(_Out_writes_(NUM_PIXELS_PER_BLOCK * 2) uint8_t *pRG, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC7Fast(_Out_writes_(NUM_PIXELS_PER_BLOCK * 4) uint8_t *pRGBA, _In_reads_(16) const uint8_t *pBC);
+    // Decode to the bytes the float decoders above produce once stored as R8G8B8A8_UNORM (R8_UNORM for BC4U, R8G8_UNORM for BC5U)
+
 void D3DXEncodeBC1(_Out_writes_(8) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ float threshold, _In_ DWORD flags);
     // BC1 requires one additional parameter, so it doesn't match signature of BC_ENCODE above
 
@@ -322,4 +334,12 @@ void D3DXEncodeBC6HU(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BL
 void D3DXEncodeBC6HS(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ DWORD flags);
 void D3DXEncodeBC7(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ DWORD flags);
 
+void D3DXEncodeBC1Fast(_Out_writes_(8) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * 4) const uint8_t *pRGBA, _In_ float threshold, _In_ DWORD flags);
+void D3DXEncodeBC3Fast(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * 4) const uint8_t *pRGBA, _In_ DWORD flags);
+    // Integer PCA + least-squares encoders for R8G8B8A8 blocks; no dithering, uniform channel weighting
+
+void D3DXEncodeBC4UBlocks(_Out_writes_(nBlocks * 8) uint8_t *pBC, _In_reads_(nBlocks * NUM_PIXELS_PER_BLOCK) const uint8_t *pRed, _In_ size_t nBlocks, _In_ DWORD flags);
+void D3DXEncodeBC5UBlocks(_Out_writes_(nBlocks * 16) uint8_t *pBC, _In_reads_(nBlocks * NUM_PIXELS_PER_BLOCK) const uint8_t *pRed, _In_reads_(nBlocks * NUM_PIXELS_PER_BLOCK) const uint8_t *pGreen, _In_ size_t nBlocks, _In_ DWORD flags);
+    // Integer encoders for runs of blocks; each block is 16 consecutive 8-bit texels in raster order
+
 } // namespace
@@ -12,6 +12,7 @@
 #include "DirectXTexP.h"
 
 #include "BC.h"
+#include "BCFast.h"
 
 using namespace DirectX;
 
@@ -560,3 +561,69 @@ void DirectX::D3DXEncodeBC5S(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
     FindClosestSNORM(pBCR, theTexelsU);
     FindClosestSNORM(pBCG, theTexelsV);
 }
+
+
+//-------------------------------------------------------------------------------------
+// BC4/BC5 Compression from 8-bit UNORM texels
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC4UBlocks(uint8_t *pBC, const uint8_t *pRed, size_t nBlocks, DWORD flags)
+{
+    assert(pBC && pRed);
+
+    BCFast::EncodeBC4UBlocks(pBC, pRed, nBlocks, (flags & BC_FLAGS_BC45_EXHAUSTIVE) != 0);
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC5UBlocks(uint8_t *pBC, const uint8_t *pRed, const uint8_t *pGreen, size_t nBlocks, DWORD flags)
+{
+    assert(pBC && pRed && pGreen);
+
+    BCFast::EncodeBC5UBlocks(pBC, pRed, pGreen, nBlocks, (flags & BC_FLAGS_BC45_EXHAUSTIVE) != 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+// BC4/BC5 Decompression to 8-bit UNORM
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC4UFast(uint8_t *pRed, const uint8_t *pBC)
+{
+    assert(pRed && pBC);
+    static_assert(sizeof(BC4_UNORM) == 8, "BC4_UNORM should be 8 bytes");
+
+    auto pBC4 = reinterpret_cast<const BC4_UNORM*>(pBC);
+
+    // Quantized as _StoreScanline writes DXGI_FORMAT_R8_UNORM
+    uint8_t palette[8];
+    for (size_t i = 0; i < 8; ++i)
+    {
+        float v = pBC4->DecodeFromIndex(i);
+        v = std::max<float>(std::min<float>(v, 1.f), 0.f);
+        palette[i] = static_cast<uint8_t>(v * 255.f);
+    }
+
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        pRed[i] = palette[pBC4->GetIndex(i)];
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC5UFast(uint8_t *pRG, const uint8_t *pBC)
+{
+    assert(pRG && pBC);
+    static_assert(sizeof(BC4_UNORM) == 8, "BC4_UNORM should be 8 bytes");
+
+    auto pBCR = reinterpret_cast<const BC4_UNORM*>(pBC);
+    auto pBCG = reinterpret_cast<const BC4_UNORM*>(pBC + sizeof(BC4_UNORM));
+
+    // Quantized as _StoreScanline writes DXGI_FORMAT_R8G8_UNORM
+    PackedVector::XMUBYTEN2 palette[8];
+    for (size_t i = 0; i < 8; ++i)
+        PackedVector::XMStoreUByteN2(&palette[i], XMVectorSet(pBCR->DecodeFromIndex(i), pBCG->DecodeFromIndex(i), 0, 1.0f));
+
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        pRG[i * 2] = palette[pBCR->GetIndex(i)].x;
+        pRG[i * 2 + 1] = palette[pBCG->GetIndex(i)].y;
+    }
+}
@@ -761,6 +761,7 @@ namespace
     {
     public:
         void Decode(_Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA* pOut) const;
+        void Decode(_Out_writes_(NUM_PIXELS_PER_BLOCK) LDRColorA* pOut) const;
         void Encode(DWORD flags, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA* const pIn);
 
     private:
@@ -1634,6 +1635,18 @@ namespace
 #else
             // In production use, default to black
             pOut[i] = HDRColorA(0.0f, 0.0f, 0.0f, 1.0f);
+#endif
+        }
+    }
+
+    void FillWithErrorColors(_Out_writes_(NUM_PIXELS_PER_BLOCK) LDRColorA* pOut)
+    {
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+#ifdef _DEBUG
+            pOut[i] = LDRColorA(255, 0, 255, 255);
+#else
+            pOut[i] = LDRColorA(0, 0, 0, 255);
 #endif
         }
     }
@@ -2521,6 +2534,19 @@ void D3DX_BC7::Decode(HDRColorA* pOut) const
 {
     assert(pOut);
 
+    // BC7 is an 8-bit format; decode to LDR and widen
+    LDRColorA ldr[NUM_PIXELS_PER_BLOCK];
+    Decode(ldr);
+
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        pOut[i] = HDRColorA(ldr[i]);
+}
+
+_Use_decl_annotations_
+void D3DX_BC7::Decode(LDRColorA* pOut) const
+{
+    assert(pOut);
+
     size_t uFirst = 0;
     while (uFirst < 128 && !GetBit(uFirst)) {}
     uint8_t uMode = uint8_t(uFirst - 1);
@@ -2712,7 +2738,7 @@ void D3DX_BC7::Decode(HDRColorA* pOut) const
             case 3: std::swap(outPixel.b, outPixel.a); break;
             }
 
-            pOut[i] = HDRColorA(outPixel);
+            pOut[i] = outPixel;
         }
     }
     else
@@ -2721,7 +2747,7 @@ void D3DX_BC7::Decode(HDRColorA* pOut) const
         OutputDebugStringA("BC7: Reserved mode 8 encountered during decoding\n");
 #endif
         // Per the BC7 format spec, we must return transparent black
-        memset(pOut, 0, sizeof(HDRColorA) * NUM_PIXELS_PER_BLOCK);
+        memset(pOut, 0, sizeof(LDRColorA) * NUM_PIXELS_PER_BLOCK);
     }
 }
 
@@ -3557,6 +3583,19 @@ void DirectX::D3DXDecodeBC7(XMVECTOR *pColor, const uint8_t *pBC)
     reinterpret_cast<const D3DX_BC7*>(pBC)->Decode(reinterpret_cast<HDRColorA*>(pColor));
 }
 
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC7Fast(uint8_t *pRGBA, const uint8_t *pBC)
+{
+    assert(pRGBA && pBC);
+    static_assert(sizeof(D3DX_BC7) == 16, "D3DX_BC7 should be 16 bytes");
+    static_assert(sizeof(LDRColorA) == 4, "LDRColorA should be 4 bytes");
+
+    // c / 255 stored with the 8-bit bias gives back c, so the LDR result is already exact
+    LDRColorA ldr[NUM_PIXELS_PER_BLOCK];
+    reinterpret_cast<const D3DX_BC7*>(pBC)->Decode(ldr);
+    memcpy(pRGBA, ldr, sizeof(ldr));
+}
+
 _Use_decl_annotations_
 void DirectX::D3DXEncodeBC7(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 {
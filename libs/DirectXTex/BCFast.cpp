@@ -0,0 +1,926 @@
+//-------------------------------------------------------------------------------------
+// BCFast.cpp
+//
+// Integer BC1/BC3/BC4/BC5 block codecs for 8-bit input
+//
+// Licensed under the MIT License.
+//-------------------------------------------------------------------------------------
+
+#include "BCFast.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BCFAST_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace BCFast;
+
+namespace
+{
+    // Same layouts as D3DX_BC1, D3DX_BC3 and BC4_UNORM in BC.h and BC4BC5.cpp
+#pragma pack(push,1)
+    struct BC1Block
+    {
+        uint16_t    rgb[2]; // 565 colors
+        uint32_t    bitmap; // 2bpp rgb bitmap
+    };
+
+    struct BC3Block
+    {
+        uint8_t     alpha[2];   // alpha values
+        uint8_t     bitmap[6];  // 3bpp alpha bitmap
+        BC1Block    bc1;        // BC1 rgb data
+    };
+
+    struct BC4Block
+    {
+        uint8_t     red_0;
+        uint8_t     red_1;
+        uint8_t     indices[6];
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(BC1Block) == 8, "BC1Block should be 8 bytes");
+    static_assert(sizeof(BC3Block) == 16, "BC3Block should be 16 bytes");
+    static_assert(sizeof(BC4Block) == 8, "BC4Block should be 8 bytes");
+
+    //-------------------------------------------------------------------------------------
+    // Fast integer encoder for 8-bit RGBA input (BC1/BC3 colour and BC3 alpha)
+    //-------------------------------------------------------------------------------------
+    inline int Mul8Bit(int a, int b)
+    {
+        int t = a * b + 128;
+        return (t + (t >> 8)) >> 8;
+    }
+
+    inline uint16_t As565(int r, int g, int b)
+    {
+        return static_cast<uint16_t>((Mul8Bit(r, 31) << 11) | (Mul8Bit(g, 63) << 5) | Mul8Bit(b, 31));
+    }
+
+    inline void From565(uint8_t *pColor, uint16_t w565)
+    {
+        const int r = (w565 >> 11) & 31;
+        const int g = (w565 >> 5) & 63;
+        const int b = w565 & 31;
+        pColor[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+        pColor[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+        pColor[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+        pColor[3] = 0;
+    }
+
+    inline int Lerp13(int a, int b)
+    {
+        // Same rounding as the hardware 2/3 + 1/3 interpolant
+        return (a * 2 + b) / 3;
+    }
+
+    // Best endpoint pair for a solid colour, indexed by the 8-bit value; [0] is the 2/3 endpoint
+    struct SingleColorTables
+    {
+        uint8_t match5[256][2];
+        uint8_t match6[256][2];
+
+        SingleColorTables()
+        {
+            Build(match5, 32);
+            Build(match6, 64);
+        }
+
+        static void Build(uint8_t table[256][2], int size)
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                int bestErr = 256 * 100;
+                for (int mn = 0; mn < size; ++mn)
+                {
+                    for (int mx = 0; mx < size; ++mx)
+                    {
+                        const int mine = (size == 32) ? ((mn << 3) | (mn >> 2)) : ((mn << 2) | (mn >> 4));
+                        const int maxe = (size == 32) ? ((mx << 3) | (mx >> 2)) : ((mx << 2) | (mx >> 4));
+
+                        // Hardware is allowed to be within 3% of the exact interpolant, so prefer narrow pairs
+                        int err = abs(Lerp13(maxe, mine) - i) * 100 + abs(maxe - mine) * 3;
+                        if (err < bestErr)
+                        {
+                            bestErr = err;
+                            table[i][0] = static_cast<uint8_t>(mx);
+                            table[i][1] = static_cast<uint8_t>(mn);
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    const SingleColorTables& GetSingleColorTables()
+    {
+        static const SingleColorTables s_tables;
+        return s_tables;
+    }
+
+    //-------------------------------------------------------------------------------------
+    void EvalColorsFast(uint8_t *pColor, uint16_t c0, uint16_t c1)
+    {
+        From565(pColor, c0);
+        From565(pColor + 4, c1);
+        for (size_t j = 0; j < 3; ++j)
+        {
+            pColor[8 + j] = static_cast<uint8_t>(Lerp13(pColor[j], pColor[4 + j]));
+            pColor[12 + j] = static_cast<uint8_t>(Lerp13(pColor[4 + j], pColor[j]));
+        }
+        pColor[11] = pColor[15] = 0;
+    }
+
+    // Picks the nearest of the 4 palette entries for each pixel by projecting onto the endpoint axis
+    uint32_t MatchColorsBlockFast(
+        const uint8_t *pBlock,
+        const uint8_t *pColor)
+    {
+        const int dirr = pColor[0] - pColor[4];
+        const int dirg = pColor[1] - pColor[5];
+        const int dirb = pColor[2] - pColor[6];
+
+        int stops[4];
+        for (size_t i = 0; i < 4; ++i)
+            stops[i] = pColor[i * 4] * dirr + pColor[i * 4 + 1] * dirg + pColor[i * 4 + 2] * dirb;
+
+        // Palette order along the axis is 1, 3, 2, 0; compare doubled dots against the midpoints
+        const int c0Point = stops[1] + stops[3];
+        const int halfPoint = stops[3] + stops[2];
+        const int c3Point = stops[2] + stops[0];
+
+        uint32_t mask = 0;
+
+#ifdef BCFAST_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i dir = _mm_setr_epi16(
+            static_cast<short>(dirr * 2), static_cast<short>(dirg * 2), static_cast<short>(dirb * 2), 0,
+            static_cast<short>(dirr * 2), static_cast<short>(dirg * 2), static_cast<short>(dirb * 2), 0);
+        const __m128i vC0 = _mm_set1_epi32(c0Point);
+        const __m128i vHalf = _mm_set1_epi32(halfPoint);
+        const __m128i vC3 = _mm_set1_epi32(c3Point);
+
+        for (size_t g = 0; g < 4; ++g)
+        {
+            const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBlock + g * 16));
+            const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), dir);
+            const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), dir);
+
+            // Sum the (r,g) and (b,0) partial products of each pixel
+            const __m128i even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m128i odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1)));
+            const __m128i dot = _mm_add_epi32(even, odd);
+
+            const int ltHalf = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(dot, vHalf)));
+            const int ltC0 = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(dot, vC0)));
+            const int ltC3 = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(dot, vC3)));
+
+            // bit0 selects {1,3} vs {0,2}; bit1 is set for the two interpolated entries
+            const int bit0 = ltHalf;
+            const int bit1 = ltC3 & ~ltC0;
+            for (size_t i = 0; i < 4; ++i)
+            {
+                const uint32_t idx = static_cast<uint32_t>(((bit0 >> i) & 1) | (((bit1 >> i) & 1) << 1));
+                mask |= idx << ((g * 4 + i) * 2);
+            }
+        }
+#else
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            const int dot = (pBlock[i * 4] * dirr + pBlock[i * 4 + 1] * dirg + pBlock[i * 4 + 2] * dirb) * 2;
+
+            uint32_t idx;
+            if (dot < halfPoint)
+                idx = (dot < c0Point) ? 1u : 3u;
+            else
+                idx = (dot < c3Point) ? 2u : 0u;
+
+            mask |= idx << (i * 2);
+        }
+#endif
+
+        return mask;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Principal axis from the colour covariance, endpoints from the extreme projections
+    void OptimizeColorsFast(
+        const uint8_t *pBlock,
+        uint16_t *pMax16,
+        uint16_t *pMin16)
+    {
+        int mu[3], mn[3], mx[3];
+
+        for (size_t ch = 0; ch < 3; ++ch)
+        {
+            const uint8_t *bp = pBlock + ch;
+            int muv, mnv, mxv;
+            muv = mnv = mxv = bp[0];
+            for (size_t i = 4; i < 64; i += 4)
+            {
+                muv += bp[i];
+                if (bp[i] < mnv)
+                    mnv = bp[i];
+                else if (bp[i] > mxv)
+                    mxv = bp[i];
+            }
+
+            mu[ch] = (muv + 8) >> 4;
+            mn[ch] = mnv;
+            mx[ch] = mxv;
+        }
+
+        int cov[6] = {};
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            const int r = pBlock[i * 4] - mu[0];
+            const int g = pBlock[i * 4 + 1] - mu[1];
+            const int b = pBlock[i * 4 + 2] - mu[2];
+
+            cov[0] += r * r;
+            cov[1] += r * g;
+            cov[2] += r * b;
+            cov[3] += g * g;
+            cov[4] += g * b;
+            cov[5] += b * b;
+        }
+
+        float covf[6];
+        for (size_t i = 0; i < 6; ++i)
+            covf[i] = static_cast<float>(cov[i]) / 255.0f;
+
+        float vfr = static_cast<float>(mx[0] - mn[0]);
+        float vfg = static_cast<float>(mx[1] - mn[1]);
+        float vfb = static_cast<float>(mx[2] - mn[2]);
+
+        // Power iteration converges quickly for 3x3 symmetric matrices
+        for (size_t iter = 0; iter < 4; ++iter)
+        {
+            const float r = vfr * covf[0] + vfg * covf[1] + vfb * covf[2];
+            const float g = vfr * covf[1] + vfg * covf[3] + vfb * covf[4];
+            const float b = vfr * covf[2] + vfg * covf[4] + vfb * covf[5];
+
+            vfr = r;
+            vfg = g;
+            vfb = b;
+        }
+
+        float magn = std::max(std::max(fabsf(vfr), fabsf(vfg)), fabsf(vfb));
+
+        int v_r, v_g, v_b;
+        if (magn < 4.0f)
+        {
+            // Too small, default to luminance
+            v_r = 299;
+            v_g = 587;
+            v_b = 114;
+        }
+        else
+        {
+            magn = 512.0f / magn;
+            v_r = static_cast<int>(vfr * magn);
+            v_g = static_cast<int>(vfg * magn);
+            v_b = static_cast<int>(vfb * magn);
+        }
+
+        int mind = 0x7fffffff, maxd = -0x7fffffff - 1;
+        const uint8_t *minp = pBlock, *maxp = pBlock;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            const int dot = pBlock[i * 4] * v_r + pBlock[i * 4 + 1] * v_g + pBlock[i * 4 + 2] * v_b;
+
+            if (dot < mind)
+            {
+                mind = dot;
+                minp = pBlock + i * 4;
+            }
+
+            if (dot > maxd)
+            {
+                maxd = dot;
+                maxp = pBlock + i * 4;
+            }
+        }
+
+        *pMax16 = As565(maxp[0], maxp[1], maxp[2]);
+        *pMin16 = As565(minp[0], minp[1], minp[2]);
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Least-squares endpoint refit for a fixed index assignment; returns true if endpoints changed
+    bool RefineBlockFast(
+        const uint8_t *pBlock,
+        uint16_t *pMax16,
+        uint16_t *pMin16,
+        uint32_t mask)
+    {
+        static const int w1Tab[4] = { 3, 0, 2, 1 };
+
+        // xx, yy and xy packed into one accumulator, 8 bits each
+        static const int prods[4] = { 0x090000, 0x000900, 0x040102, 0x010402 };
+
+        const uint16_t oldMin = *pMin16;
+        const uint16_t oldMax = *pMax16;
+        uint16_t min16, max16;
+
+        if ((mask ^ (mask << 2)) < 4)
+        {
+            // Every pixel uses the same index, the system is singular: fit the average colour instead
+            int r = 8, g = 8, b = 8;
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                r += pBlock[i * 4];
+                g += pBlock[i * 4 + 1];
+                b += pBlock[i * 4 + 2];
+            }
+
+            r >>= 4;
+            g >>= 4;
+            b >>= 4;
+
+            const SingleColorTables& tables = GetSingleColorTables();
+            max16 = static_cast<uint16_t>((tables.match5[r][0] << 11) | (tables.match6[g][0] << 5) | tables.match5[b][0]);
+            min16 = static_cast<uint16_t>((tables.match5[r][1] << 11) | (tables.match6[g][1] << 5) | tables.match5[b][1]);
+        }
+        else
+        {
+            int At1_r = 0, At1_g = 0, At1_b = 0;
+            int At2_r = 0, At2_g = 0, At2_b = 0;
+            int akku = 0;
+
+            uint32_t cm = mask;
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, cm >>= 2)
+            {
+                const uint32_t step = cm & 3;
+                const int w1 = w1Tab[step];
+                const int r = pBlock[i * 4];
+                const int g = pBlock[i * 4 + 1];
+                const int b = pBlock[i * 4 + 2];
+
+                akku += prods[step];
+                At1_r += w1 * r;
+                At1_g += w1 * g;
+                At1_b += w1 * b;
+                At2_r += r;
+                At2_g += g;
+                At2_b += b;
+            }
+
+            At2_r = 3 * At2_r - At1_r;
+            At2_g = 3 * At2_g - At1_g;
+            At2_b = 3 * At2_b - At1_b;
+
+            const int xx = akku >> 16;
+            const int yy = (akku >> 8) & 0xff;
+            const int xy = akku & 0xff;
+
+            const float frb = 3.0f * 31.0f / 255.0f / static_cast<float>(xx * yy - xy * xy);
+            const float fg = frb * 63.0f / 31.0f;
+
+            auto clampi = [](float f, int hi) -> int
+            {
+                const auto i = static_cast<int>(f);
+                return (i < 0) ? 0 : (i > hi) ? hi : i;
+            };
+
+            max16 = static_cast<uint16_t>(
+                (clampi(static_cast<float>(At1_r * yy - At2_r * xy) * frb + 0.5f, 31) << 11)
+                | (clampi(static_cast<float>(At1_g * yy - At2_g * xy) * fg + 0.5f, 63) << 5)
+                | clampi(static_cast<float>(At1_b * yy - At2_b * xy) * frb + 0.5f, 31));
+
+            min16 = static_cast<uint16_t>(
+                (clampi(static_cast<float>(At2_r * xx - At1_r * xy) * frb + 0.5f, 31) << 11)
+                | (clampi(static_cast<float>(At2_g * xx - At1_g * xy) * fg + 0.5f, 63) << 5)
+                | clampi(static_cast<float>(At2_b * xx - At1_b * xy) * frb + 0.5f, 31));
+        }
+
+        *pMin16 = min16;
+        *pMax16 = max16;
+        return oldMin != min16 || oldMax != max16;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // 3-colour mode for colour-keyed blocks: index 3 is transparent black
+    uint32_t MatchColorsBlockKeyedFast(
+        const uint8_t *pBlock,
+        uint16_t c0,
+        uint16_t c1,
+        int alphaRef)
+    {
+        uint8_t color[8];
+        From565(color, c0);
+        From565(color + 4, c1);
+
+        const int dirr = color[4] - color[0];
+        const int dirg = color[5] - color[1];
+        const int dirb = color[6] - color[2];
+
+        const int stop0 = color[0] * dirr + color[1] * dirg + color[2] * dirb;
+        const int stop1 = color[4] * dirr + color[5] * dirg + color[6] * dirb;
+
+        // Palette order along the axis is 0, 2, 1; thresholds at the quarter points (scaled by 4)
+        const int lowPoint = stop0 * 3 + stop1;
+        const int highPoint = stop0 + stop1 * 3;
+
+        uint32_t mask = 0;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            const uint8_t *px = pBlock + i * 4;
+
+            uint32_t idx;
+            if (px[3] < alphaRef)
+            {
+                idx = 3;
+            }
+            else
+            {
+                const int dot = (px[0] * dirr + px[1] * dirg + px[2] * dirb) * 4;
+                idx = (dot < lowPoint) ? 0u : (dot < highPoint) ? 2u : 1u;
+            }
+
+            mask |= idx << (i * 2);
+        }
+
+        return mask;
+    }
+
+    //-------------------------------------------------------------------------------------
+    void EncodeBC1Fast(
+        BC1Block *pBC,
+        const uint8_t *pBlock,
+        bool bColorKey,
+        int alphaRef)
+    {
+        assert(pBC && pBlock);
+
+        uint8_t opaque[NUM_PIXELS_PER_BLOCK * 4];
+        size_t uColorKey = 0;
+
+        if (bColorKey)
+        {
+            const uint8_t *fill = nullptr;
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                if (pBlock[i * 4 + 3] < alphaRef)
+                    uColorKey++;
+                else if (!fill)
+                    fill = pBlock + i * 4;
+            }
+
+            if (NUM_PIXELS_PER_BLOCK == uColorKey)
+            {
+                pBC->rgb[0] = 0x0000;
+                pBC->rgb[1] = 0xffff;
+                pBC->bitmap = 0xffffffff;
+                return;
+            }
+
+            if (uColorKey > 0)
+            {
+                // Keyed pixels take an opaque neighbour's colour so they don't skew the axis
+                for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+                {
+                    const uint8_t *src = (pBlock[i * 4 + 3] < alphaRef) ? fill : pBlock + i * 4;
+                    memcpy(opaque + i * 4, src, 4);
+                }
+
+                uint16_t max16, min16;
+                OptimizeColorsFast(opaque, &max16, &min16);
+
+                // 3-colour mode requires c0 <= c1
+                if (max16 > min16)
+                    std::swap(max16, min16);
+
+                pBC->rgb[0] = max16;
+                pBC->rgb[1] = min16;
+                pBC->bitmap = MatchColorsBlockKeyedFast(pBlock, max16, min16, alphaRef);
+                return;
+            }
+        }
+
+        // Solid colour blocks use the single-colour tables
+        const auto *pixels = reinterpret_cast<const uint32_t*>(pBlock);
+        bool solid = true;
+        for (size_t i = 1; i < NUM_PIXELS_PER_BLOCK && solid; ++i)
+        {
+            solid = ((pixels[i] ^ pixels[0]) & 0x00ffffff) == 0;
+        }
+
+        uint16_t max16, min16;
+        uint32_t mask;
+
+        if (solid)
+        {
+            const SingleColorTables& tables = GetSingleColorTables();
+            const int r = pBlock[0], g = pBlock[1], b = pBlock[2];
+            max16 = static_cast<uint16_t>((tables.match5[r][0] << 11) | (tables.match6[g][0] << 5) | tables.match5[b][0]);
+            min16 = static_cast<uint16_t>((tables.match5[r][1] << 11) | (tables.match6[g][1] << 5) | tables.match5[b][1]);
+            mask = 0xaaaaaaaa;
+        }
+        else
+        {
+            uint8_t color[16];
+
+            OptimizeColorsFast(pBlock, &max16, &min16);
+            if (max16 != min16)
+            {
+                EvalColorsFast(color, max16, min16);
+                mask = MatchColorsBlockFast(pBlock, color);
+            }
+            else
+            {
+                mask = 0;
+            }
+
+            // Two rounds of least-squares refinement, stopping early once indices settle
+            for (size_t iter = 0; iter < 2; ++iter)
+            {
+                const uint32_t lastMask = mask;
+
+                if (RefineBlockFast(pBlock, &max16, &min16, mask))
+                {
+                    if (max16 != min16)
+                    {
+                        EvalColorsFast(color, max16, min16);
+                        mask = MatchColorsBlockFast(pBlock, color);
+                    }
+                    else
+                    {
+                        mask = 0;
+                        break;
+                    }
+                }
+
+                if (mask == lastMask)
+                    break;
+            }
+        }
+
+        // 4-colour mode requires c0 > c1
+        if (max16 < min16)
+        {
+            std::swap(max16, min16);
+            mask ^= 0x55555555;
+        }
+
+        pBC->rgb[0] = max16;
+        pBC->rgb[1] = min16;
+        pBC->bitmap = mask;
+    }
+
+    //-------------------------------------------------------------------------------------
+    void EncodeBC3AlphaFast(
+        BC3Block *pBC,
+        const uint8_t *pBlock)
+    {
+        int mn = pBlock[3];
+        int mx = mn;
+        for (size_t i = 1; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            const int a = pBlock[i * 4 + 3];
+            if (a < mn)
+                mn = a;
+            else if (a > mx)
+                mx = a;
+        }
+
+        // 8-step mode: alpha[0] > alpha[1]
+        pBC->alpha[0] = static_cast<uint8_t>(mx);
+        pBC->alpha[1] = static_cast<uint8_t>(mn);
+
+        const int dist = mx - mn;
+        const int dist4 = dist * 4;
+        const int dist2 = dist * 2;
+        int bias = (dist < 8) ? (dist - 1) : (dist / 2 + 2);
+        bias -= mn * 7;
+
+        uint64_t bits = 0;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            // Linear position between min (0) and max (7), computed branch-free
+            int a = pBlock[i * 4 + 3] * 7 + bias;
+
+            int t = (a >= dist4) ? -1 : 0;
+            int ind = t & 4;
+            a -= dist4 & t;
+
+            t = (a >= dist2) ? -1 : 0;
+            ind += t & 2;
+            a -= dist2 & t;
+
+            ind += (a >= dist) ? 1 : 0;
+
+            // Linear position to BC3 index: 0 and 1 are the endpoints
+            ind = -ind & 7;
+            ind ^= (2 > ind) ? 1 : 0;
+
+            bits |= static_cast<uint64_t>(ind) << (i * 3);
+        }
+
+        for (size_t i = 0; i < 6; ++i)
+            pBC->bitmap[i] = static_cast<uint8_t>(bits >> (i * 8));
+    }
+
+
+    //------------------------------------------------------------------------------
+    // Integer encoder for 8-bit UNORM texels, many blocks per call
+    //------------------------------------------------------------------------------
+
+    // Decoded values for a BC4U endpoint pair, rounded the way the float decoder stores back to 8 bits
+    void BuildPaletteBC4U(int16_t *pPalette, int red_0, int red_1)
+    {
+        pPalette[0] = static_cast<int16_t>(red_0);
+        pPalette[1] = static_cast<int16_t>(red_1);
+
+        if (red_0 > red_1)
+        {
+            for (int i = 1; i < 7; ++i)
+                pPalette[i + 1] = static_cast<int16_t>(((red_0 * (7 - i) + red_1 * i) * 2 + 7) / 14);
+        }
+        else
+        {
+            for (int i = 1; i < 5; ++i)
+                pPalette[i + 1] = static_cast<int16_t>(((red_0 * (5 - i) + red_1 * i) * 2 + 5) / 10);
+
+            pPalette[6] = 0;
+            pPalette[7] = 255;
+        }
+    }
+
+    // Nearest palette entry for each texel; returns the block's sum of squared errors
+    uint32_t FindClosestBC4UFast(
+        const uint8_t *pTexels,
+        const int16_t *pPalette,
+        uint8_t *pIndices)
+    {
+#ifdef BCFAST_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pTexels));
+        const __m128i lo = _mm_unpacklo_epi8(texels, zero);
+        const __m128i hi = _mm_unpackhi_epi8(texels, zero);
+
+        __m128i bestLo = _mm_set1_epi16(0x7fff);
+        __m128i bestHi = bestLo;
+        __m128i idxLo = zero;
+        __m128i idxHi = zero;
+
+        for (int k = 0; k < 8; ++k)
+        {
+            const __m128i pal = _mm_set1_epi16(pPalette[k]);
+            const __m128i kk = _mm_set1_epi16(static_cast<short>(k));
+
+            // |texel - palette| fits in 8 bits, so its square fits a signed 16-bit lane
+            __m128i dLo = _mm_sub_epi16(lo, pal);
+            __m128i dHi = _mm_sub_epi16(hi, pal);
+            dLo = _mm_mullo_epi16(dLo, dLo);
+            dHi = _mm_mullo_epi16(dHi, dHi);
+
+            // Unsigned compare via sign flip; squares can exceed 0x7fff
+            const __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+            const __m128i ltLo = _mm_cmplt_epi16(_mm_xor_si128(dLo, bias), _mm_xor_si128(bestLo, bias));
+            const __m128i ltHi = _mm_cmplt_epi16(_mm_xor_si128(dHi, bias), _mm_xor_si128(bestHi, bias));
+
+            bestLo = _mm_or_si128(_mm_and_si128(ltLo, dLo), _mm_andnot_si128(ltLo, bestLo));
+            bestHi = _mm_or_si128(_mm_and_si128(ltHi, dHi), _mm_andnot_si128(ltHi, bestHi));
+            idxLo = _mm_or_si128(_mm_and_si128(ltLo, kk), _mm_andnot_si128(ltLo, idxLo));
+            idxHi = _mm_or_si128(_mm_and_si128(ltHi, kk), _mm_andnot_si128(ltHi, idxHi));
+        }
+
+        if (pIndices)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pIndices), _mm_packus_epi16(idxLo, idxHi));
+
+        // Widen to 32 bits before summing
+        const __m128i sum = _mm_add_epi32(
+            _mm_add_epi32(_mm_unpacklo_epi16(bestLo, zero), _mm_unpackhi_epi16(bestLo, zero)),
+            _mm_add_epi32(_mm_unpacklo_epi16(bestHi, zero), _mm_unpackhi_epi16(bestHi, zero)));
+        const __m128i sum2 = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        const __m128i sum1 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(2, 3, 0, 1)));
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(sum1));
+#else
+        uint32_t error = 0;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            uint32_t best = UINT32_MAX;
+            uint8_t bestIndex = 0;
+            for (int k = 0; k < 8; ++k)
+            {
+                const int d = static_cast<int>(pTexels[i]) - pPalette[k];
+                const auto e = static_cast<uint32_t>(d * d);
+                if (e < best)
+                {
+                    best = e;
+                    bestIndex = static_cast<uint8_t>(k);
+                }
+            }
+
+            if (pIndices)
+                pIndices[i] = bestIndex;
+            error += best;
+        }
+        return error;
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    void EncodeBC4UFast(
+        BC4Block* pBC,
+        const uint8_t *pTexels,
+        bool exhaustive)
+    {
+        int mn = pTexels[0];
+        int mx = pTexels[0];
+        for (size_t i = 1; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            mn = std::min<int>(mn, pTexels[i]);
+            mx = std::max<int>(mx, pTexels[i]);
+        }
+
+        // 8 interpolated values between the extremes; exact for flat blocks and for 0/255 texels
+        int red_0 = mx;
+        int red_1 = mn;
+
+        int16_t palette[8];
+
+        if (exhaustive && (mx - mn) > 2)
+        {
+            BuildPaletteBC4U(palette, red_0, red_1);
+            uint32_t bestError = FindClosestBC4UFast(pTexels, palette, nullptr);
+
+            // Endpoints rarely move far from the extremes: search a window inside them, in both codecs
+            const int window = std::min<int>(16, (mx - mn) / 2);
+            for (int lo = mn; lo <= mn + window && bestError > 0; ++lo)
+            {
+                for (int hi = mx - window; hi <= mx; ++hi)
+                {
+                    if (hi <= lo)
+                        continue;
+
+                    BuildPaletteBC4U(palette, hi, lo);
+                    uint32_t error = FindClosestBC4UFast(pTexels, palette, nullptr);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        red_0 = hi;
+                        red_1 = lo;
+                    }
+
+                    // 6-value codec with explicit 0 and 255
+                    BuildPaletteBC4U(palette, lo, hi);
+                    error = FindClosestBC4UFast(pTexels, palette, nullptr);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        red_0 = lo;
+                        red_1 = hi;
+                    }
+                }
+            }
+        }
+
+        pBC->red_0 = static_cast<uint8_t>(red_0);
+        pBC->red_1 = static_cast<uint8_t>(red_1);
+
+        uint8_t indices[NUM_PIXELS_PER_BLOCK];
+        BuildPaletteBC4U(palette, red_0, red_1);
+        FindClosestBC4UFast(pTexels, palette, indices);
+
+        uint64_t bits = 0;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            bits |= uint64_t(indices[i]) << (3 * i);
+
+        for (size_t i = 0; i < 6; ++i)
+            pBC->indices[i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+
+    //------------------------------------------------------------------------------
+    // Integer decoders
+    //------------------------------------------------------------------------------
+    void DecodeBC1Block(uint8_t *pRGBA, const BC1Block *pBC, bool isBC1)
+    {
+        uint8_t color[16];
+        From565(color, pBC->rgb[0]);
+        From565(color + 4, pBC->rgb[1]);
+        color[3] = color[7] = color[11] = color[15] = 255;
+
+        if (isBC1 && pBC->rgb[0] <= pBC->rgb[1])
+        {
+            // 3-colour mode, index 3 is transparent black
+            for (size_t j = 0; j < 3; ++j)
+            {
+                color[8 + j] = static_cast<uint8_t>((color[j] + color[4 + j]) / 2);
+                color[12 + j] = 0;
+            }
+            color[15] = 0;
+        }
+        else
+        {
+            for (size_t j = 0; j < 3; ++j)
+            {
+                color[8 + j] = static_cast<uint8_t>(Lerp13(color[j], color[4 + j]));
+                color[12 + j] = static_cast<uint8_t>(Lerp13(color[4 + j], color[j]));
+            }
+        }
+
+        uint32_t dw = pBC->bitmap;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 2)
+            memcpy(pRGBA + i * 4, color + (dw & 3) * 4, 4);
+    }
+
+    // BC3 alpha and BC4 share one layout: two endpoints and 3-bit indices
+    void DecodeBC4Block(uint8_t *pOut, size_t stride, const BC4Block *pBC)
+    {
+        int16_t palette[8];
+        BuildPaletteBC4U(palette, pBC->red_0, pBC->red_1);
+
+        uint64_t dw = 0;
+        for (size_t i = 0; i < 6; ++i)
+            dw |= uint64_t(pBC->indices[i]) << (8 * i);
+
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 3)
+            pOut[i * stride] = static_cast<uint8_t>(palette[dw & 7]);
+    }
+}
+
+
+//=====================================================================================
+// Entry points
+//=====================================================================================
+
+void BCFast::EncodeBC1(uint8_t *pBC, const uint8_t *pRGBA, int alphaRef)
+{
+    assert(pBC && pRGBA);
+
+    EncodeBC1Fast(reinterpret_cast<BC1Block*>(pBC), pRGBA, alphaRef > 0, alphaRef);
+}
+
+void BCFast::EncodeBC3(uint8_t *pBC, const uint8_t *pRGBA)
+{
+    assert(pBC && pRGBA);
+
+    auto pBC3 = reinterpret_cast<BC3Block*>(pBC);
+    EncodeBC3AlphaFast(pBC3, pRGBA);
+    EncodeBC1Fast(&pBC3->bc1, pRGBA, false, 0);
+}
+
+void BCFast::EncodeBC4UBlocks(uint8_t *pBC, const uint8_t *pRed, size_t nBlocks, bool exhaustive)
+{
+    assert(pBC && pRed);
+
+    for (size_t i = 0; i < nBlocks; ++i)
+    {
+        auto pBC4 = reinterpret_cast<BC4Block*>(pBC + i * sizeof(BC4Block));
+        EncodeBC4UFast(pBC4, pRed + i * NUM_PIXELS_PER_BLOCK, exhaustive);
+    }
+}
+
+void BCFast::EncodeBC5UBlocks(uint8_t *pBC, const uint8_t *pRed, const uint8_t *pGreen, size_t nBlocks, bool exhaustive)
+{
+    assert(pBC && pRed && pGreen);
+
+    for (size_t i = 0; i < nBlocks; ++i)
+    {
+        auto pBCR = reinterpret_cast<BC4Block*>(pBC + i * sizeof(BC4Block) * 2);
+        auto pBCG = reinterpret_cast<BC4Block*>(pBC + i * sizeof(BC4Block) * 2 + sizeof(BC4Block));
+        EncodeBC4UFast(pBCR, pRed + i * NUM_PIXELS_PER_BLOCK, exhaustive);
+        EncodeBC4UFast(pBCG, pGreen + i * NUM_PIXELS_PER_BLOCK, exhaustive);
+    }
+}
+
+void BCFast::DecodeBC1(uint8_t *pRGBA, const uint8_t *pBC)
+{
+    assert(pRGBA && pBC);
+
+    DecodeBC1Block(pRGBA, reinterpret_cast<const BC1Block*>(pBC), true);
+}
+
+void BCFast::DecodeBC3(uint8_t *pRGBA, const uint8_t *pBC)
+{
+    assert(pRGBA && pBC);
+
+    auto pBC3 = reinterpret_cast<const BC3Block*>(pBC);
+    DecodeBC1Block(pRGBA, &pBC3->bc1, false);
+    DecodeBC4Block(pRGBA + 3, 4, reinterpret_cast<const BC4Block*>(pBC3));
+}
+
+void BCFast::DecodeBC4U(uint8_t *pRed, const uint8_t *pBC)
+{
+    assert(pRed && pBC);
+
+    DecodeBC4Block(pRed, 1, reinterpret_cast<const BC4Block*>(pBC));
+}
+
+void BCFast::DecodeBC5U(uint8_t *pRed, uint8_t *pGreen, const uint8_t *pBC)
+{
+    assert(pRed && pGreen && pBC);
+
+    DecodeBC4Block(pRed, 1, reinterpret_cast<const BC4Block*>(pBC));
+    DecodeBC4Block(pGreen, 1, reinterpret_cast<const BC4Block*>(pBC) + 1);
+}
@@ -0,0 +1,38 @@
+//-------------------------------------------------------------------------------------
+// BCFast.h
+//
+// Integer BC1/BC3/BC4/BC5 block codecs for 8-bit input. They need neither the Windows
+// SDK nor DirectXMath, so they build everywhere DirectXTex itself doesn't.
+//
+// Licensed under the MIT License.
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace BCFast
+{
+    const size_t NUM_PIXELS_PER_BLOCK = 16;
+
+    // Every encoder and decoder takes a block as 16 texels in rows of 4
+
+    // pRGBA holds 4 bytes per texel in R, G, B, A order. Texels with alpha below alphaRef are
+    // keyed to transparent black with the 3-colour codec, alphaRef 0 keeps every block opaque.
+    void EncodeBC1(uint8_t *pBC, const uint8_t *pRGBA, int alphaRef);
+    void EncodeBC3(uint8_t *pBC, const uint8_t *pRGBA);
+
+    // Runs of nBlocks blocks, one byte per texel for each channel, encoded one block at a time.
+    // Exhaustive also tries endpoint pairs up to 16 values inside the block extremes, in both BC4
+    // codecs, and keeps the lowest squared error.
+    void EncodeBC4UBlocks(uint8_t *pBC, const uint8_t *pRed, size_t nBlocks, bool exhaustive);
+    void EncodeBC5UBlocks(uint8_t *pBC, const uint8_t *pRed, const uint8_t *pGreen, size_t nBlocks, bool exhaustive);
+
+    // Decoders use the integer palettes of the format specification, they may differ from the
+    // float D3DXDecode* functions by one step of rounding
+    void DecodeBC1(uint8_t *pRGBA, const uint8_t *pBC);
+    void DecodeBC3(uint8_t *pRGBA, const uint8_t *pBC);
+    void DecodeBC4U(uint8_t *pRed, const uint8_t *pBC);
+    void DecodeBC5U(uint8_t *pRed, uint8_t *pGreen, const uint8_t *pBC);
+}
@@ -259,13 +259,15 @@ namespace DirectX
         uint8_t*    pixels;
     };
 
+    class ScratchImagePool;
+
     class ScratchImage
     {
     public:
         ScratchImage() noexcept
-            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr) {}
+            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr), m_pool(nullptr) {}
         ScratchImage(ScratchImage&& moveFrom) noexcept
-            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr) { *this = std::move(moveFrom); }
+            : m_nimages(0), m_size(0), m_metadata{}, m_image(nullptr), m_memory(nullptr), m_pool(nullptr) { *this = std::move(moveFrom); }
         ~ScratchImage() { Release(); }
 
         ScratchImage& __cdecl operator= (ScratchImage&& moveFrom) noexcept;
@@ -306,6 +308,66 @@ namespace DirectX
         TexMetadata m_metadata;
         Image*      m_image;
         uint8_t*    m_memory;
+        ScratchImagePool* m_pool;
+
+        uint8_t* __cdecl AllocatePixels(_In_ size_t size);
+    };
+
+    //---------------------------------------------------------------------------------
+    // Recycling allocator for ScratchImage pixels
+    struct ScratchImagePoolStats
+    {
+        size_t      allocations;        // Pixel blobs requested while the pool was bound
+        size_t      hits;               // Requests served from a recycled blob
+        size_t      outstandingBytes;   // Bytes currently owned by ScratchImages
+        size_t      retainedBytes;      // Bytes held for reuse
+        size_t      retainedBlocks;
+        size_t      peakRetainedBytes;
+        size_t      discardedBytes;     // Bytes freed instead of retained because of maxRetainedBytes
+
+        double __cdecl HitRate() const { return allocations ? double(hits) / double(allocations) : 0.0; }
+    };
+
+    class ScratchImagePool
+    {
+    public:
+        explicit ScratchImagePool(_In_ size_t maxRetainedBytes = SIZE_MAX);
+        ~ScratchImagePool();
+
+        ScratchImagePool(const ScratchImagePool&) = delete;
+        ScratchImagePool& operator=(const ScratchImagePool&) = delete;
+
+        void __cdecl Trim();
+            // Frees every retained blob
+
+        ScratchImagePoolStats __cdecl GetStats() const;
+
+        static ScratchImagePool* __cdecl GetCurrent();
+
+        class Scope
+        {
+        public:
+            explicit Scope(_In_ ScratchImagePool& pool);
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            ScratchImagePool* m_previous;
+        };
+            // While a Scope is alive, ScratchImages initialized on that thread draw their pixels from the pool.
+            // Blobs are rounded up to size classes (4 per power of 2) and go back to the pool that allocated them
+            // on Release, from any thread. The pool must outlive every ScratchImage allocated from it.
+
+    private:
+        friend class ScratchImage;
+
+        uint8_t* __cdecl Allocate(_In_ size_t size);
+        void __cdecl Free(_In_ uint8_t* memory, _In_ size_t size);
+
+        struct Impl;
+        Impl*       m_impl;
     };
 
     //---------------------------------------------------------------------------------
@@ -486,6 +548,12 @@ namespace DirectX
 
         TEX_FILTER_FORCE_WIC        = 0x20000000,
             // Forces use of the WIC path even when logic would have picked a non-WIC path when both are an option
+
+        TEX_FILTER_PARALLEL         = 0x40000000,
+            // Resize and GenerateMipMaps split destination rows across threads for box, linear, cubic and triangle filtering.
+            // Picks the non-WIC filters when they can do the job: any ratio for linear, cubic and triangle, box (and FANT)
+            // only for an exact 2:1 reduction or a power of 2 chain; otherwise the flag is ignored and WIC runs serially.
+            // Parallel results match the single-threaded non-WIC ones, not WIC's where the flag moved a filter off WIC
     };
 
     HRESULT __cdecl Resize(
@@ -583,6 +651,16 @@ namespace DirectX
         TEX_COMPRESS_BC7_QUICK          = 0x100000,
             // Minimal modes (usually mode 6) for BC7 compression
 
+        TEX_COMPRESS_BC13_FAST          = 0x200000,
+            // Integer encoder for BC1/BC3 when the source is 8-bit RGBA/BGRA UNORM; ignored with dithering or other sources
+
+        TEX_COMPRESS_BC45_FAST          = 0x400000,
+            // Integer encoder for BC4_UNORM/BC5_UNORM when the source is 8-bit UNORM (R8, R8G8, RGBA/BGRA)
+
+        TEX_COMPRESS_BC45_EXHAUSTIVE    = 0x800000,
+            // With TEX_COMPRESS_BC45_FAST, also tries endpoint pairs up to 16 values inside the block extremes
+            // in both BC4 codecs and keeps the lowest error; a bounded search, not a full one
+
         TEX_COMPRESS_SRGB_IN            = 0x1000000,
         TEX_COMPRESS_SRGB_OUT           = 0x2000000,
         TEX_COMPRESS_SRGB               = (TEX_COMPRESS_SRGB_IN | TEX_COMPRESS_SRGB_OUT),
@@ -615,6 +693,26 @@ namespace DirectX
     HRESULT __cdecl Decompress(
         _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DXGI_FORMAT format, _Out_ ScratchImage& images);
+    HRESULT __cdecl Decompress(_In_ const Image& cImage, _In_ DXGI_FORMAT format, _In_ DWORD flags, _Out_ ScratchImage& image);
+    HRESULT __cdecl Decompress(
+        _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ DXGI_FORMAT format, _In_ DWORD flags, _Out_ ScratchImage& images);
+        // flags accepts TEX_COMPRESS_PARALLEL to decode block rows on multiple threads
+
+    HRESULT __cdecl StreamCompress(
+        _In_ const Image& srcImage, _In_ size_t width, _In_ size_t height, _In_ size_t levels,
+        _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float threshold, _Out_ ScratchImage& cImage);
+        // Box-filters srcImage (BC or uncompressed) down by an integer factor, builds the mip chain and
+        // compresses it in 4-row bands, never holding a full uncompressed level. Use levels=0 for a full chain;
+        // returns E_INVALIDARG when the reduction isn't integral or the size isn't a power of 2 with mips
+
+    HRESULT __cdecl StreamMipChain(
+        _In_ const Image& srcImage, _In_ size_t width, _In_ size_t height, _In_ size_t levels,
+        _In_ DXGI_FORMAT bandFormat, _In_ size_t bandRows,
+        _In_ std::function<HRESULT __cdecl(size_t level, size_t y, const Image& band)> bandReady);
+        // Same reduction and mip chain as StreamCompress, but hands each level to bandReady in bands of
+        // bandRows rows (a multiple of 4, the last band of a level may be shorter) starting at row y, converted
+        // to the uncompressed bandFormat; the band is only valid during the call. A failing bandReady stops the walk
 
     //---------------------------------------------------------------------------------
     // Normal map operations
@@ -30,7 +30,11 @@ namespace
         static_assert(static_cast<int>(TEX_COMPRESS_UNIFORM) == static_cast<int>(BC_FLAGS_UNIFORM), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
         static_assert(static_cast<int>(TEX_COMPRESS_BC7_USE_3SUBSETS) == static_cast<int>(BC_FLAGS_USE_3SUBSETS), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
         static_assert(static_cast<int>(TEX_COMPRESS_BC7_QUICK) == static_cast<int>(BC_FLAGS_FORCE_BC7_MODE6), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
-        return (compress & (BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A | BC_FLAGS_UNIFORM | BC_FLAGS_USE_3SUBSETS | BC_FLAGS_FORCE_BC7_MODE6));
+        static_assert(static_cast<int>(TEX_COMPRESS_BC13_FAST) == static_cast<int>(BC_FLAGS_FAST_BC13), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+        static_assert(static_cast<int>(TEX_COMPRESS_BC45_FAST) == static_cast<int>(BC_FLAGS_FAST_BC45), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+        static_assert(static_cast<int>(TEX_COMPRESS_BC45_EXHAUSTIVE) == static_cast<int>(BC_FLAGS_BC45_EXHAUSTIVE), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+        return (compress & (BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A | BC_FLAGS_UNIFORM | BC_FLAGS_USE_3SUBSETS | BC_FLAGS_FORCE_BC7_MODE6
+                            | BC_FLAGS_FAST_BC13 | BC_FLAGS_FAST_BC45 | BC_FLAGS_BC45_EXHAUSTIVE));
     }
 
     inline DWORD GetSRGBFlags(_In_ DWORD compress)
@@ -65,6 +69,264 @@ namespace
         return true;
     }
 
+    inline DXGI_FORMAT PromoteTypelessBC(_In_ DXGI_FORMAT format)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_TYPELESS:  return DXGI_FORMAT_BC1_UNORM;
+        case DXGI_FORMAT_BC2_TYPELESS:  return DXGI_FORMAT_BC2_UNORM;
+        case DXGI_FORMAT_BC3_TYPELESS:  return DXGI_FORMAT_BC3_UNORM;
+        case DXGI_FORMAT_BC4_TYPELESS:  return DXGI_FORMAT_BC4_UNORM;
+        case DXGI_FORMAT_BC5_TYPELESS:  return DXGI_FORMAT_BC5_UNORM;
+        case DXGI_FORMAT_BC6H_TYPELESS: return DXGI_FORMAT_BC6H_UF16;
+        case DXGI_FORMAT_BC7_TYPELESS:  return DXGI_FORMAT_BC7_UNORM;
+        default:                        return format;
+        }
+    }
+
+    inline bool DetermineDecoderSettings(_In_ DXGI_FORMAT cformat, _Out_ BC_DECODE& pfDecode, _Out_ size_t& sbpp)
+    {
+        switch (cformat)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:    pfDecode = D3DXDecodeBC1;   sbpp = 8;   break;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:    pfDecode = D3DXDecodeBC2;   sbpp = 16;  break;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:    pfDecode = D3DXDecodeBC3;   sbpp = 16;  break;
+        case DXGI_FORMAT_BC4_UNORM:         pfDecode = D3DXDecodeBC4U;  sbpp = 8;   break;
+        case DXGI_FORMAT_BC4_SNORM:         pfDecode = D3DXDecodeBC4S;  sbpp = 8;   break;
+        case DXGI_FORMAT_BC5_UNORM:         pfDecode = D3DXDecodeBC5U;  sbpp = 16;  break;
+        case DXGI_FORMAT_BC5_SNORM:         pfDecode = D3DXDecodeBC5S;  sbpp = 16;  break;
+        case DXGI_FORMAT_BC6H_UF16:         pfDecode = D3DXDecodeBC6HU; sbpp = 16;  break;
+        case DXGI_FORMAT_BC6H_SF16:         pfDecode = D3DXDecodeBC6HS; sbpp = 16;  break;
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:    pfDecode = D3DXDecodeBC7;   sbpp = 16;  break;
+        default:                            pfDecode = nullptr;         sbpp = 0;   return false;
+        }
+
+        return true;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Texel used for position i (0-3) of a block edge that only has n texels, matching CompressBC's replication
+    inline size_t ReplicateIndex(size_t i, size_t n)
+    {
+        static const size_t uSrc[] = { 0, 0, 0, 1 };
+        return (i < n) ? i : (uSrc[i] < n) ? uSrc[i] : 0;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Can the integer BC1/BC3 encoder take this image directly, without going through XMVECTOR?
+    bool CanCompressBCFast(const Image& image, DXGI_FORMAT format, DWORD bcflags, DWORD srgb)
+    {
+        if (!(bcflags & BC_FLAGS_FAST_BC13) || (bcflags & (BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A)))
+            return false;
+
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+            break;
+
+        default:
+            return false;
+        }
+
+        switch (image.format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            break;
+
+        default:
+            return false;
+        }
+
+        // No colorspace conversion on this path
+        return !srgb && (IsSRGB(image.format) == IsSRGB(format));
+    }
+
+    //-------------------------------------------------------------------------------------
+    HRESULT CompressBC_RGBA8(
+        const Image& image,
+        const Image& result,
+        DWORD bcflags,
+        float threshold,
+        bool parallel)
+    {
+        if (!image.pixels || !result.pixels)
+            return E_POINTER;
+
+        assert(image.width == result.width);
+        assert(image.height == result.height);
+
+        const bool bgr = (image.format != DXGI_FORMAT_R8G8B8A8_UNORM && image.format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+        const bool noalpha = (image.format == DXGI_FORMAT_B8G8R8X8_UNORM || image.format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB);
+        const bool bc1 = (result.format == DXGI_FORMAT_BC1_UNORM || result.format == DXGI_FORMAT_BC1_UNORM_SRGB);
+        const size_t blocksize = bc1 ? 8 : 16;
+
+        const size_t nbWidth = std::max<size_t>(1, (image.width + 3) / 4);
+        const size_t nbHeight = std::max<size_t>(1, (image.height + 3) / 4);
+
+        UNREFERENCED_PARAMETER(parallel);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+        for (int by = 0; by < static_cast<int>(nbHeight); ++by)
+        {
+            const size_t y = size_t(by) * 4;
+            const size_t ph = std::min<size_t>(4, image.height - y);
+            const uint8_t *pSrc = image.pixels + y * image.rowPitch;
+            uint8_t *pDest = result.pixels + size_t(by) * result.rowPitch;
+
+            uint8_t block[NUM_PIXELS_PER_BLOCK * 4];
+            for (size_t bx = 0; bx < nbWidth; ++bx)
+            {
+                const size_t x = bx * 4;
+                const size_t pw = std::min<size_t>(4, image.width - x);
+                assert(pw > 0 && ph > 0);
+
+                // Replicate pixels for partial block
+                for (size_t t = 0; t < 4; ++t)
+                {
+                    const uint8_t *sptr = pSrc + ReplicateIndex(t, ph) * image.rowPitch + x * 4;
+                    for (size_t s = 0; s < 4; ++s)
+                    {
+                        const uint8_t *px = sptr + ReplicateIndex(s, pw) * 4;
+                        uint8_t *dst = block + ((t << 2) | s) * 4;
+                        dst[0] = bgr ? px[2] : px[0];
+                        dst[1] = px[1];
+                        dst[2] = bgr ? px[0] : px[2];
+                        dst[3] = noalpha ? 255 : px[3];
+                    }
+                }
+
+                if (bc1)
+                    D3DXEncodeBC1Fast(pDest + bx * blocksize, block, threshold, bcflags);
+                else
+                    D3DXEncodeBC3Fast(pDest + bx * blocksize, block, bcflags);
+            }
+        }
+
+        return S_OK;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Can the integer BC4U/BC5U encoder read this image's red/green bytes directly?
+    bool CanCompressBC45Fast(const Image& image, DXGI_FORMAT format, DWORD bcflags)
+    {
+        if (!(bcflags & BC_FLAGS_FAST_BC45))
+            return false;
+
+        if (format != DXGI_FORMAT_BC4_UNORM && format != DXGI_FORMAT_BC5_UNORM)
+            return false;
+
+        switch (image.format)
+        {
+        case DXGI_FORMAT_R8_UNORM:
+            return format == DXGI_FORMAT_BC4_UNORM;
+
+        case DXGI_FORMAT_R8G8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    //-------------------------------------------------------------------------------------
+    HRESULT CompressBC45_UNORM8(
+        const Image& image,
+        const Image& result,
+        DWORD bcflags,
+        bool parallel)
+    {
+        if (!image.pixels || !result.pixels)
+            return E_POINTER;
+
+        assert(image.width == result.width);
+        assert(image.height == result.height);
+
+        size_t stride, red, green;
+        switch (image.format)
+        {
+        case DXGI_FORMAT_R8_UNORM:          stride = 1; red = 0; green = 0; break;
+        case DXGI_FORMAT_R8G8_UNORM:        stride = 2; red = 0; green = 1; break;
+        case DXGI_FORMAT_R8G8B8A8_UNORM:    stride = 4; red = 0; green = 1; break;
+        default:                            stride = 4; red = 2; green = 1; break;
+        }
+
+        const bool bc5 = (result.format == DXGI_FORMAT_BC5_UNORM);
+        const size_t nbWidth = std::max<size_t>(1, (image.width + 3) / 4);
+        const size_t nbHeight = std::max<size_t>(1, (image.height + 3) / 4);
+
+        UNREFERENCED_PARAMETER(parallel);
+
+        bool fail = false;
+
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+        for (int by = 0; by < static_cast<int>(nbHeight); ++by)
+        {
+            // Gather one row of blocks so the encoder works on many blocks per call
+            std::unique_ptr<uint8_t[]> texels(new (std::nothrow) uint8_t[nbWidth * NUM_PIXELS_PER_BLOCK * 2]);
+            if (!texels)
+            {
+                fail = true;
+                continue;
+            }
+
+            uint8_t *pRed = texels.get();
+            uint8_t *pGreen = pRed + nbWidth * NUM_PIXELS_PER_BLOCK;
+
+            const size_t y = size_t(by) * 4;
+            const size_t ph = std::min<size_t>(4, image.height - y);
+            const uint8_t *pSrc = image.pixels + y * image.rowPitch;
+
+            for (size_t bx = 0; bx < nbWidth; ++bx)
+            {
+                const size_t x = bx * 4;
+                const size_t pw = std::min<size_t>(4, image.width - x);
+                assert(pw > 0 && ph > 0);
+
+                // Replicate pixels for partial block
+                for (size_t t = 0; t < 4; ++t)
+                {
+                    const uint8_t *sptr = pSrc + ReplicateIndex(t, ph) * image.rowPitch + x * stride;
+                    for (size_t s = 0; s < 4; ++s)
+                    {
+                        const uint8_t *px = sptr + ReplicateIndex(s, pw) * stride;
+                        const size_t j = bx * NUM_PIXELS_PER_BLOCK + ((t << 2) | s);
+                        pRed[j] = px[red];
+                        pGreen[j] = px[green];
+                    }
+                }
+            }
+
+            uint8_t *pDest = result.pixels + size_t(by) * result.rowPitch;
+            if (bc5)
+                D3DXEncodeBC5UBlocks(pDest, pRed, pGreen, nbWidth, bcflags);
+            else
+                D3DXEncodeBC4UBlocks(pDest, pRed, nbWidth, bcflags);
+        }
+
+        return (fail) ? E_OUTOFMEMORY : S_OK;
+    }
+
 
     //-------------------------------------------------------------------------------------
     HRESULT CompressBC(
@@ -80,6 +342,12 @@ namespace
         assert(image.width == result.width);
         assert(image.height == result.height);
 
+        if (CanCompressBCFast(image, result.format, bcflags, srgb))
+            return CompressBC_RGBA8(image, result, bcflags, threshold, false);
+
+        if (CanCompressBC45Fast(image, result.format, bcflags))
+            return CompressBC45_UNORM8(image, result, bcflags, false);
+
         const DXGI_FORMAT format = image.format;
         size_t sbpp = BitsPerPixel(format);
         if (!sbpp)
@@ -209,6 +477,12 @@ namespace
         assert(image.width == result.width);
         assert(image.height == result.height);
 
+        if (CanCompressBCFast(image, result.format, bcflags, srgb))
+            return CompressBC_RGBA8(image, result, bcflags, threshold, true);
+
+        if (CanCompressBC45Fast(image, result.format, bcflags))
+            return CompressBC45_UNORM8(image, result, bcflags, true);
+
         const DXGI_FORMAT format = image.format;
         size_t sbpp = BitsPerPixel(format);
         if (!sbpp)
@@ -377,7 +651,53 @@ namespace
 
 
     //-------------------------------------------------------------------------------------
-    HRESULT DecompressBC(_In_ const Image& cImage, _In_ const Image& result)
+    // Integer decoder for BC formats whose default decompressed format is 8-bit UNORM
+    bool DetermineFastDecoder(_In_ DXGI_FORMAT cformat, _In_ DXGI_FORMAT format, _Out_ BC_DECODE_FAST& pfDecode)
+    {
+        pfDecode = nullptr;
+
+        switch (cformat)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:    pfDecode = D3DXDecodeBC1Fast;   break;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:    pfDecode = D3DXDecodeBC2Fast;   break;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:    pfDecode = D3DXDecodeBC3Fast;   break;
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:    pfDecode = D3DXDecodeBC7Fast;   break;
+
+        case DXGI_FORMAT_BC4_UNORM:
+            if (format != DXGI_FORMAT_R8_UNORM)
+                return false;
+            pfDecode = D3DXDecodeBC4UFast;
+            return true;
+
+        case DXGI_FORMAT_BC5_UNORM:
+            if (format != DXGI_FORMAT_R8G8_UNORM)
+                return false;
+            pfDecode = D3DXDecodeBC5UFast;
+            return true;
+
+        default:
+            return false;
+        }
+
+        // No colorspace conversion on this path
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            return IsSRGB(format) == IsSRGB(cformat);
+
+        default:
+            pfDecode = nullptr;
+            return false;
+        }
+    }
+
+    //-------------------------------------------------------------------------------------
+    HRESULT DecompressBC(_In_ const Image& cImage, _In_ const Image& result, bool parallel)
     {
         if (!cImage.pixels || !result.pixels)
             return E_POINTER;
@@ -399,95 +719,425 @@ namespace
         // Round to bytes
         dbpp = (dbpp + 7) / 8;
 
-        uint8_t *pDest = result.pixels;
-        if (!pDest)
-            return E_POINTER;
-
         // Promote "typeless" BC formats
-        DXGI_FORMAT cformat;
-        switch (cImage.format)
-        {
-        case DXGI_FORMAT_BC1_TYPELESS:  cformat = DXGI_FORMAT_BC1_UNORM; break;
-        case DXGI_FORMAT_BC2_TYPELESS:  cformat = DXGI_FORMAT_BC2_UNORM; break;
-        case DXGI_FORMAT_BC3_TYPELESS:  cformat = DXGI_FORMAT_BC3_UNORM; break;
-        case DXGI_FORMAT_BC4_TYPELESS:  cformat = DXGI_FORMAT_BC4_UNORM; break;
-        case DXGI_FORMAT_BC5_TYPELESS:  cformat = DXGI_FORMAT_BC5_UNORM; break;
-        case DXGI_FORMAT_BC6H_TYPELESS: cformat = DXGI_FORMAT_BC6H_UF16; break;
-        case DXGI_FORMAT_BC7_TYPELESS:  cformat = DXGI_FORMAT_BC7_UNORM; break;
-        default:                        cformat = cImage.format;         break;
-        }
+        const DXGI_FORMAT cformat = PromoteTypelessBC(cImage.format);
 
         // Determine BC format decoder
         BC_DECODE pfDecode;
         size_t sbpp;
-        switch (cformat)
-        {
-        case DXGI_FORMAT_BC1_UNORM:
-        case DXGI_FORMAT_BC1_UNORM_SRGB:    pfDecode = D3DXDecodeBC1;   sbpp = 8;   break;
-        case DXGI_FORMAT_BC2_UNORM:
-        case DXGI_FORMAT_BC2_UNORM_SRGB:    pfDecode = D3DXDecodeBC2;   sbpp = 16;  break;
-        case DXGI_FORMAT_BC3_UNORM:
-        case DXGI_FORMAT_BC3_UNORM_SRGB:    pfDecode = D3DXDecodeBC3;   sbpp = 16;  break;
-        case DXGI_FORMAT_BC4_UNORM:         pfDecode = D3DXDecodeBC4U;  sbpp = 8;   break;
-        case DXGI_FORMAT_BC4_SNORM:         pfDecode = D3DXDecodeBC4S;  sbpp = 8;   break;
-        case DXGI_FORMAT_BC5_UNORM:         pfDecode = D3DXDecodeBC5U;  sbpp = 16;  break;
-        case DXGI_FORMAT_BC5_SNORM:         pfDecode = D3DXDecodeBC5S;  sbpp = 16;  break;
-        case DXGI_FORMAT_BC6H_UF16:         pfDecode = D3DXDecodeBC6HU; sbpp = 16;  break;
-        case DXGI_FORMAT_BC6H_SF16:         pfDecode = D3DXDecodeBC6HS; sbpp = 16;  break;
-        case DXGI_FORMAT_BC7_UNORM:
-        case DXGI_FORMAT_BC7_UNORM_SRGB:    pfDecode = D3DXDecodeBC7;   sbpp = 16;  break;
-        default:
+        if (!DetermineDecoderSettings(cformat, pfDecode, sbpp))
             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-        }
 
-        __declspec(align(16)) XMVECTOR temp[16];
-        const uint8_t *pSrc = cImage.pixels;
+        BC_DECODE_FAST pfDecodeFast;
+        const bool fast = DetermineFastDecoder(cformat, format, pfDecodeFast);
+
+        const size_t nbWidth = std::min<size_t>((cImage.width + 3) / 4, (cImage.rowPitch + sbpp - 1) / sbpp);
+        const size_t nbHeight = (cImage.height + 3) / 4;
         const size_t rowPitch = result.rowPitch;
-        for (size_t h = 0; h < cImage.height; h += 4)
+
+        UNREFERENCED_PARAMETER(parallel);
+
+        bool fail = false;
+
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+        for (int by = 0; by < static_cast<int>(nbHeight); ++by)
         {
-            const uint8_t *sptr = pSrc;
-            uint8_t* dptr = pDest;
-            size_t ph = std::min<size_t>(4, cImage.height - h);
-            size_t w = 0;
-            for (size_t count = 0; (count < cImage.rowPitch) && (w < cImage.width); count += sbpp, w += 4)
+            const size_t h = size_t(by) * 4;
+            const uint8_t *sptr = cImage.pixels + size_t(by) * cImage.rowPitch;
+            uint8_t* dptr = result.pixels + h * rowPitch;
+            const size_t ph = std::min<size_t>(4, cImage.height - h);
+
+            __declspec(align(16)) XMVECTOR temp[NUM_PIXELS_PER_BLOCK];
+            uint8_t block[NUM_PIXELS_PER_BLOCK * 4];
+
+            for (size_t bx = 0; bx < nbWidth; ++bx, sptr += sbpp, dptr += dbpp * 4)
             {
+                const size_t pw = std::min<size_t>(4, cImage.width - bx * 4);
+                assert(pw > 0 && ph > 0);
+
+                if (fast)
+                {
+                    pfDecodeFast(block, sptr);
+
+                    for (size_t y = 0; y < ph; ++y)
+                        memcpy(dptr + rowPitch * y, block + y * 4 * dbpp, pw * dbpp);
+
+                    continue;
+                }
+
                 pfDecode(temp, sptr);
                 _ConvertScanline(temp, 16, format, cformat, 0);
 
-                size_t pw = std::min<size_t>(4, cImage.width - w);
-                assert(pw > 0 && ph > 0);
+                for (size_t y = 0; y < ph; ++y)
+                {
+                    if (!_StoreScanline(dptr + rowPitch * y, rowPitch, format, &temp[y * 4], pw))
+                        fail = true;
+                }
+            }
+        }
+
+        return (fail) ? E_FAIL : S_OK;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Streamed resize, mipmap generation and compression
+    //
+    // Rows travel down the mip chain one at a time. Each level keeps a band of rows that is
+    // compressed (or handed to the caller) as soon as it fills, plus the last even row waiting
+    // for its partner to form the next level's 2x2 box average, so memory is O(width) per level.
+    //-------------------------------------------------------------------------------------
+    struct StreamLevel
+    {
+        const Image*                dest;       // compressed level, null when bands go to the caller
+        size_t                      index;
+        size_t                      width;
+        size_t                      height;
+        size_t                      rowsIn;
+        size_t                      bandRows;
+        ScopedAlignedArrayXMVECTOR  band;       // bandHeight rows, 4 when compressing: one row of blocks
+        ScopedAlignedArrayXMVECTOR  pending;    // even row waiting for its pair
+        ScopedAlignedArrayXMVECTOR  down;       // box-filtered row for the next level
+        bool                        hasPending;
+    };
+
+    struct StreamEncoder
+    {
+        std::vector<StreamLevel>    levels;
+        size_t                      bandHeight;
+        DXGI_FORMAT                 inFormat;
+
+        // Compressing
+        BC_ENCODE                   pfEncode;
+        size_t                      blocksize;
+        DWORD                       cflags;
+        DWORD                       bcflags;
+        DWORD                       srgb;
+        float                       threshold;
+
+        // Handing bands to the caller
+        DXGI_FORMAT                 bandFormat;
+        std::unique_ptr<uint8_t[]>  bandPixels;
+        std::function<HRESULT __cdecl(size_t, size_t, const Image&)> bandReady;
+    };
+
+    // Stores a band in the caller's format; the band's XMVECTOR rows are converted in place
+    HRESULT EmitStreamBand(const StreamEncoder& enc, const StreamLevel& level)
+    {
+        size_t rowPitch, slicePitch;
+        ComputePitch(enc.bandFormat, level.width, level.bandRows, rowPitch, slicePitch, CP_FLAGS_NONE);
+
+        Image band = {};
+        band.width = level.width;
+        band.height = level.bandRows;
+        band.format = enc.bandFormat;
+        band.rowPitch = rowPitch;
+        band.slicePitch = slicePitch;
+        band.pixels = enc.bandPixels.get();
+
+        for (size_t t = 0; t < level.bandRows; ++t)
+        {
+            XMVECTOR* pRow = level.band.get() + t * level.width;
+            _ConvertScanline(pRow, level.width, enc.bandFormat, enc.inFormat, 0);
+            if (!_StoreScanline(band.pixels + t * rowPitch, rowPitch, enc.bandFormat, pRow, level.width))
+                return E_FAIL;
+        }
+
+        return enc.bandReady(level.index, level.rowsIn - level.bandRows, band);
+    }
+
+    HRESULT EncodeStreamBand(const StreamEncoder& enc, const StreamLevel& level)
+    {
+        if (enc.bandReady)
+            return EmitStreamBand(enc, level);
+
+        assert(level.bandRows > 0 && level.bandRows <= 4);
+
+        const size_t blockRow = (level.rowsIn - 1) / 4;
+        uint8_t *pDest = level.dest->pixels + blockRow * level.dest->rowPitch;
+
+        __declspec(align(16)) XMVECTOR temp[16];
+        for (size_t x = 0; x < level.width; x += 4)
+        {
+            const size_t pw = std::min<size_t>(4, level.width - x);
+
+            // Replicate pixels for partial block
+            for (size_t t = 0; t < 4; ++t)
+            {
+                const XMVECTOR *sptr = level.band.get() + ReplicateIndex(t, level.bandRows) * level.width + x;
+                for (size_t s = 0; s < 4; ++s)
+                {
+                    temp[(t << 2) | s] = sptr[ReplicateIndex(s, pw)];
+                }
+            }
+
+            _ConvertScanline(temp, 16, level.dest->format, enc.inFormat, enc.cflags | enc.srgb);
+
+            if (enc.pfEncode)
+                enc.pfEncode(pDest, temp, enc.bcflags);
+            else
+                D3DXEncodeBC1(pDest, temp, enc.threshold, enc.bcflags);
+
+            pDest += enc.blocksize;
+        }
+
+        return S_OK;
+    }
+
+    HRESULT PushStreamRow(StreamEncoder& enc, size_t index, const XMVECTOR* pRow)
+    {
+        StreamLevel& level = enc.levels[index];
+        if (level.rowsIn >= level.height)
+            return E_UNEXPECTED;
+
+        memcpy(level.band.get() + level.bandRows * level.width, pRow, sizeof(XMVECTOR) * level.width);
+        ++level.bandRows;
+        ++level.rowsIn;
+
+        if (level.bandRows == enc.bandHeight || level.rowsIn == level.height)
+        {
+            HRESULT hr = EncodeStreamBand(enc, level);
+            if (FAILED(hr))
+                return hr;
+
+            level.bandRows = 0;
+        }
+
+        if (index + 1 >= enc.levels.size())
+            return S_OK;
+
+        // A level that is one row tall halves only horizontally
+        if (level.height > 1 && !level.hasPending)
+        {
+            memcpy(level.pending.get(), pRow, sizeof(XMVECTOR) * level.width);
+            level.hasPending = true;
+            return S_OK;
+        }
+
+        const XMVECTOR* pRowA = level.hasPending ? level.pending.get() : pRow;
+        const size_t nwidth = enc.levels[index + 1].width;
+        const size_t lastX = level.width - 1;
 
-                if (!_StoreScanline(dptr, rowPitch, format, &temp[0], pw))
+        XMVECTOR* pDown = level.down.get();
+        for (size_t x = 0; x < nwidth; ++x)
+        {
+            const size_t x0 = std::min<size_t>(x * 2, lastX);
+            const size_t x1 = std::min<size_t>(x * 2 + 1, lastX);
+
+            XMVECTOR v = XMVectorAdd(pRowA[x0], pRowA[x1]);
+            v = XMVectorAdd(v, pRow[x0]);
+            v = XMVectorAdd(v, pRow[x1]);
+            pDown[x] = XMVectorScale(v, 0.25f);
+        }
+
+        level.hasPending = false;
+        return PushStreamRow(enc, index + 1, pDown);
+    }
+
+    // Loads rows of the source, BC decoding one row of blocks at a time
+    class StreamSource
+    {
+    public:
+        StreamSource(const Image& image) : m_image(image), m_pfDecode(nullptr), m_sbpp(0), m_bandValid(false), m_bandStart(0) {}
+
+        HRESULT Initialize()
+        {
+            if (IsCompressed(m_image.format))
+            {
+                m_cformat = PromoteTypelessBC(m_image.format);
+                if (!DetermineDecoderSettings(m_cformat, m_pfDecode, m_sbpp))
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+                m_format = DefaultDecompress(m_image.format);
+                if (m_format == DXGI_FORMAT_UNKNOWN)
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+                m_band.reset(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * m_image.width * 4, 16)));
+            }
+            else
+            {
+                m_format = m_image.format;
+                m_band.reset(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * m_image.width, 16)));
+            }
+
+            return m_band ? S_OK : E_OUTOFMEMORY;
+        }
+
+        DXGI_FORMAT Format() const { return m_format; }
+
+        // Returned pointer is valid until the next call
+        const XMVECTOR* LoadRow(size_t y)
+        {
+            const size_t width = m_image.width;
+
+            if (!m_pfDecode)
+            {
+                if (!_LoadScanline(m_band.get(), width, m_image.pixels + y * m_image.rowPitch, m_image.rowPitch, m_image.format))
+                    return nullptr;
+
+                return m_band.get();
+            }
+
+            if (!m_bandValid || y < m_bandStart || y >= m_bandStart + 4)
+            {
+                m_bandStart = y & ~size_t(3);
+
+                __declspec(align(16)) XMVECTOR temp[16];
+                const uint8_t *sptr = m_image.pixels + (m_bandStart / 4) * m_image.rowPitch;
+                for (size_t x = 0; x < width; x += 4, sptr += m_sbpp)
+                {
+                    m_pfDecode(temp, sptr);
+                    _ConvertScanline(temp, 16, m_format, m_cformat, 0);
+
+                    const size_t pw = std::min<size_t>(4, width - x);
+                    for (size_t t = 0; t < 4; ++t)
+                    {
+                        memcpy(m_band.get() + t * width + x, &temp[t * 4], sizeof(XMVECTOR) * pw);
+                    }
+                }
+
+                m_bandValid = true;
+            }
+
+            return m_band.get() + (y - m_bandStart) * width;
+        }
+
+    private:
+        const Image&                m_image;
+        ScopedAlignedArrayXMVECTOR  m_band;
+        BC_DECODE                   m_pfDecode;
+        size_t                      m_sbpp;
+        bool                        m_bandValid;
+        size_t                      m_bandStart;
+        DXGI_FORMAT                 m_cformat;
+        DXGI_FORMAT                 m_format;
+    };
+
+    //-------------------------------------------------------------------------------------
+    // Runs the rows of srcImage through the levels, which only have their size and dest set
+    HRESULT StreamLevels(const Image& srcImage, StreamEncoder& enc)
+    {
+        StreamSource source(srcImage);
+        HRESULT hr = source.Initialize();
+        if (FAILED(hr))
+            return hr;
+
+        enc.inFormat = source.Format();
+
+        for (size_t level = 0; level < enc.levels.size(); ++level)
+        {
+            StreamLevel& sl = enc.levels[level];
+            sl.index = level;
+            sl.rowsIn = 0;
+            sl.bandRows = 0;
+            sl.hasPending = false;
+
+            sl.band.reset(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * sl.width * enc.bandHeight, 16)));
+            sl.pending.reset(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * sl.width, 16)));
+            sl.down.reset(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * std::max<size_t>(1, sl.width >> 1), 16)));
+            if (!sl.band || !sl.pending || !sl.down)
+                return E_OUTOFMEMORY;
+        }
+
+        // Box filter the source down to the top level, which is an integer factor smaller
+        const size_t width = enc.levels[0].width;
+        const size_t height = enc.levels[0].height;
+        const size_t fx = srcImage.width / width;
+        const size_t fy = srcImage.height / height;
+        const float scale = 1.f / float(fx * fy);
+
+        ScopedAlignedArrayXMVECTOR row(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * width, 16)));
+        if (!row)
+            return E_OUTOFMEMORY;
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            XMVECTOR* pRow = row.get();
+
+            if (fx == 1 && fy == 1)
+            {
+                const XMVECTOR* pSrc = source.LoadRow(y);
+                if (!pSrc)
                     return E_FAIL;
 
-                if (ph > 1)
+                memcpy(pRow, pSrc, sizeof(XMVECTOR) * width);
+            }
+            else
+            {
+                memset(pRow, 0, sizeof(XMVECTOR) * width);
+
+                for (size_t sy = 0; sy < fy; ++sy)
                 {
-                    if (!_StoreScanline(dptr + rowPitch, rowPitch, format, &temp[4], pw))
+                    const XMVECTOR* pSrc = source.LoadRow(y * fy + sy);
+                    if (!pSrc)
                         return E_FAIL;
 
-                    if (ph > 2)
+                    for (size_t x = 0; x < width; ++x)
                     {
-                        if (!_StoreScanline(dptr + rowPitch * 2, rowPitch, format, &temp[8], pw))
-                            return E_FAIL;
-
-                        if (ph > 3)
+                        XMVECTOR v = pRow[x];
+                        for (size_t sx = 0; sx < fx; ++sx)
                         {
-                            if (!_StoreScanline(dptr + rowPitch * 3, rowPitch, format, &temp[12], pw))
-                                return E_FAIL;
+                            v = XMVectorAdd(v, *pSrc++);
                         }
+                        pRow[x] = v;
                     }
                 }
 
-                sptr += sbpp;
-                dptr += dbpp * 4;
+                for (size_t x = 0; x < width; ++x)
+                {
+                    pRow[x] = XMVectorScale(pRow[x], scale);
+                }
             }
 
-            pSrc += cImage.rowPitch;
-            pDest += rowPitch * 4;
+            hr = PushStreamRow(enc, 0, pRow);
+            if (FAILED(hr))
+                return hr;
+        }
+
+        for (auto it = enc.levels.cbegin(); it != enc.levels.cend(); ++it)
+        {
+            if (it->rowsIn != it->height || it->bandRows)
+                return E_UNEXPECTED;
         }
 
         return S_OK;
     }
+
+    //-------------------------------------------------------------------------------------
+    HRESULT StreamCompressBC(
+        const Image& srcImage,
+        const ScratchImage& cImage,
+        DWORD bcflags,
+        DWORD srgb,
+        float threshold)
+    {
+        const TexMetadata& metadata = cImage.GetMetadata();
+
+        StreamEncoder enc;
+        if (!DetermineEncoderSettings(metadata.format, enc.pfEncode, enc.blocksize, enc.cflags))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        enc.bandHeight = 4;
+        enc.bcflags = bcflags;
+        enc.srgb = srgb;
+        enc.threshold = threshold;
+
+        enc.levels.resize(metadata.mipLevels);
+        for (size_t level = 0; level < metadata.mipLevels; ++level)
+        {
+            StreamLevel& sl = enc.levels[level];
+            sl.dest = cImage.GetImage(level, 0, 0);
+            if (!sl.dest)
+                return E_POINTER;
+
+            sl.width = sl.dest->width;
+            sl.height = sl.dest->height;
+        }
+
+        return StreamLevels(srcImage, enc);
+    }
 }
 
 //-------------------------------------------------------------------------------------
@@ -728,10 +1378,25 @@ HRESULT DirectX::Decompress(
     const Image& cImage,
     DXGI_FORMAT format,
     ScratchImage& image)
+{
+    return Decompress(cImage, format, TEX_COMPRESS_DEFAULT, image);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::Decompress(
+    const Image& cImage,
+    DXGI_FORMAT format,
+    DWORD flags,
+    ScratchImage& image)
 {
     if (!IsCompressed(cImage.format) || IsCompressed(format))
         return E_INVALIDARG;
 
+#ifndef _OPENMP
+    if (flags & TEX_COMPRESS_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
     if (format == DXGI_FORMAT_UNKNOWN)
     {
         // Pick a default decompressed format based on BC input format
@@ -764,7 +1429,7 @@ HRESULT DirectX::Decompress(
     }
 
     // Decompress single image
-    hr = DecompressBC(cImage, *img);
+    hr = DecompressBC(cImage, *img, (flags & TEX_COMPRESS_PARALLEL) != 0);
     if (FAILED(hr))
         image.Release();
 
@@ -778,6 +1443,18 @@ HRESULT DirectX::Decompress(
     const TexMetadata& metadata,
     DXGI_FORMAT format,
     ScratchImage& images)
+{
+    return Decompress(cImages, nimages, metadata, format, TEX_COMPRESS_DEFAULT, images);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::Decompress(
+    const Image* cImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DXGI_FORMAT format,
+    DWORD flags,
+    ScratchImage& images)
 {
     if (!cImages || !nimages)
         return E_INVALIDARG;
@@ -785,6 +1462,11 @@ HRESULT DirectX::Decompress(
     if (!IsCompressed(metadata.format) || IsCompressed(format))
         return E_INVALIDARG;
 
+#ifndef _OPENMP
+    if (flags & TEX_COMPRESS_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
     if (format == DXGI_FORMAT_UNKNOWN)
     {
         // Pick a default decompressed format based on BC input format
@@ -842,7 +1524,7 @@ HRESULT DirectX::Decompress(
             return E_FAIL;
         }
 
-        hr = DecompressBC(src, dest[index]);
+        hr = DecompressBC(src, dest[index], (flags & TEX_COMPRESS_PARALLEL) != 0);
         if (FAILED(hr))
         {
             images.Release();
@@ -852,3 +1534,111 @@ HRESULT DirectX::Decompress(
 
     return S_OK;
 }
+
+
+//-------------------------------------------------------------------------------------
+// Streamed resize + mipmap generation + compression
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::StreamCompress(
+    const Image& srcImage,
+    size_t width,
+    size_t height,
+    size_t levels,
+    DXGI_FORMAT format,
+    DWORD compress,
+    float threshold,
+    ScratchImage& cImage)
+{
+    if (!srcImage.pixels || !width || !height)
+        return E_INVALIDARG;
+
+    if (!IsCompressed(format))
+        return E_INVALIDARG;
+
+    if (IsTypeless(format)
+        || IsTypeless(srcImage.format) || IsPlanar(srcImage.format) || IsPalettized(srcImage.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    // Only integer box reductions are streamed; callers fall back to Resize + GenerateMipMaps otherwise
+    if ((srcImage.width % width) || (srcImage.height % height))
+        return E_INVALIDARG;
+
+    if (levels != 1)
+    {
+        if ((width & (width - 1)) || (height & (height - 1)))
+            return E_INVALIDARG;
+    }
+
+    if (compress & TEX_COMPRESS_PARALLEL)
+        return E_NOTIMPL;
+
+    HRESULT hr = cImage.Initialize2D(format, width, height, 1, levels);
+    if (FAILED(hr))
+        return hr;
+
+    hr = StreamCompressBC(srcImage, cImage, GetBCFlags(compress), GetSRGBFlags(compress), threshold);
+    if (FAILED(hr))
+        cImage.Release();
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::StreamMipChain(
+    const Image& srcImage,
+    size_t width,
+    size_t height,
+    size_t levels,
+    DXGI_FORMAT bandFormat,
+    size_t bandRows,
+    std::function<HRESULT __cdecl(size_t level, size_t y, const Image& band)> bandReady)
+{
+    if (!srcImage.pixels || !width || !height || !bandReady)
+        return E_INVALIDARG;
+
+    if (!bandRows || (bandRows % 4))
+        return E_INVALIDARG;
+
+    if (IsCompressed(bandFormat) || IsTypeless(bandFormat) || IsPlanar(bandFormat) || IsPalettized(bandFormat)
+        || IsTypeless(srcImage.format) || IsPlanar(srcImage.format) || IsPalettized(srcImage.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    if ((srcImage.width % width) || (srcImage.height % height))
+        return E_INVALIDARG;
+
+    if (levels != 1)
+    {
+        if ((width & (width - 1)) || (height & (height - 1)))
+            return E_INVALIDARG;
+    }
+
+    if (!levels)
+    {
+        levels = 1;
+        for (size_t w = width, h = height; w > 1 || h > 1; w = std::max<size_t>(1, w >> 1), h = std::max<size_t>(1, h >> 1))
+            ++levels;
+    }
+
+    StreamEncoder enc;
+    enc.bandHeight = bandRows;
+    enc.bandFormat = bandFormat;
+    enc.bandReady = bandReady;
+
+    size_t rowPitch, slicePitch;
+    ComputePitch(bandFormat, width, bandRows, rowPitch, slicePitch, CP_FLAGS_NONE);
+    enc.bandPixels.reset(new (std::nothrow) uint8_t[slicePitch]);
+    if (!enc.bandPixels)
+        return E_OUTOFMEMORY;
+
+    enc.levels.resize(levels);
+    for (size_t level = 0; level < levels; ++level)
+    {
+        StreamLevel& sl = enc.levels[level];
+        sl.dest = nullptr;
+        sl.width = std::max<size_t>(1, width >> level);
+        sl.height = std::max<size_t>(1, height >> level);
+    }
+
+    return StreamLevels(srcImage, enc);
+}
@@ -11,6 +11,13 @@
 
 #include "DirectXTexP.h"
 
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 using namespace DirectX;
 using namespace DirectX::PackedVector;
 using Microsoft::WRL::ComPtr;
@@ -710,6 +717,522 @@ bool DirectX::_ExpandScanline(
 }
 
 
+//-------------------------------------------------------------------------------------
+// Whole-row fast paths for 8-bit UNORM formats
+//
+// SSE2 is the baseline, SSE4.1 and AVX2 versions are picked at runtime. Results are
+// identical to the per-pixel DirectXMath paths below.
+//-------------------------------------------------------------------------------------
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+
+#if defined(__clang__) || defined(__GNUC__)
+#define SCANLINE_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SCANLINE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SCANLINE_TARGET_SSE41
+#define SCANLINE_TARGET_AVX2
+#endif
+
+namespace
+{
+    enum SCANLINE_ISA
+    {
+        SCANLINE_ISA_SSE2 = 0,
+        SCANLINE_ISA_SSE41,
+        SCANLINE_ISA_AVX2,
+    };
+
+    SCANLINE_ISA DetectScanlineISA()
+    {
+#if defined(__clang__) || defined(__GNUC__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return SCANLINE_ISA_AVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return SCANLINE_ISA_SSE41;
+#else
+        int info[4] = {};
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        const bool sse41 = (info[2] & (1 << 19)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+
+        if (maxLeaf >= 7 && osxsave && avx && ((_xgetbv(0) & 0x6) == 0x6))
+        {
+            __cpuidex(info, 7, 0);
+            if (info[1] & (1 << 5))
+                return SCANLINE_ISA_AVX2;
+        }
+
+        if (sse41)
+            return SCANLINE_ISA_SSE41;
+#endif
+        return SCANLINE_ISA_SSE2;
+    }
+
+    const SCANLINE_ISA g_ScanlineISA = DetectScanlineISA();
+
+    const XMVECTORF32 g_UByteNScale = { { { 1.f / 255.f, 1.f / 255.f, 1.f / 255.f, 1.f / 255.f } } };
+    const XMVECTORF32 g_UByteNMax = { { { 255.f, 255.f, 255.f, 255.f } } };
+    const XMVECTORF32 g_UByteNHalf = { { { 0.5f, 0.5f, 0.5f, 0.5f } } };
+
+    // XMLoadUByteN4 scales by 1/255, so the fast loads produce exactly these values
+    inline float UByteNToFloat(uint8_t v)
+    {
+        return float(v) * (1.f / 255.f);
+    }
+
+    //--- sRGB <-> linear tables, built from XMColorSRGBToRGB/XMColorRGBToSRGB so results match them ---
+    struct SRGBTables
+    {
+        float       toLinear[256];
+        float       toSRGB8[256];   // smallest linear value stored as k (bias + truncate)
+
+        SRGBTables()
+        {
+            for (size_t i = 0; i < 256; ++i)
+            {
+                toLinear[i] = XMVectorGetX(XMColorSRGBToRGB(XMVectorReplicate(UByteNToFloat(uint8_t(i)))));
+            }
+
+            toSRGB8[0] = 0.f;
+            for (uint32_t k = 1; k < 256; ++k)
+            {
+                // Bisect over the bit patterns of positive floats, which sort like the values
+                uint32_t lo = 0;
+                uint32_t hi = 0x3F800000; // 1.0f
+                while (lo < hi)
+                {
+                    uint32_t mid = lo + ((hi - lo) >> 1);
+                    if (StoreSRGB8(AsFloat(mid)) >= k)
+                        hi = mid;
+                    else
+                        lo = mid + 1;
+                }
+                toSRGB8[k] = AsFloat(lo);
+            }
+        }
+
+        static float AsFloat(uint32_t bits)
+        {
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+
+        // Mirrors XMColorRGBToSRGB followed by the R8G8B8A8 store (bias, saturate, scale, truncate)
+        static uint32_t StoreSRGB8(float v)
+        {
+            float s = XMVectorGetX(XMColorRGBToSRGB(XMVectorReplicate(v))) + (0.5f / 255.f);
+            s = std::max<float>(std::min<float>(s, 1.f), 0.f);
+            return uint32_t(s * 255.f);
+        }
+    };
+
+    const SRGBTables& GetSRGBTables()
+    {
+        static const SRGBTables s_tables;
+        return s_tables;
+    }
+
+    inline uint8_t LinearToSRGB8(const float* thresholds, float v)
+    {
+        // Branch-free search for the last threshold <= v
+        uint32_t k = 0;
+        for (uint32_t step = 128; step > 0; step >>= 1)
+        {
+            k += (thresholds[k + step] <= v) ? step : 0;
+        }
+        return uint8_t(k);
+    }
+
+    //--- Loads ---
+    void LoadRowRGBA8_SSE2(XMVECTOR* pDest, const uint8_t* pSrc, size_t count, bool bgr)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i * 4));
+            const __m128i lo = _mm_unpacklo_epi8(v, zero);
+            const __m128i hi = _mm_unpackhi_epi8(v, zero);
+            __m128 p[4] =
+            {
+                _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)),
+                _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)),
+                _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)),
+                _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)),
+            };
+            for (size_t j = 0; j < 4; ++j)
+            {
+                __m128 f = _mm_mul_ps(p[j], g_UByteNScale);
+                if (bgr)
+                    f = XM_PERMUTE_PS(f, _MM_SHUFFLE(3, 0, 1, 2));
+                pDest[i + j] = f;
+            }
+        }
+
+        for (; i < count; ++i)
+        {
+            const uint8_t* s = pSrc + i * 4;
+            __m128 f = _mm_mul_ps(_mm_setr_ps(float(s[0]), float(s[1]), float(s[2]), float(s[3])), g_UByteNScale);
+            if (bgr)
+                f = XM_PERMUTE_PS(f, _MM_SHUFFLE(3, 0, 1, 2));
+            pDest[i] = f;
+        }
+    }
+
+    SCANLINE_TARGET_SSE41
+    void LoadRowRGBA8_SSE41(XMVECTOR* pDest, const uint8_t* pSrc, size_t count, bool bgr)
+    {
+        const __m128i swap = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i * 4));
+            if (bgr)
+                v = _mm_shuffle_epi8(v, swap);
+
+            pDest[i] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(v)), g_UByteNScale);
+            pDest[i + 1] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4))), g_UByteNScale);
+            pDest[i + 2] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 8))), g_UByteNScale);
+            pDest[i + 3] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 12))), g_UByteNScale);
+        }
+
+        if (i < count)
+            LoadRowRGBA8_SSE2(pDest + i, pSrc + i * 4, count - i, bgr);
+    }
+
+    SCANLINE_TARGET_AVX2
+    void LoadRowRGBA8_AVX2(XMVECTOR* pDest, const uint8_t* pSrc, size_t count, bool bgr)
+    {
+        const __m128i swap = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        const __m256 scale = _mm256_set1_ps(1.f / 255.f);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i * 4));
+            if (bgr)
+                v = _mm_shuffle_epi8(v, swap);
+
+            const __m256 f0 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v)), scale);
+            const __m256 f1 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8))), scale);
+            _mm256_storeu_ps(reinterpret_cast<float*>(pDest + i), f0);
+            _mm256_storeu_ps(reinterpret_cast<float*>(pDest + i + 2), f1);
+        }
+
+        if (i < count)
+            LoadRowRGBA8_SSE2(pDest + i, pSrc + i * 4, count - i, bgr);
+    }
+
+    void LoadRowRGBA8(XMVECTOR* pDest, const uint8_t* pSrc, size_t count, bool bgr)
+    {
+        switch (g_ScanlineISA)
+        {
+        case SCANLINE_ISA_AVX2:     LoadRowRGBA8_AVX2(pDest, pSrc, count, bgr); break;
+        case SCANLINE_ISA_SSE41:    LoadRowRGBA8_SSE41(pDest, pSrc, count, bgr); break;
+        default:                    LoadRowRGBA8_SSE2(pDest, pSrc, count, bgr); break;
+        }
+    }
+
+    void LoadRowRG8(XMVECTOR* pDest, const uint8_t* pSrc, size_t count)
+    {
+        // (r, g, 0, 1)
+        const __m128 zw = _mm_setr_ps(0.f, 1.f, 0.f, 1.f);
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc + i * 2));
+            v = _mm_unpacklo_epi8(v, zero);
+            const __m128 f0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), g_UByteNScale);
+            const __m128 f1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)), g_UByteNScale);
+            pDest[i] = _mm_movelh_ps(f0, zw);
+            pDest[i + 1] = _mm_movehl_ps(zw, f0);
+            pDest[i + 2] = _mm_movelh_ps(f1, zw);
+            pDest[i + 3] = _mm_movehl_ps(zw, f1);
+        }
+
+        for (; i < count; ++i)
+        {
+            pDest[i] = XMVectorSet(UByteNToFloat(pSrc[i * 2]), UByteNToFloat(pSrc[i * 2 + 1]), 0.f, 1.f);
+        }
+    }
+
+    void LoadRowR8(XMVECTOR* pDest, const uint8_t* pSrc, size_t count)
+    {
+        // (r, 0, 0, 1), scaled by division like the R8_UNORM case of _LoadScanline
+        const __m128 zw = _mm_setr_ps(0.f, 0.f, 0.f, 1.f);
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            int32_t bits;
+            memcpy(&bits, pSrc + i, sizeof(bits));
+            __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bits), zero);
+            const __m128 f = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), g_UByteNMax);
+            pDest[i] = _mm_move_ss(zw, f);
+            pDest[i + 1] = _mm_move_ss(zw, XM_PERMUTE_PS(f, _MM_SHUFFLE(1, 1, 1, 1)));
+            pDest[i + 2] = _mm_move_ss(zw, XM_PERMUTE_PS(f, _MM_SHUFFLE(2, 2, 2, 2)));
+            pDest[i + 3] = _mm_move_ss(zw, XM_PERMUTE_PS(f, _MM_SHUFFLE(3, 3, 3, 3)));
+        }
+
+        for (; i < count; ++i)
+        {
+            pDest[i] = XMVectorSet(static_cast<float>(pSrc[i]) / 255.f, 0.f, 0.f, 1.f);
+        }
+    }
+
+    //--- Stores ---
+    inline __m128i PackUByteN4(__m128 p0, __m128 p1, __m128 p2, __m128 p3)
+    {
+        // Bias, saturate, scale and truncate, as the R8G8B8A8_UNORM case of _StoreScanline
+        __m128i i0 = _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_add_ps(p0, g_8BitBias), g_XMZero), g_XMOne), g_UByteNMax));
+        __m128i i1 = _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_add_ps(p1, g_8BitBias), g_XMZero), g_XMOne), g_UByteNMax));
+        __m128i i2 = _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_add_ps(p2, g_8BitBias), g_XMZero), g_XMOne), g_UByteNMax));
+        __m128i i3 = _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_add_ps(p3, g_8BitBias), g_XMZero), g_XMOne), g_UByteNMax));
+        return _mm_packus_epi16(_mm_packs_epi32(i0, i1), _mm_packs_epi32(i2, i3));
+    }
+
+    void StoreRowRGBA8_SSE2(uint8_t* pDest, const XMVECTOR* pSrc, size_t count, bool bgr)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 p0 = pSrc[i];
+            __m128 p1 = pSrc[i + 1];
+            __m128 p2 = pSrc[i + 2];
+            __m128 p3 = pSrc[i + 3];
+            if (bgr)
+            {
+                p0 = XM_PERMUTE_PS(p0, _MM_SHUFFLE(3, 0, 1, 2));
+                p1 = XM_PERMUTE_PS(p1, _MM_SHUFFLE(3, 0, 1, 2));
+                p2 = XM_PERMUTE_PS(p2, _MM_SHUFFLE(3, 0, 1, 2));
+                p3 = XM_PERMUTE_PS(p3, _MM_SHUFFLE(3, 0, 1, 2));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + i * 4), PackUByteN4(p0, p1, p2, p3));
+        }
+
+        for (; i < count; ++i)
+        {
+            __m128 p = pSrc[i];
+            if (bgr)
+                p = XM_PERMUTE_PS(p, _MM_SHUFFLE(3, 0, 1, 2));
+            const int packed = _mm_cvtsi128_si32(PackUByteN4(p, p, p, p));
+            memcpy(pDest + i * 4, &packed, 4);
+        }
+    }
+
+    SCANLINE_TARGET_AVX2
+    void StoreRowRGBA8_AVX2(uint8_t* pDest, const XMVECTOR* pSrc, size_t count, bool bgr)
+    {
+        const __m256 bias = _mm256_set1_ps(0.5f / 255.f);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.f);
+        const __m256 scale = _mm256_set1_ps(255.f);
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i q[4];
+            for (size_t j = 0; j < 4; ++j)
+            {
+                __m256 p = _mm256_loadu_ps(reinterpret_cast<const float*>(pSrc + i + j * 2));
+                if (bgr)
+                    p = _mm256_permute_ps(p, _MM_SHUFFLE(3, 0, 1, 2));
+                p = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_add_ps(p, bias), zero), one), scale);
+                q[j] = _mm256_cvttps_epi32(p);
+            }
+
+            // Packs work per 128-bit lane, the permute puts the 8 pixels back in order
+            const __m256i w = _mm256_packus_epi16(_mm256_packs_epi32(q[0], q[1]), _mm256_packs_epi32(q[2], q[3]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDest + i * 4), _mm256_permutevar8x32_epi32(w, order));
+        }
+
+        if (i < count)
+            StoreRowRGBA8_SSE2(pDest + i * 4, pSrc + i, count - i, bgr);
+    }
+
+    void StoreRowRGBA8(uint8_t* pDest, const XMVECTOR* pSrc, size_t count, bool bgr)
+    {
+        if (g_ScanlineISA == SCANLINE_ISA_AVX2)
+            StoreRowRGBA8_AVX2(pDest, pSrc, count, bgr);
+        else
+            StoreRowRGBA8_SSE2(pDest, pSrc, count, bgr);
+    }
+
+    void StoreRowRG8(uint8_t* pDest, const XMVECTOR* pSrc, size_t count)
+    {
+        // Saturate, scale and round half up, as XMStoreUByteN2
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 f0 = _mm_movelh_ps(pSrc[i], pSrc[i + 1]);
+            __m128 f1 = _mm_movelh_ps(pSrc[i + 2], pSrc[i + 3]);
+            f0 = _mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(f0, g_XMZero), g_XMOne), g_UByteNMax), g_UByteNHalf);
+            f1 = _mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(f1, g_XMZero), g_XMOne), g_UByteNMax), g_UByteNHalf);
+            const __m128i w = _mm_packs_epi32(_mm_cvttps_epi32(f0), _mm_cvttps_epi32(f1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(pDest + i * 2), _mm_packus_epi16(w, w));
+        }
+
+        for (; i < count; ++i)
+        {
+            XMStoreUByteN2(reinterpret_cast<XMUBYTEN2*>(pDest + i * 2), pSrc[i]);
+        }
+    }
+
+    void StoreRowR8(uint8_t* pDest, const XMVECTOR* pSrc, size_t count)
+    {
+        // Saturate, scale and truncate, as the R8_UNORM case of _StoreScanline
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 f = _mm_movelh_ps(_mm_unpacklo_ps(pSrc[i], pSrc[i + 1]), _mm_unpacklo_ps(pSrc[i + 2], pSrc[i + 3]));
+            f = _mm_mul_ps(_mm_max_ps(_mm_min_ps(f, g_XMOne), g_XMZero), g_UByteNMax);
+            const __m128i w = _mm_packs_epi32(_mm_cvttps_epi32(f), _mm_setzero_si128());
+            const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(w, w));
+            memcpy(pDest + i, &packed, 4);
+        }
+
+        for (; i < count; ++i)
+        {
+            float v = XMVectorGetX(pSrc[i]);
+            v = std::max<float>(std::min<float>(v, 1.f), 0.f);
+            pDest[i] = static_cast<uint8_t>(v * 255.f);
+        }
+    }
+
+    void StoreRowRGBA8SRGB(uint8_t* pDest, const XMVECTOR* pSrc, size_t count, bool bgr)
+    {
+        const float* thresholds = GetSRGBTables().toSRGB8;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            XMFLOAT4A f;
+            XMStoreFloat4A(&f, pSrc[i]);
+
+            // Alpha isn't gamma corrected
+            float a = std::max<float>(std::min<float>(f.w + (0.5f / 255.f), 1.f), 0.f);
+
+            uint8_t* d = pDest + i * 4;
+            d[bgr ? 2 : 0] = LinearToSRGB8(thresholds, f.x);
+            d[1] = LinearToSRGB8(thresholds, f.y);
+            d[bgr ? 0 : 2] = LinearToSRGB8(thresholds, f.z);
+            d[3] = uint8_t(a * 255.f);
+        }
+    }
+
+    //--- In-place sRGB -> linear for values that came from 8-bit UNORM data ---
+    void SRGBToLinearRow(XMVECTOR* pBuffer, size_t count)
+    {
+        const float* toLinear = GetSRGBTables().toLinear;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            XMFLOAT4A f;
+            XMStoreFloat4A(&f, pBuffer[i]);
+
+            // Use the table only when each channel is exactly an 8-bit UNORM value
+            const float* c = &f.x;
+            bool exact = true;
+            float lin[3];
+            for (size_t j = 0; j < 3; ++j)
+            {
+                const float scaled = c[j] * 255.f + 0.5f;
+                if (!(scaled >= 0.f && scaled < 256.f))
+                {
+                    exact = false;
+                    break;
+                }
+
+                const auto k = static_cast<uint8_t>(scaled);
+                if (UByteNToFloat(k) != c[j])
+                {
+                    exact = false;
+                    break;
+                }
+                lin[j] = toLinear[k];
+            }
+
+            pBuffer[i] = exact ? XMVectorSet(lin[0], lin[1], lin[2], f.w) : XMColorSRGBToRGB(pBuffer[i]);
+        }
+    }
+
+    //--- Entry points used by _LoadScanline/_StoreScanline ---
+    bool LoadScanlineFast(XMVECTOR* pDestination, size_t count, const void* pSource, size_t size, DXGI_FORMAT format)
+    {
+        auto sPtr = static_cast<const uint8_t*>(pSource);
+
+        switch (static_cast<int>(format))
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            if (size < 4)
+                return false;
+            LoadRowRGBA8(pDestination, sPtr, std::min<size_t>(count, size / 4),
+                format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB);
+            return true;
+
+        case DXGI_FORMAT_R8G8_UNORM:
+            if (size < 2)
+                return false;
+            LoadRowRG8(pDestination, sPtr, std::min<size_t>(count, size / 2));
+            return true;
+
+        case DXGI_FORMAT_R8_UNORM:
+            if (size < 1)
+                return false;
+            LoadRowR8(pDestination, sPtr, std::min<size_t>(count, size));
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    bool StoreScanlineFast(void* pDestination, size_t size, DXGI_FORMAT format, const XMVECTOR* pSource, size_t count)
+    {
+        auto dPtr = static_cast<uint8_t*>(pDestination);
+
+        switch (static_cast<int>(format))
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            if (size < 4)
+                return false;
+            StoreRowRGBA8(dPtr, pSource, std::min<size_t>(count, size / 4),
+                format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB);
+            return true;
+
+        case DXGI_FORMAT_R8G8_UNORM:
+            if (size < 2)
+                return false;
+            StoreRowRG8(dPtr, pSource, std::min<size_t>(count, size / 2));
+            return true;
+
+        case DXGI_FORMAT_R8_UNORM:
+            if (size < 1)
+                return false;
+            StoreRowR8(dPtr, pSource, std::min<size_t>(count, size));
+            return true;
+
+        default:
+            return false;
+        }
+    }
+}
+
+#endif // _XM_SSE_INTRINSICS_ && !_XM_NO_INTRINSICS_
+
+
 //-------------------------------------------------------------------------------------
 // Loads an image row into standard RGBA XMVECTOR (aligned) array
 //-------------------------------------------------------------------------------------
@@ -772,6 +1295,11 @@ _Use_decl_annotations_ bool DirectX::_LoadScanline(
 
     const XMVECTOR* ePtr = pDestination + count;
 
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+    if (LoadScanlineFast(pDestination, count, pSource, size, format))
+        return true;
+#endif
+
     switch (static_cast<int>(format))
     {
     case DXGI_FORMAT_R32G32B32A32_FLOAT:
@@ -1621,6 +2149,11 @@ bool DirectX::_StoreScanline(
 
     const XMVECTOR* ePtr = pSource + count;
 
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+    if (StoreScanlineFast(pDestination, size, format, pSource, count))
+        return true;
+#endif
+
     switch (static_cast<int>(format))
     {
     case DXGI_FORMAT_R32G32B32A32_FLOAT:
@@ -2781,6 +3314,24 @@ bool DirectX::_StoreScanlineLinear(
     // sRGB output processing (Linear RGB -> sRGB)
     if (flags & TEX_FILTER_SRGB_OUT)
     {
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            if (size < 4)
+                return false;
+            StoreRowRGBA8SRGB(static_cast<uint8_t*>(pDestination), pSource, std::min<size_t>(count, size / 4),
+                format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB);
+            return true;
+
+        default:
+            break;
+        }
+#endif
+
         // To avoid the need for another temporary scanline buffer, we allow this function to overwrite the source buffer in-place
         // Given the intended usage in the filtering routines, this is not a problem.
         XMVECTOR* ptr = pSource;
@@ -2858,11 +3409,15 @@ bool DirectX::_LoadScanlineLinear(
         // sRGB input processing (sRGB -> Linear RGB)
         if (flags & TEX_FILTER_SRGB_IN)
         {
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+            SRGBToLinearRow(pDestination, count);
+#else
             XMVECTOR* ptr = pDestination;
             for (size_t i = 0; i < count; ++i, ++ptr)
             {
                 *ptr = XMColorSRGBToRGB(*ptr);
             }
+#endif
         }
 
         return true;
@@ -3098,11 +3653,15 @@ void DirectX::_ConvertScanline(
     {
         if (!(in->flags & CONVF_DEPTH) && ((in->flags & CONVF_FLOAT) || (in->flags & CONVF_UNORM)))
         {
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+            SRGBToLinearRow(pBuffer, count);
+#else
             XMVECTOR* ptr = pBuffer;
             for (size_t i = 0; i < count; ++i, ++ptr)
             {
                 *ptr = XMColorSRGBToRGB(*ptr);
             }
+#endif
         }
     }
 
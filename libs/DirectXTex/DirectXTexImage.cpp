@@ -11,6 +11,9 @@
 
 #include "DirectXTexP.h"
 
+#include <map>
+#include <mutex>
+
 namespace DirectX
 {
     extern bool _CalculateMipLevels(_In_ size_t width, _In_ size_t height, _Inout_ size_t& mipLevels);
@@ -253,6 +256,162 @@ bool DirectX::_SetupImageArray(
 }
 
 
+//=====================================================================================
+// ScratchImagePool - Recycling allocator for ScratchImage pixels
+//=====================================================================================
+
+namespace
+{
+    // Smaller blobs are cheap to allocate and not worth keeping around
+    const size_t POOL_MIN_SIZE = 64 * 1024;
+
+    thread_local ScratchImagePool* s_currentPool = nullptr;
+
+    // Rounds up to one of 4 classes per power of 2, so at most 25% of a blob is wasted
+    inline size_t PoolSizeClass(size_t size)
+    {
+        if (size <= POOL_MIN_SIZE)
+            return size;
+
+        size_t bits = 0;
+        for (size_t v = size - 1; v > 1; v >>= 1)
+            ++bits;
+
+        const size_t step = size_t(1) << (bits - 2);
+        return (size + step - 1) & ~(step - 1);
+    }
+}
+
+struct ScratchImagePool::Impl
+{
+    mutable std::mutex                          lock;
+    std::map<size_t, std::vector<uint8_t*>>     retained;
+    size_t                                      maxRetainedBytes;
+    ScratchImagePoolStats                       stats;
+
+    explicit Impl(size_t maxRetained) : maxRetainedBytes(maxRetained), stats{} {}
+};
+
+_Use_decl_annotations_
+ScratchImagePool::ScratchImagePool(size_t maxRetainedBytes) :
+    m_impl(new Impl(maxRetainedBytes))
+{
+}
+
+ScratchImagePool::~ScratchImagePool()
+{
+    assert(!m_impl->stats.outstandingBytes);
+
+    Trim();
+    delete m_impl;
+}
+
+void ScratchImagePool::Trim()
+{
+    std::lock_guard<std::mutex> lock(m_impl->lock);
+
+    for (auto it = m_impl->retained.begin(); it != m_impl->retained.end(); ++it)
+    {
+        for (auto blob = it->second.begin(); blob != it->second.end(); ++blob)
+        {
+            _aligned_free(*blob);
+        }
+    }
+
+    m_impl->retained.clear();
+    m_impl->stats.retainedBytes = 0;
+    m_impl->stats.retainedBlocks = 0;
+}
+
+ScratchImagePoolStats ScratchImagePool::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->lock);
+    return m_impl->stats;
+}
+
+ScratchImagePool* ScratchImagePool::GetCurrent()
+{
+    return s_currentPool;
+}
+
+_Use_decl_annotations_
+uint8_t* ScratchImagePool::Allocate(size_t size)
+{
+    const size_t capacity = PoolSizeClass(size);
+
+    {
+        std::lock_guard<std::mutex> lock(m_impl->lock);
+
+        ++m_impl->stats.allocations;
+
+        auto it = m_impl->retained.find(capacity);
+        if (it != m_impl->retained.end() && !it->second.empty())
+        {
+            uint8_t* memory = it->second.back();
+            it->second.pop_back();
+
+            ++m_impl->stats.hits;
+            m_impl->stats.retainedBytes -= capacity;
+            --m_impl->stats.retainedBlocks;
+            m_impl->stats.outstandingBytes += capacity;
+            return memory;
+        }
+    }
+
+    auto memory = static_cast<uint8_t*>(_aligned_malloc(capacity, 16));
+    if (memory)
+    {
+        std::lock_guard<std::mutex> lock(m_impl->lock);
+        m_impl->stats.outstandingBytes += capacity;
+    }
+
+    return memory;
+}
+
+_Use_decl_annotations_
+void ScratchImagePool::Free(uint8_t* memory, size_t size)
+{
+    if (!memory)
+        return;
+
+    const size_t capacity = PoolSizeClass(size);
+
+    {
+        std::lock_guard<std::mutex> lock(m_impl->lock);
+
+        assert(m_impl->stats.outstandingBytes >= capacity);
+        m_impl->stats.outstandingBytes -= capacity;
+
+        if (capacity > POOL_MIN_SIZE && m_impl->stats.retainedBytes + capacity <= m_impl->maxRetainedBytes)
+        {
+            m_impl->retained[capacity].push_back(memory);
+
+            m_impl->stats.retainedBytes += capacity;
+            ++m_impl->stats.retainedBlocks;
+            m_impl->stats.peakRetainedBytes = std::max(m_impl->stats.peakRetainedBytes, m_impl->stats.retainedBytes);
+            return;
+        }
+
+        if (capacity > POOL_MIN_SIZE)
+            m_impl->stats.discardedBytes += capacity;
+    }
+
+    _aligned_free(memory);
+}
+
+_Use_decl_annotations_
+ScratchImagePool::Scope::Scope(ScratchImagePool& pool) :
+    m_previous(s_currentPool)
+{
+    s_currentPool = &pool;
+}
+
+ScratchImagePool::Scope::~Scope()
+{
+    s_currentPool = m_previous;
+}
+
+
 //=====================================================================================
 // ScratchImage - Bitmap image container
 //=====================================================================================
@@ -268,16 +427,34 @@ ScratchImage& ScratchImage::operator= (ScratchImage&& moveFrom) noexcept
         m_metadata = moveFrom.m_metadata;
         m_image = moveFrom.m_image;
         m_memory = moveFrom.m_memory;
+        m_pool = moveFrom.m_pool;
 
         moveFrom.m_nimages = 0;
         moveFrom.m_size = 0;
         moveFrom.m_image = nullptr;
         moveFrom.m_memory = nullptr;
+        moveFrom.m_pool = nullptr;
     }
     return *this;
 }
 
 
+//-------------------------------------------------------------------------------------
+// Pixel storage comes from the pool bound to this thread, if any
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+uint8_t* ScratchImage::AllocatePixels(size_t size)
+{
+    assert(!m_memory);
+
+    m_pool = ScratchImagePool::GetCurrent();
+    if (m_pool)
+        return m_pool->Allocate(size);
+
+    return static_cast<uint8_t*>(_aligned_malloc(size, 16));
+}
+
+
 //-------------------------------------------------------------------------------------
 // Methods
 //-------------------------------------------------------------------------------------
@@ -351,7 +528,7 @@ HRESULT ScratchImage::Initialize(const TexMetadata& mdata, DWORD flags)
     m_nimages = nimages;
     memset(m_image, 0, sizeof(Image) * nimages);
 
-    m_memory = static_cast<uint8_t*>(_aligned_malloc(pixelSize, 16));
+    m_memory = AllocatePixels(pixelSize);
     if (!m_memory)
     {
         Release();
@@ -418,7 +595,7 @@ HRESULT ScratchImage::Initialize2D(DXGI_FORMAT fmt, size_t width, size_t height,
     m_nimages = nimages;
     memset(m_image, 0, sizeof(Image) * nimages);
 
-    m_memory = static_cast<uint8_t*>(_aligned_malloc(pixelSize, 16));
+    m_memory = AllocatePixels(pixelSize);
     if (!m_memory)
     {
         Release();
@@ -471,7 +648,7 @@ HRESULT ScratchImage::Initialize3D(DXGI_FORMAT fmt, size_t width, size_t height,
     m_nimages = nimages;
     memset(m_image, 0, sizeof(Image) * nimages);
 
-    m_memory = static_cast<uint8_t*>(_aligned_malloc(pixelSize, 16));
+    m_memory = AllocatePixels(pixelSize);
     if (!m_memory)
     {
         Release();
@@ -680,7 +857,6 @@ HRESULT ScratchImage::Initialize3DFromImages(const Image* images, size_t depth,
 void ScratchImage::Release()
 {
     m_nimages = 0;
-    m_size = 0;
 
     if (m_image)
     {
@@ -690,10 +866,16 @@ void ScratchImage::Release()
 
     if (m_memory)
     {
-        _aligned_free(m_memory);
+        if (m_pool)
+            m_pool->Free(m_memory, m_size);
+        else
+            _aligned_free(m_memory);
         m_memory = nullptr;
     }
 
+    m_size = 0;
+    m_pool = nullptr;
+
     memset(&m_metadata, 0, sizeof(m_metadata));
 }
 
@@ -11,6 +11,11 @@
 
 #include "DirectXTexP.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
 #include "filters.h"
 
 using namespace DirectX;
@@ -343,6 +348,43 @@ namespace
 
         return S_OK;
     }
+
+
+    // Averages 2x2 blocks of two 32bpp rows, four output pixels at a time
+    size_t IntegerBox2xRow32(const uint8_t* pRow0, const uint8_t* pRow1, uint8_t* pDest, size_t nwidth)
+    {
+        size_t x = 0;
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i bias = _mm_set1_epi16(2);
+        for (; x + 4 <= nwidth; x += 4)
+        {
+            __m128i sum[2];
+            for (size_t half = 0; half < 2; ++half)
+            {
+                const size_t offset = x * 8 + half * 16;
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0 + offset));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + offset));
+
+                // Vertical sums of source pixels 0,1 and 2,3 then horizontal sums of each pair
+                __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+                hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+                sum[half] = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), bias), 2);
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + x * 4), _mm_packus_epi16(sum[0], sum[1]));
+        }
+#else
+        UNREFERENCED_PARAMETER(pRow0);
+        UNREFERENCED_PARAMETER(pRow1);
+        UNREFERENCED_PARAMETER(pDest);
+        UNREFERENCED_PARAMETER(nwidth);
+#endif
+        return x;
+    }
 }
 
 
@@ -356,6 +398,12 @@ namespace DirectX
         _In_ size_t newWidth, _In_ size_t newHeight, _In_ DWORD filter, _Inout_ const Image* img);
         // Also used by Resize
 
+    bool _UseIntegerBoxFilter(_In_ DXGI_FORMAT format, _In_ DWORD filter);
+    HRESULT _ResizeIntegerBoxFilter(_In_ const Image& srcImage, _In_ const Image& destImage);
+        // Also used by Resize
+
+    extern HRESULT _ResizeUsingCustomFilters(_In_ const Image& srcImage, _In_ DWORD filter, _In_ const Image& destImage);
+
     bool _CalculateMipLevels(_In_ size_t width, _In_ size_t height, _Inout_ size_t& mipLevels)
     {
         if (mipLevels > 1)
@@ -610,12 +658,146 @@ namespace DirectX
 
         return hr;
     }
+
+
+    //-------------------------------------------------------------------------------------
+    // Integer box filter for 8-bit UNORM formats
+    //
+    // Every channel is averaged independently, which is what TEX_FILTER_SEPARATE_ALPHA asks
+    // for and is exact for integer reductions, so there is no need to go through WIC or
+    // expand the image to XMVECTORs.
+    //-------------------------------------------------------------------------------------
+    bool _UseIntegerBoxFilter(_In_ DXGI_FORMAT format, _In_ DWORD filter)
+    {
+        if (filter & (TEX_FILTER_FORCE_WIC | TEX_FILTER_SRGB))
+            return false;
+
+        switch (filter & TEX_FILTER_MASK)
+        {
+        case 0:
+        case TEX_FILTER_BOX:
+            break;
+
+        default:
+            return false;
+        }
+
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_R8G8_UNORM:
+        case DXGI_FORMAT_R8_UNORM:
+        case DXGI_FORMAT_A8_UNORM:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    HRESULT _ResizeIntegerBoxFilter(_In_ const Image& srcImage, _In_ const Image& destImage)
+    {
+        if (!srcImage.pixels || !destImage.pixels)
+            return E_POINTER;
+
+        assert(srcImage.format == destImage.format);
+
+        if (!destImage.width || !destImage.height
+            || (srcImage.width % destImage.width) || (srcImage.height % destImage.height))
+            return E_FAIL;
+
+        const size_t bpp = BitsPerPixel(srcImage.format) / 8;
+        if (bpp != 1 && bpp != 2 && bpp != 4)
+            return E_FAIL;
+
+        const size_t fx = srcImage.width / destImage.width;
+        const size_t fy = srcImage.height / destImage.height;
+        const size_t count = fx * fy;
+        if (count > (UINT32_MAX / 255))
+            return E_FAIL;
+
+        const size_t rowBytes = destImage.width * bpp;
+
+        std::unique_ptr<uint32_t[]> sums(new (std::nothrow) uint32_t[rowBytes]);
+        if (!sums)
+            return E_OUTOFMEMORY;
+
+        const uint8_t* pSrc = srcImage.pixels;
+        uint8_t* pDest = destImage.pixels;
+
+        for (size_t y = 0; y < destImage.height; ++y)
+        {
+            size_t x = 0;
+            if (fx == 2 && fy == 2 && bpp == 4)
+            {
+                x = IntegerBox2xRow32(pSrc, pSrc + srcImage.rowPitch, pDest, destImage.width) * bpp;
+            }
+
+            if (x < rowBytes)
+            {
+                memset(sums.get(), 0, sizeof(uint32_t) * rowBytes);
+
+                for (size_t sy = 0; sy < fy; ++sy)
+                {
+                    const uint8_t* sptr = pSrc + sy * srcImage.rowPitch + x * fx;
+                    uint32_t* pSum = sums.get();
+                    for (size_t dx = x; dx < rowBytes; dx += bpp)
+                    {
+                        for (size_t sx = 0; sx < fx; ++sx)
+                        {
+                            for (size_t c = 0; c < bpp; ++c)
+                            {
+                                pSum[dx + c] += *sptr++;
+                            }
+                        }
+                    }
+                }
+
+                const uint32_t bias = uint32_t(count / 2);
+                for (; x < rowBytes; ++x)
+                {
+                    pDest[x] = static_cast<uint8_t>((sums[x] + bias) / uint32_t(count));
+                }
+            }
+
+            pSrc += srcImage.rowPitch * fy;
+            pDest += destImage.rowPitch;
+        }
+
+        return S_OK;
+    }
 }
 
 namespace
 {
+    //--- whether the row-parallel custom filters can build this chain ---
+    bool UseParallelFiltering(_In_ DWORD filter, _In_ size_t width, _In_ size_t height)
+    {
+        if (!(filter & TEX_FILTER_PARALLEL))
+            return false;
+
+        switch (filter & TEX_FILTER_MASK)
+        {
+        case 0:
+        case TEX_FILTER_LINEAR:
+        case TEX_FILTER_CUBIC:
+        case TEX_FILTER_TRIANGLE:
+            return true;
+
+        case TEX_FILTER_BOX:
+            // The custom box filter only halves (FANT is the same filter), WIC handles other chains
+            return ispow2(width) && ispow2(height);
+
+        default:
+            return false;
+        }
+    }
+
+
     //--- determine when to use WIC vs. non-WIC paths ---
-    bool UseWICFiltering(_In_ DXGI_FORMAT format, _In_ DWORD filter)
+    bool UseWICFiltering(_In_ DXGI_FORMAT format, _In_ DWORD filter, _In_ size_t width, _In_ size_t height)
     {
         if (filter & TEX_FILTER_FORCE_NON_WIC)
         {
@@ -629,6 +811,12 @@ namespace
             return true;
         }
 
+        if (UseParallelFiltering(filter, width, height))
+        {
+            // Row-parallel filtering is only implemented by the non-WIC code paths
+            return false;
+        }
+
         if (IsSRGB(format) || (filter & TEX_FILTER_SRGB))
         {
             // Use non-WIC code paths for sRGB correct filtering
@@ -1063,6 +1251,61 @@ namespace
     }
 
 
+    //--- 2D Box Filter (8-bit integer) ---
+    HRESULT Generate2DMipsIntegerBoxFilter(size_t levels, const ScratchImage& mipChain, size_t item)
+    {
+        if (!mipChain.GetImages())
+            return E_INVALIDARG;
+
+        // This assumes that the base image is already placed into the mipChain at the top level... (see _Setup2DMips)
+
+        assert(levels > 1);
+
+        for (size_t level = 1; level < levels; ++level)
+        {
+            const Image* src = mipChain.GetImage(level - 1, item, 0);
+            const Image* dest = mipChain.GetImage(level, item, 0);
+
+            if (!src || !dest)
+                return E_POINTER;
+
+            HRESULT hr = _ResizeIntegerBoxFilter(*src, *dest);
+            if (FAILED(hr))
+                return hr;
+        }
+
+        return S_OK;
+    }
+
+
+    //--- 2D mips one level at a time, with the rows of each level filtered in parallel ---
+    HRESULT Generate2DMipsParallel(size_t levels, DWORD filter, const ScratchImage& mipChain, size_t item)
+    {
+        if (!mipChain.GetImages())
+            return E_INVALIDARG;
+
+        // This assumes that the base image is already placed into the mipChain at the top level... (see _Setup2DMips)
+
+        assert(levels > 1);
+        assert(filter & TEX_FILTER_MASK);
+
+        for (size_t level = 1; level < levels; ++level)
+        {
+            const Image* src = mipChain.GetImage(level - 1, item, 0);
+            const Image* dest = mipChain.GetImage(level, item, 0);
+
+            if (!src || !dest)
+                return E_POINTER;
+
+            HRESULT hr = _ResizeUsingCustomFilters(*src, filter, *dest);
+            if (FAILED(hr))
+                return hr;
+        }
+
+        return S_OK;
+    }
+
+
     //--- 2D Linear Filter ---
     HRESULT Generate2DMipsLinearFilter(size_t levels, DWORD filter, const ScratchImage& mipChain, size_t item)
     {
@@ -2800,7 +3043,10 @@ HRESULT DirectX::GenerateMipMaps(
 
     static_assert(TEX_FILTER_POINT == 0x100000, "TEX_FILTER_ flag values don't match TEX_FILTER_MASK");
 
-    bool usewic = UseWICFiltering(baseImage.format, filter);
+    // Power of 2 chains of 8-bit formats are box filtered in the integer domain
+    const bool intbox = _UseIntegerBoxFilter(baseImage.format, filter) && ispow2(baseImage.width) && ispow2(baseImage.height);
+
+    bool usewic = !intbox && UseWICFiltering(baseImage.format, filter, baseImage.width, baseImage.height);
 
     WICPixelFormatGUID pfGUID = {};
     bool wicpf = (usewic) ? _DXGIToWIC(baseImage.format, pfGUID, true) : false;
@@ -2903,6 +3149,18 @@ HRESULT DirectX::GenerateMipMaps(
             filter_select = (ispow2(baseImage.width) && ispow2(baseImage.height)) ? TEX_FILTER_BOX : TEX_FILTER_LINEAR;
         }
 
+        if ((filter & TEX_FILTER_PARALLEL) && !intbox && filter_select != TEX_FILTER_POINT)
+        {
+            hr = Setup2DMips(&baseImage, 1, mdata, mipChain);
+            if (FAILED(hr))
+                return hr;
+
+            hr = Generate2DMipsParallel(levels, (filter & ~TEX_FILTER_MASK) | filter_select, mipChain, 0);
+            if (FAILED(hr))
+                mipChain.Release();
+            return hr;
+        }
+
         switch (filter_select)
         {
         case TEX_FILTER_BOX:
@@ -2910,7 +3168,9 @@ HRESULT DirectX::GenerateMipMaps(
             if (FAILED(hr))
                 return hr;
 
-            hr = Generate2DMipsBoxFilter(levels, filter, mipChain, 0);
+            hr = intbox
+                ? Generate2DMipsIntegerBoxFilter(levels, mipChain, 0)
+                : Generate2DMipsBoxFilter(levels, filter, mipChain, 0);
             if (FAILED(hr))
                 mipChain.Release();
             return hr;
@@ -3013,7 +3273,10 @@ HRESULT DirectX::GenerateMipMaps(
 
     static_assert(TEX_FILTER_POINT == 0x100000, "TEX_FILTER_ flag values don't match TEX_FILTER_MASK");
 
-    bool usewic = !metadata.IsPMAlpha() && UseWICFiltering(metadata.format, filter);
+    // Power of 2 chains of 8-bit formats are box filtered in the integer domain
+    const bool intbox = _UseIntegerBoxFilter(metadata.format, filter) && ispow2(metadata.width) && ispow2(metadata.height);
+
+    bool usewic = !intbox && !metadata.IsPMAlpha() && UseWICFiltering(metadata.format, filter, metadata.width, metadata.height);
 
     WICPixelFormatGUID pfGUID = {};
     bool wicpf = (usewic) ? _DXGIToWIC(metadata.format, pfGUID, true) : false;
@@ -3116,6 +3379,24 @@ HRESULT DirectX::GenerateMipMaps(
             filter_select = (ispow2(metadata.width) && ispow2(metadata.height)) ? TEX_FILTER_BOX : TEX_FILTER_LINEAR;
         }
 
+        if ((filter & TEX_FILTER_PARALLEL) && !intbox && filter_select != TEX_FILTER_POINT)
+        {
+            hr = Setup2DMips(&baseImages[0], metadata.arraySize, mdata2, mipChain);
+            if (FAILED(hr))
+                return hr;
+
+            for (size_t item = 0; item < metadata.arraySize; ++item)
+            {
+                hr = Generate2DMipsParallel(levels, (filter & ~TEX_FILTER_MASK) | filter_select, mipChain, item);
+                if (FAILED(hr))
+                {
+                    mipChain.Release();
+                    return hr;
+                }
+            }
+            return S_OK;
+        }
+
         switch (filter_select)
         {
         case TEX_FILTER_BOX:
@@ -3125,7 +3406,9 @@ HRESULT DirectX::GenerateMipMaps(
 
             for (size_t item = 0; item < metadata.arraySize; ++item)
             {
-                hr = Generate2DMipsBoxFilter(levels, filter, mipChain, item);
+                hr = intbox
+                    ? Generate2DMipsIntegerBoxFilter(levels, mipChain, item)
+                    : Generate2DMipsBoxFilter(levels, filter, mipChain, item);
                 if (FAILED(hr))
                     mipChain.Release();
             }
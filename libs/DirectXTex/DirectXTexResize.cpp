@@ -11,6 +11,11 @@
 
 #include "DirectXTexP.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
 #include "filters.h"
 
 using namespace DirectX;
@@ -20,6 +25,8 @@ namespace DirectX
 {
     extern HRESULT _ResizeSeparateColorAndAlpha(_In_ IWICImagingFactory* pWIC, _In_ bool iswic2, _In_ IWICBitmap* original,
         _In_ size_t newWidth, _In_ size_t newHeight, _In_ DWORD filter, _Inout_ const Image* img);
+    extern bool _UseIntegerBoxFilter(_In_ DXGI_FORMAT format, _In_ DWORD filter);
+    extern HRESULT _ResizeIntegerBoxFilter(_In_ const Image& srcImage, _In_ const Image& destImage);
 }
 
 namespace
@@ -169,8 +176,52 @@ namespace
     }
 
 
+    //--- determine when to use the 8-bit integer box filter ---
+    bool UseIntegerBoxFilter(_In_ DXGI_FORMAT format, _In_ DWORD filter, _In_ size_t srcWidth, _In_ size_t srcHeight, _In_ size_t width, _In_ size_t height)
+    {
+        if (!_UseIntegerBoxFilter(format, filter))
+            return false;
+
+        if ((srcWidth % width) || (srcHeight % height))
+            return false;
+
+        if (!(filter & TEX_FILTER_MASK))
+        {
+            // Default filter choice only picks box for an exact 2:1 reduction
+            return ((width << 1) == srcWidth) && ((height << 1) == srcHeight);
+        }
+
+        return true;
+    }
+
+
+    //--- whether the row-parallel custom filters can do this resize ---
+    bool UseParallelFiltering(_In_ DWORD filter, _In_ size_t srcWidth, _In_ size_t srcHeight, _In_ size_t width, _In_ size_t height)
+    {
+        if (!(filter & TEX_FILTER_PARALLEL))
+            return false;
+
+        switch (filter & TEX_FILTER_MASK)
+        {
+        case 0:
+        case TEX_FILTER_LINEAR:
+        case TEX_FILTER_CUBIC:
+        case TEX_FILTER_TRIANGLE:
+            return true;
+
+        case TEX_FILTER_BOX:
+            // The custom box filter only halves (FANT is the same filter), WIC handles other ratios
+            return ((width << 1) == srcWidth || (width == 1 && srcWidth == 1))
+                && ((height << 1) == srcHeight || (height == 1 && srcHeight == 1));
+
+        default:
+            return false;
+        }
+    }
+
+
     //--- determine when to use WIC vs. non-WIC paths ---
-    bool UseWICFiltering(_In_ DXGI_FORMAT format, _In_ DWORD filter)
+    bool UseWICFiltering(_In_ DXGI_FORMAT format, _In_ DWORD filter, _In_ size_t srcWidth, _In_ size_t srcHeight, _In_ size_t width, _In_ size_t height)
     {
         if (filter & TEX_FILTER_FORCE_NON_WIC)
         {
@@ -184,6 +235,12 @@ namespace
             return true;
         }
 
+        if (UseParallelFiltering(filter, srcWidth, srcHeight, width, height))
+        {
+            // Row-parallel filtering is only implemented by the non-WIC code paths
+            return false;
+        }
+
         if (IsSRGB(format) || (filter & TEX_FILTER_SRGB))
         {
             // Use non-WIC code paths for sRGB correct filtering
@@ -303,12 +360,17 @@ namespace
 
 
     //--- Box Filter ---
-    HRESULT ResizeBoxFilter(const Image& srcImage, DWORD filter, const Image& destImage)
+    HRESULT ResizeBoxFilter(const Image& srcImage, DWORD filter, const Image& destImage, size_t yStart, size_t yEnd)
     {
         assert(srcImage.pixels && destImage.pixels);
         assert(srcImage.format == destImage.format);
+        assert(yStart < yEnd && yEnd <= destImage.height);
 
-        if (((destImage.width << 1) != srcImage.width) || ((destImage.height << 1) != srcImage.height))
+        // A 1 pixel axis stays 1 pixel, as it does in the box mip chain
+        const bool clampX = (srcImage.width == 1 && destImage.width == 1);
+        const bool clampY = (srcImage.height == 1 && destImage.height == 1);
+
+        if ((!clampX && (destImage.width << 1) != srcImage.width) || (!clampY && (destImage.height << 1) != srcImage.height))
             return E_FAIL;
 
         // Allocate temporary space (3 scanlines)
@@ -327,15 +389,20 @@ namespace
         memset(urow1, 0xDD, sizeof(XMVECTOR)*srcImage.width);
 #endif
 
-        const XMVECTOR* urow2 = urow0 + 1;
-        const XMVECTOR* urow3 = urow1 + 1;
+        if (clampY)
+        {
+            urow1 = urow0;
+        }
 
-        const uint8_t* pSrc = srcImage.pixels;
-        uint8_t* pDest = destImage.pixels;
+        const XMVECTOR* urow2 = clampX ? urow0 : urow0 + 1;
+        const XMVECTOR* urow3 = clampX ? urow1 : urow1 + 1;
 
         size_t rowPitch = srcImage.rowPitch;
 
-        for (size_t y = 0; y < destImage.height; ++y)
+        const uint8_t* pSrc = srcImage.pixels + rowPitch * (clampY ? 0 : (yStart << 1));
+        uint8_t* pDest = destImage.pixels + destImage.rowPitch * yStart;
+
+        for (size_t y = yStart; y < yEnd; ++y)
         {
             if (!_LoadScanlineLinear(urow0, srcImage.width, pSrc, rowPitch, srcImage.format, filter))
                 return E_FAIL;
@@ -365,10 +432,11 @@ namespace
 
 
     //--- Linear Filter ---
-    HRESULT ResizeLinearFilter(const Image& srcImage, DWORD filter, const Image& destImage)
+    HRESULT ResizeLinearFilter(const Image& srcImage, DWORD filter, const Image& destImage, size_t yStart, size_t yEnd)
     {
         assert(srcImage.pixels && destImage.pixels);
         assert(srcImage.format == destImage.format);
+        assert(yStart < yEnd && yEnd <= destImage.height);
 
         // Allocate temporary space (3 scanlines, plus X and Y filters)
         ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(
@@ -397,14 +465,14 @@ namespace
 #endif
 
         const uint8_t* pSrc = srcImage.pixels;
-        uint8_t* pDest = destImage.pixels;
+        uint8_t* pDest = destImage.pixels + destImage.rowPitch * yStart;
 
         size_t rowPitch = srcImage.rowPitch;
 
         size_t u0 = size_t(-1);
         size_t u1 = size_t(-1);
 
-        for (size_t y = 0; y < destImage.height; ++y)
+        for (size_t y = yStart; y < yEnd; ++y)
         {
             auto& toY = lfY[y];
 
@@ -451,10 +519,11 @@ namespace
 
 
     //--- Cubic Filter ---
-    HRESULT ResizeCubicFilter(const Image& srcImage, DWORD filter, const Image& destImage)
+    HRESULT ResizeCubicFilter(const Image& srcImage, DWORD filter, const Image& destImage, size_t yStart, size_t yEnd)
     {
         assert(srcImage.pixels && destImage.pixels);
         assert(srcImage.format == destImage.format);
+        assert(yStart < yEnd && yEnd <= destImage.height);
 
         // Allocate temporary space (5 scanlines, plus X and Y filters)
         ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(
@@ -487,7 +556,7 @@ namespace
 #endif
 
         const uint8_t* pSrc = srcImage.pixels;
-        uint8_t* pDest = destImage.pixels;
+        uint8_t* pDest = destImage.pixels + destImage.rowPitch * yStart;
 
         size_t rowPitch = srcImage.rowPitch;
 
@@ -496,7 +565,7 @@ namespace
         size_t u2 = size_t(-1);
         size_t u3 = size_t(-1);
 
-        for (size_t y = 0; y < destImage.height; ++y)
+        for (size_t y = yStart; y < yEnd; ++y)
         {
             auto& toY = cfY[y];
 
@@ -611,10 +680,11 @@ namespace
 
 
     //--- Triangle Filter ---
-    HRESULT ResizeTriangleFilter(const Image& srcImage, DWORD filter, const Image& destImage)
+    HRESULT ResizeTriangleFilter(const Image& srcImage, DWORD filter, const Image& destImage, size_t yStart, size_t yEnd)
     {
         assert(srcImage.pixels && destImage.pixels);
         assert(srcImage.format == destImage.format);
+        assert(yStart < yEnd && yEnd <= destImage.height);
 
         using namespace TriangleFilter;
 
@@ -648,14 +718,15 @@ namespace
         auto xFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfX.get()) + tfX->sizeInBytes);
         auto yFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfY.get()) + tfY->sizeInBytes);
 
-        // Count times rows get written
+        // Count times rows get written (only rows in [yStart, yEnd) are produced by this call)
         for (FilterFrom* yFrom = tfY->from; yFrom < yFromEnd; )
         {
             for (size_t j = 0; j < yFrom->count; ++j)
             {
                 size_t v = yFrom->to[j].u;
                 assert(v < destImage.height);
-                ++rowActive[v].remaining;
+                if (v >= yStart && v < yEnd)
+                    ++rowActive[v].remaining;
             }
 
             yFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(yFrom) + yFrom->sizeInBytes);
@@ -670,11 +741,33 @@ namespace
 
         for (FilterFrom* yFrom = tfY->from; yFrom < yFromEnd; )
         {
+            // Skip source rows that don't contribute to this range
+            bool active = false;
+            for (size_t j = 0; j < yFrom->count; ++j)
+            {
+                size_t v = yFrom->to[j].u;
+                if (v >= yStart && v < yEnd)
+                {
+                    active = true;
+                    break;
+                }
+            }
+
+            if (!active)
+            {
+                pSrc += rowPitch;
+                yFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(yFrom) + yFrom->sizeInBytes);
+                continue;
+            }
+
             // Create accumulation rows as needed
             for (size_t j = 0; j < yFrom->count; ++j)
             {
                 size_t v = yFrom->to[j].u;
                 assert(v < destImage.height);
+                if (v < yStart || v >= yEnd)
+                    continue;
+
                 TriangleRow* rowAcc = &rowActive[v];
 
                 if (!rowAcc->scanline)
@@ -714,6 +807,9 @@ namespace
                 {
                     size_t v = yFrom->to[j].u;
                     assert(v < destImage.height);
+                    if (v < yStart || v >= yEnd)
+                        continue;
+
                     float yweight = yFrom->to[j].weight;
 
                     XMVECTOR* accPtr = rowActive[v].scanline.get();
@@ -740,6 +836,9 @@ namespace
             {
                 size_t v = yFrom->to[j].u;
                 assert(v < destImage.height);
+                if (v < yStart || v >= yEnd)
+                    continue;
+
                 TriangleRow* rowAcc = &rowActive[v];
 
                 assert(rowAcc->remaining > 0);
@@ -789,12 +888,38 @@ namespace
     }
 
 
+    //--- Custom filter resize of a range of destination rows ---
+    HRESULT ResizeRowsUsingCustomFilter(const Image& srcImage, DWORD filter_select, DWORD filter, const Image& destImage, size_t yStart, size_t yEnd)
+    {
+        switch (filter_select)
+        {
+        case TEX_FILTER_BOX:
+            return ResizeBoxFilter(srcImage, filter, destImage, yStart, yEnd);
+
+        case TEX_FILTER_LINEAR:
+            return ResizeLinearFilter(srcImage, filter, destImage, yStart, yEnd);
+
+        case TEX_FILTER_CUBIC:
+            return ResizeCubicFilter(srcImage, filter, destImage, yStart, yEnd);
+
+        case TEX_FILTER_TRIANGLE:
+            return ResizeTriangleFilter(srcImage, filter, destImage, yStart, yEnd);
+
+        default:
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+    }
+
+
     //--- Custom filter resize ---
     HRESULT PerformResizeUsingCustomFilters(const Image& srcImage, DWORD filter, const Image& destImage)
     {
         if (!srcImage.pixels || !destImage.pixels)
             return E_POINTER;
 
+        if (UseIntegerBoxFilter(srcImage.format, filter, srcImage.width, srcImage.height, destImage.width, destImage.height))
+            return _ResizeIntegerBoxFilter(srcImage, destImage);
+
         static_assert(TEX_FILTER_POINT == 0x100000, "TEX_FILTER_ flag values don't match TEX_FILTER_MASK");
 
         DWORD filter_select = (filter & TEX_FILTER_MASK);
@@ -805,26 +930,51 @@ namespace
                 ? TEX_FILTER_BOX : TEX_FILTER_LINEAR;
         }
 
-        switch (filter_select)
-        {
-        case TEX_FILTER_POINT:
+        if (filter_select == TEX_FILTER_POINT)
             return ResizePointFilter(srcImage, destImage);
 
-        case TEX_FILTER_BOX:
-            return ResizeBoxFilter(srcImage, filter, destImage);
+#ifdef _OPENMP
+        if ((filter & TEX_FILTER_PARALLEL) && destImage.height > 1)
+        {
+            // Each band is filtered exactly as the serial path would filter those rows, so the
+            // result doesn't depend on the number of threads
+            const size_t maxBands = std::max<size_t>(1, size_t(omp_get_max_threads()) * 2);
+            const size_t bandRows = std::max<size_t>(8, (destImage.height + maxBands - 1) / maxBands);
+            const int nBands = static_cast<int>((destImage.height + bandRows - 1) / bandRows);
 
-        case TEX_FILTER_LINEAR:
-            return ResizeLinearFilter(srcImage, filter, destImage);
+            std::vector<HRESULT> results(size_t(nBands), S_OK);
 
-        case TEX_FILTER_CUBIC:
-            return ResizeCubicFilter(srcImage, filter, destImage);
+#pragma omp parallel for
+            for (int band = 0; band < nBands; ++band)
+            {
+                const size_t yStart = size_t(band) * bandRows;
+                const size_t yEnd = std::min<size_t>(yStart + bandRows, destImage.height);
 
-        case TEX_FILTER_TRIANGLE:
-            return ResizeTriangleFilter(srcImage, filter, destImage);
+                results[size_t(band)] = ResizeRowsUsingCustomFilter(srcImage, filter_select, filter, destImage, yStart, yEnd);
+            }
 
-        default:
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            for (auto it = results.cbegin(); it != results.cend(); ++it)
+            {
+                if (FAILED(*it))
+                    return *it;
+            }
+
+            return S_OK;
         }
+#endif // _OPENMP
+
+        return ResizeRowsUsingCustomFilter(srcImage, filter_select, filter, destImage, 0, destImage.height);
+    }
+}
+
+namespace DirectX
+{
+    HRESULT _ResizeUsingCustomFilters(_In_ const Image& srcImage, _In_ DWORD filter, _In_ const Image& destImage);
+        // Also used by GenerateMipMaps
+
+    HRESULT _ResizeUsingCustomFilters(const Image& srcImage, DWORD filter, const Image& destImage)
+    {
+        return PerformResizeUsingCustomFilters(srcImage, filter, destImage);
     }
 }
 
@@ -862,7 +1012,8 @@ HRESULT DirectX::Resize(
         return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
     }
 
-    bool usewic = UseWICFiltering(srcImage.format, filter);
+    bool usewic = !UseIntegerBoxFilter(srcImage.format, filter, srcImage.width, srcImage.height, width, height)
+        && UseWICFiltering(srcImage.format, filter, srcImage.width, srcImage.height, width, height);
 
     WICPixelFormatGUID pfGUID = {};
     bool wicpf = (usewic) ? _DXGIToWIC(srcImage.format, pfGUID, true) : false;
@@ -945,7 +1096,8 @@ HRESULT DirectX::Resize(
     if (FAILED(hr))
         return hr;
 
-    bool usewic = !metadata.IsPMAlpha() && UseWICFiltering(metadata.format, filter);
+    bool usewic = !UseIntegerBoxFilter(metadata.format, filter, metadata.width, metadata.height, width, height)
+        && !metadata.IsPMAlpha() && UseWICFiltering(metadata.format, filter, metadata.width, metadata.height, width, height);
 
     WICPixelFormatGUID pfGUID = {};
     bool wicpf = (usewic) ? _DXGIToWIC(metadata.format, pfGUID, true) : false;
@@ -659,6 +659,9 @@ public:
 	bool GetTriangles(std::vector<Triangle>& tris);
 	void SetTriangles(const std::vector<Triangle>& tris);
 
+	// Match groups list vertices by index
+	bool HasMatchGroups() { return numMatchGroups > 0; }
+
 	void RecalcNormals(const bool smooth = true, const float smoothThres = 60.0f);
 	void CalcTangentSpace();
 	NiTriShapeData* Clone() { return new NiTriShapeData(*this); }
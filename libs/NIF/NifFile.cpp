@@ -4,6 +4,9 @@ See the included LICENSE file
 */
 
 #include "NifFile.h"
+#include "NifUtil.h"
+#include "utils/KDMatcher.h"
+#include "utils/VertexCache.h"
 
 #include <set>
 #include <queue>
@@ -964,7 +967,14 @@ int NifFile::Save(const std::string& fileName, const NifSaveOptions& options) {
 }
 
 int NifFile::Save(std::fstream& file, const NifSaveOptions& options) {
-	if (file.is_open()) {
+	if (!file.is_open())
+		return 1;
+
+	return Save(static_cast<std::iostream&>(file), options);
+}
+
+int NifFile::Save(std::iostream& file, const NifSaveOptions& options) {
+	if (file) {
 		NiStream stream(&file, &hdr.GetVersion());
 		FinalizeData();
 
@@ -990,10 +1000,11 @@ int NifFile::Save(std::fstream& file, const NifSaveOptions& options) {
 		endPad = 0;
 		stream << endPad;
 
-		// Get previous stream pos of block size array and overwrite
+		// Get previous stream pos of block size array and overwrite.
+		// seekp, string streams keep separate read and write positions
 		std::streampos blockSizePos = hdr.GetBlockSizeStreamPos();
 		if (blockSizePos != std::streampos()) {
-			file.seekg(blockSizePos);
+			file.seekp(blockSizePos);
 
 			for (int i = 0; i < hdr.GetNumBlocks(); i++)
 				stream << blockSizes[i];
@@ -1004,7 +1015,7 @@ int NifFile::Save(std::fstream& file, const NifSaveOptions& options) {
 	else
 		return 1;
 
-	return 0;
+	return file.good() ? 0 : 1;
 }
 
 void NifFile::Optimize() {
@@ -1480,6 +1491,20 @@ OptResult NifFile::OptimizeFor(OptOptions& options) {
 		result.versionMismatch = true;
 	}
 
+	if (options.weldVertices && !options.headParts) {
+		for (auto &shape : GetShapes()) {
+			if (WeldVertices(shape) > 0)
+				result.shapesVerticesWelded.push_back(shape->GetName());
+		}
+	}
+
+	if (options.vertexCache) {
+		for (auto &shape : GetShapes()) {
+			if (OptimizeVertexCache(shape, !options.headParts))
+				result.shapesCacheOptimized.push_back(shape->GetName());
+		}
+	}
+
 	return result;
 }
 
@@ -2418,6 +2443,364 @@ bool NifFile::ReorderTriangles(NiShape* shape, const std::vector<uint>& triangle
 	return shape->ReorderTriangles(triangleIndices);
 }
 
+bool NifFile::HasFixedVertexOrder(NiShape* shape) {
+	if (shape->HasType<BSDynamicTriShape>())
+		return true;
+
+	if (hdr.GetBlock<NiTimeController>(shape->GetControllerRef()))
+		return true;
+
+	auto bsTriShape = dynamic_cast<BSTriShape*>(shape);
+	if (bsTriShape && bsTriShape->particleDataSize > 0)
+		return true;
+
+	auto triShapeData = dynamic_cast<NiTriShapeData*>(shape->GetGeomData());
+	if (triShapeData && triShapeData->HasMatchGroups())
+		return true;
+
+	// BodySlide and RaceMenu .tri morphs, linked from the root node or the shape
+	auto hasTriMorphs = [this](NiObjectNET* obj) {
+		if (!obj)
+			return false;
+
+		for (auto& extraData : obj->GetExtraData()) {
+			auto stringData = hdr.GetBlock<NiStringExtraData>(extraData.GetIndex());
+			if (stringData && stringData->GetName() == "BODYTRI")
+				return true;
+		}
+		return false;
+	};
+
+	if (hasTriMorphs(GetRootNode()) || hasTriMorphs(shape))
+		return true;
+
+	return false;
+}
+
+bool NifFile::OptimizeVertexCache(NiShape* shape, const bool reorderVertices) {
+	if (!shape)
+		return false;
+
+	// Strips have their own order, and BSLODTriShape's levels are prefixes of the triangles
+	if (shape->HasType<NiTriStrips>() || shape->HasType<BSLODTriShape>())
+		return false;
+
+	std::vector<Triangle> tris;
+	if (!shape->GetTriangles(tris) || tris.size() < 3)
+		return false;
+
+	const int numVerts = shape->GetNumVertices();
+	for (auto &t : tris)
+		if (t.p1 >= numVerts || t.p2 >= numVerts || t.p3 >= numVerts)
+			return false;
+
+	NiSkinData* skinData = nullptr;
+	NiSkinPartition* skinPart = nullptr;
+	auto skinInst = hdr.GetBlock<NiSkinInstance>(shape->GetSkinInstanceRef());
+	if (skinInst) {
+		skinData = hdr.GetBlock<NiSkinData>(skinInst->GetDataRef());
+		skinPart = hdr.GetBlock<NiSkinPartition>(skinInst->GetSkinPartitionRef());
+
+		// Partitions are rebuilt from the bone weights afterwards
+		if (skinPart && (!skinData || !skinData->hasVertWeights))
+			return false;
+	}
+
+	// Triangles are only reordered within runs that stay in one skin partition,
+	// segment and LOD level, so every range refers to the same triangles afterwards.
+	std::vector<bool> runStart(tris.size(), false);
+	runStart[0] = true;
+
+	auto splitAt = [&runStart](uint triIndex) {
+		if (triIndex < runStart.size())
+			runStart[triIndex] = true;
+	};
+
+	auto splitOnChange = [&runStart](const std::vector<int>& triParts) {
+		if (triParts.size() != runStart.size())
+			return;
+
+		for (int i = 1; i < triParts.size(); i++)
+			if (triParts[i] != triParts[i - 1])
+				runStart[i] = true;
+	};
+
+	if (skinPart) {
+		skinPart->PrepareTriParts(tris);
+		splitOnChange(skinPart->triParts);
+	}
+
+	auto bssits = dynamic_cast<BSSubIndexTriShape*>(shape);
+	if (bssits) {
+		// FO4 segments and sub segments
+		NifSegmentationInfo inf;
+		std::vector<int> segTriParts;
+		bssits->GetSegmentation(inf, segTriParts);
+		splitOnChange(segTriParts);
+
+		// SSE segments
+		for (auto &segment : bssits->segments) {
+			splitAt(segment.index / 3);
+			splitAt(segment.index / 3 + segment.numTris);
+		}
+	}
+
+	auto bsSegmentShape = dynamic_cast<BSSegmentedTriShape*>(shape);
+	if (bsSegmentShape) {
+		for (auto &segment : bsSegmentShape->segments) {
+			splitAt(segment.index / 3);
+			splitAt(segment.index / 3 + segment.numTris);
+		}
+	}
+
+	auto bsMeshLODShape = dynamic_cast<BSMeshLODTriShape*>(shape);
+	if (bsMeshLODShape) {
+		// LOD sizes are triangle counts of consecutive ranges
+		uint lodEnd = bsMeshLODShape->lodSize0;
+		splitAt(lodEnd);
+		lodEnd += bsMeshLODShape->lodSize1;
+		splitAt(lodEnd);
+		lodEnd += bsMeshLODShape->lodSize2;
+		splitAt(lodEnd);
+	}
+
+	std::vector<uint> triOrder;
+	triOrder.reserve(tris.size());
+	for (uint start = 0; start < tris.size();) {
+		uint end = start + 1;
+		while (end < tris.size() && !runStart[end])
+			end++;
+
+		VertexCacheOptimizer::OrderTriangles(tris, start, end - start, numVerts, triOrder);
+		start = end;
+	}
+
+	bool changed = false;
+	std::vector<Triangle> newTris(tris.size());
+	for (int i = 0; i < triOrder.size(); i++) {
+		newTris[i] = tris[triOrder[i]];
+		if (triOrder[i] != i)
+			changed = true;
+	}
+
+	if (changed && skinPart) {
+		std::vector<int> newTriParts(triOrder.size());
+		for (int i = 0; i < triOrder.size(); i++)
+			newTriParts[i] = skinPart->triParts[triOrder[i]];
+
+		skinPart->triParts = std::move(newTriParts);
+	}
+
+	auto bsTriShape = dynamic_cast<BSTriShape*>(shape);
+	auto geomData = shape->GetGeomData();
+
+	if (reorderVertices && !HasFixedVertexOrder(shape) && (bsTriShape || geomData)) {
+		std::vector<int> vertMap = VertexCacheOptimizer::OrderVertices(newTris, numVerts);
+
+		bool vertsChanged = false;
+		for (int i = 0; i < vertMap.size(); i++) {
+			if (vertMap[i] != i) {
+				vertsChanged = true;
+				break;
+			}
+		}
+
+		if (vertsChanged) {
+			ApplyMapToTriangles(newTris, vertMap);
+
+			if (bsTriShape) {
+				ApplyIndexMapToVector(bsTriShape->vertData, vertMap);
+			}
+			else {
+				ApplyIndexMapToVector(geomData->vertices, vertMap);
+				ApplyIndexMapToVector(geomData->normals, vertMap);
+				ApplyIndexMapToVector(geomData->tangents, vertMap);
+				ApplyIndexMapToVector(geomData->bitangents, vertMap);
+				ApplyIndexMapToVector(geomData->vertexColors, vertMap);
+				for (auto &uvSet : geomData->uvSets)
+					ApplyIndexMapToVector(uvSet, vertMap);
+			}
+
+			if (skinData) {
+				for (auto &bone : skinData->bones)
+					for (auto &bw : bone.vertexWeights)
+						if (bw.index < vertMap.size())
+							bw.index = vertMap[bw.index];
+			}
+
+			changed = true;
+		}
+	}
+
+	if (!changed)
+		return false;
+
+	shape->SetTriangles(newTris);
+
+	if (skinPart)
+		UpdateSkinPartitions(shape);
+
+	return true;
+}
+
+int NifFile::WeldVertices(NiShape* shape) {
+	if (!shape || shape->HasType<NiTriStrips>() || HasFixedVertexOrder(shape))
+		return 0;
+
+	std::vector<Triangle> tris;
+	if (!shape->GetTriangles(tris))
+		return 0;
+
+	const std::vector<Vector3>* verts = GetRawVertsForShape(shape);
+	if (!verts || verts->size() < 2)
+		return 0;
+
+	const int numVerts = verts->size();
+
+	// Attributes that aren't there or don't cover every vertex aren't compared
+	auto perVertex = [verts](auto* data) {
+		return data && data->size() == verts->size() ? data : nullptr;
+	};
+
+	auto bsTriShape = dynamic_cast<BSTriShape*>(shape);
+	auto geomData = shape->GetGeomData();
+
+	const std::vector<Vector3>* normals = perVertex(GetNormalsForShape(shape, false));
+	const std::vector<float>* eyeData = perVertex(GetEyeDataForShape(shape));
+
+	std::vector<const std::vector<Vector2>*> uvSets;
+	const std::vector<Vector3>* tangents = nullptr;
+	const std::vector<Vector3>* bitangents = nullptr;
+	if (bsTriShape) {
+		if (auto uvs = perVertex(GetUvsForShape(shape)))
+			uvSets.push_back(uvs);
+
+		tangents = perVertex(bsTriShape->GetTangentData(false));
+		bitangents = perVertex(bsTriShape->GetBitangentData(false));
+	}
+	else if (geomData) {
+		for (auto &uvSet : geomData->uvSets)
+			if (auto uvs = perVertex(&uvSet))
+				uvSets.push_back(uvs);
+
+		tangents = perVertex(&geomData->tangents);
+		bitangents = perVertex(&geomData->bitangents);
+	}
+
+	const std::vector<Color4>* colors = nullptr;
+	if (bsTriShape)
+		colors = perVertex(bsTriShape->GetColorData());
+	else if (geomData && geomData->HasVertexColors())
+		colors = perVertex(&geomData->vertexColors);
+
+	NiSkinData* skinData = nullptr;
+	NiSkinPartition* skinPart = nullptr;
+	auto skinInst = hdr.GetBlock<NiSkinInstance>(shape->GetSkinInstanceRef());
+	if (skinInst) {
+		skinData = hdr.GetBlock<NiSkinData>(skinInst->GetDataRef());
+		skinPart = hdr.GetBlock<NiSkinPartition>(skinInst->GetSkinPartitionRef());
+
+		// Partitions are rebuilt from the bone weights afterwards
+		if (skinPart && (!skinData || !skinData->hasVertWeights))
+			return 0;
+	}
+
+	// Bones and weights of each vertex, sorted by bone
+	std::vector<std::vector<SkinWeight>> vertWeights;
+	if (skinData) {
+		vertWeights.resize(numVerts);
+		for (int boneIndex = 0; boneIndex < skinData->bones.size(); boneIndex++)
+			for (auto &bw : skinData->bones[boneIndex].vertexWeights)
+				if (bw.index < numVerts && bw.weight > 0.0f)
+					vertWeights[bw.index].push_back(SkinWeight(boneIndex, bw.weight));
+	}
+	else if (bsTriShape && bsTriShape->IsSkinned()) {
+		vertWeights.resize(numVerts);
+		for (int i = 0; i < numVerts; i++)
+			for (int k = 0; k < 4; k++)
+				if (bsTriShape->vertData[i].weights[k] > 0.0f)
+					vertWeights[i].push_back(SkinWeight(bsTriShape->vertData[i].weightBones[k], bsTriShape->vertData[i].weights[k]));
+	}
+
+	for (auto &vw : vertWeights) {
+		std::sort(vw.begin(), vw.end(), [](const SkinWeight& lhs, const SkinWeight& rhs) {
+			return lhs.index < rhs.index;
+		});
+	}
+
+	auto same = [&](int a, int b) {
+		for (auto uvs : uvSets)
+			if (std::fabs((*uvs)[a].u - (*uvs)[b].u) >= EPSILON || std::fabs((*uvs)[a].v - (*uvs)[b].v) >= EPSILON)
+				return false;
+
+		if (normals && !(*normals)[a].IsNearlyEqualTo((*normals)[b]))
+			return false;
+
+		if (tangents && !(*tangents)[a].IsNearlyEqualTo((*tangents)[b]))
+			return false;
+
+		if (bitangents && !(*bitangents)[a].IsNearlyEqualTo((*bitangents)[b]))
+			return false;
+
+		if (colors) {
+			Color4 color = (*colors)[a];
+			if (color != (*colors)[b])
+				return false;
+		}
+
+		if (eyeData && (*eyeData)[a] != (*eyeData)[b])
+			return false;
+
+		if (!vertWeights.empty()) {
+			const std::vector<SkinWeight>& wa = vertWeights[a];
+			const std::vector<SkinWeight>& wb = vertWeights[b];
+			if (wa.size() != wb.size())
+				return false;
+
+			for (int k = 0; k < wa.size(); k++)
+				if (wa[k].index != wb[k].index || std::fabs(wa[k].weight - wb[k].weight) >= EPSILON)
+					return false;
+		}
+
+		return true;
+	};
+
+	HashMatcher matcher(verts->data(), numVerts, same);
+	if (matcher.matches.empty())
+		return 0;
+
+	std::vector<int> vertMap(numVerts);
+	for (int i = 0; i < numVerts; i++)
+		vertMap[i] = i;
+
+	std::vector<ushort> welded;
+	for (auto &matchset : matcher.matches) {
+		for (int k = 1; k < matchset.size(); k++) {
+			vertMap[matchset[k]] = matchset[0];
+			welded.push_back(matchset[k]);
+		}
+	}
+	std::sort(welded.begin(), welded.end());
+
+	if (skinPart)
+		skinPart->PrepareTriParts(tris);
+
+	// Triangles that would lose their area keep the welded vertices, and are deleted with them
+	for (auto &t : tris) {
+		Triangle w(vertMap[t.p1], vertMap[t.p2], vertMap[t.p3]);
+		if (w.p1 != w.p2 && w.p2 != w.p3 && w.p3 != w.p1)
+			t = w;
+	}
+
+	shape->SetTriangles(tris);
+
+	if (skinPart)
+		UpdateSkinPartitions(shape);
+
+	DeleteVertsForShape(shape, welded);
+	return welded.size();
+}
+
 const std::vector<Vector3>* NifFile::GetNormalsForShape(NiShape* shape, bool transform) {
 	if (!shape || !shape->HasNormals())
 		return nullptr;
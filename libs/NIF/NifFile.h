@@ -14,6 +14,8 @@ struct OptOptions {
 	bool removeParallax = true;
 	bool calcBounds = true;
 	bool mandatoryOnly = false;
+	bool vertexCache = false;
+	bool weldVertices = false;
 };
 
 struct OptResult {
@@ -24,6 +26,8 @@ struct OptResult {
 	std::vector<std::string> shapesPartTriangulated;
 	std::vector<std::string> shapesTangentsAdded;
 	std::vector<std::string> shapesParallaxRemoved;
+	std::vector<std::string> shapesCacheOptimized;
+	std::vector<std::string> shapesVerticesWelded;
 };
 
 // Sort bone weights with indices
@@ -53,6 +57,10 @@ private:
 	bool hasUnknown = false;
 	bool isTerrain = false;
 
+	// True for shapes with data that refers to vertices by index: morphs, controllers, particle data, match groups
+	// and BodySlide/RaceMenu .tri files (BODYTRI extra data)
+	bool HasFixedVertexOrder(NiShape* shape);
+
 public:
 	NifFile() {}
 
@@ -81,6 +89,7 @@ public:
     int Load(std::iostream& file, const NifLoadOptions& options = NifLoadOptions());
 	int Save(const std::string& fileName, const NifSaveOptions& options = NifSaveOptions());
 	int Save(std::fstream& file, const NifSaveOptions& options = NifSaveOptions());
+	int Save(std::iostream& file, const NifSaveOptions& options = NifSaveOptions());
 
 	void Optimize();
 	OptResult OptimizeFor(OptOptions& options);
@@ -226,6 +235,18 @@ public:
 
 	const std::vector<Vector3>* GetRawVertsForShape(NiShape* shape);
 	bool ReorderTriangles(NiShape* shape, const std::vector<uint>& triangleIndices);
+	// OptimizeVertexCache: reorders triangles for the post-transform vertex cache and,
+	// if reorderVertices is set, vertices in the order the triangles first use them.
+	// Triangles stay within their skin partition (triParts is kept), segment and LOD level.
+	// Vertices keep their order on shapes with morphs, controllers, particle data or a BODYTRI
+	// .tri file, whose data refers to vertices by index; head parts also need their order kept.
+	// Returns false if nothing changed.
+	bool OptimizeVertexCache(NiShape* shape, const bool reorderVertices = true);
+	// WeldVertices: merges true duplicate vertices, at the same position with the same UVs, normals,
+	// colors, eye data and skin weights, into the first of them.  Triangles that lose their area
+	// are deleted.  Skipped for the shapes whose vertices OptimizeVertexCache keeps in order; head
+	// parts should not be welded either.  Returns the number of vertices removed.
+	int WeldVertices(NiShape* shape);
 	const std::vector<Vector3>* GetNormalsForShape(NiShape* shape, bool transform = true);
 	const std::vector<Vector2>* GetUvsForShape(NiShape* shape);
 	const std::vector<Color4>* GetColorsForShape(const std::string& shapeName);
@@ -102,6 +102,18 @@ template<typename IndexType1, typename IndexType2> std::vector<int> GenerateInde
 	return map;
 }
 
+// ApplyIndexMapToVector: moves v[i] to v[map[i]].  map must be a
+// permutation of v's indices; v is left alone if the sizes differ, as
+// for optional per-vertex data that isn't there.
+template<typename VectorType, typename IndexType> void ApplyIndexMapToVector(VectorType &v, const std::vector<IndexType> &map) {
+	if (v.size() != map.size())
+		return;
+	VectorType copy(v.size());
+	for (int i = 0; i < map.size(); ++i)
+		copy[map[i]] = std::move(v[i]);
+	v = std::move(copy);
+}
+
 // ApplyIndexMapToMapKeys: MapType is something like
 // std::unordered_map<int, Data> or std::map<int, Data>.
 // If a MapType-key k is in the indexMap, it is deleted if indexMap[k]
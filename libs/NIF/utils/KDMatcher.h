@@ -7,6 +7,7 @@ See the included LICENSE file
 
 #include "Object3d.h"
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 
 // A specialized KD tree that finds duplicate vertices in a point cloud.  
@@ -108,6 +109,117 @@ public:
 	}
 };
 
+// HashMatcher: finds matching points like kd_matcher and SortingMatcher,
+// but with a spatial hash instead of a tree, so it stays linear on sorted
+// input and allocates only a few flat arrays.  Points are bucketed by grid
+// cell, and each point is compared with the points of the cells its
+// EPSILON box overlaps.  Cells are wider than the box, so that is one cell
+// for most points and at most eight.
+//
+// The optional "same" predicate tells whether two coincident points are
+// true duplicates, for example by also comparing UVs, normals and skin
+// weights.  Each point joins the first earlier point it matches that isn't
+// itself a match of another.  Every match set starts with that point and
+// is in ascending order.
+class HashMatcher {
+public:
+	std::vector<std::vector<int>> matches;
+
+	HashMatcher(const Vector3* pts, int cnt)
+		: HashMatcher(pts, cnt, [](int, int) { return true; }) {
+	}
+
+	template<typename SamePredicate>
+	HashMatcher(const Vector3* pts, int cnt, SamePredicate same) {
+		if (cnt <= 1)
+			return;
+
+		size_t numBuckets = 1;
+		while (numBuckets < cnt * 2)
+			numBuckets <<= 1;
+
+		// Points of bucket b are bucketPoints[bucketStart[b]] to bucketPoints[bucketStart[b + 1] - 1], in ascending order
+		std::vector<uint> pointBuckets(cnt);
+		std::vector<int> bucketStart(numBuckets + 1, 0);
+		for (int i = 0; i < cnt; ++i) {
+			pointBuckets[i] = Bucket(Cell(pts[i].x), Cell(pts[i].y), Cell(pts[i].z), numBuckets);
+			++bucketStart[pointBuckets[i] + 1];
+		}
+
+		for (size_t b = 0; b < numBuckets; ++b)
+			bucketStart[b + 1] += bucketStart[b];
+
+		std::vector<int> bucketPoints(cnt);
+		std::vector<int> fill(bucketStart.begin(), bucketStart.end() - 1);
+		for (int i = 0; i < cnt; ++i)
+			bucketPoints[fill[pointBuckets[i]]++] = i;
+
+		std::vector<int> first(cnt);
+		for (int i = 0; i < cnt; ++i) {
+			const Vector3& p = pts[i];
+			const int64_t x0 = Cell(p.x - EPSILON), x1 = Cell(p.x + EPSILON);
+			const int64_t y0 = Cell(p.y - EPSILON), y1 = Cell(p.y + EPSILON);
+			const int64_t z0 = Cell(p.z - EPSILON), z1 = Cell(p.z + EPSILON);
+
+			int best = i;
+			for (int64_t x = x0; x <= x1; ++x) {
+				for (int64_t y = y0; y <= y1; ++y) {
+					for (int64_t z = z0; z <= z1; ++z) {
+						size_t b = Bucket(x, y, z, numBuckets);
+						for (int k = bucketStart[b]; k < bucketStart[b + 1]; ++k) {
+							int j = bucketPoints[k];
+							if (j >= best)
+								break;
+							if (first[j] != j)
+								continue;
+
+							Vector3 d = pts[j] - p;
+							if (std::fabs(d.x) < EPSILON && std::fabs(d.y) < EPSILON && std::fabs(d.z) < EPSILON && same(j, i)) {
+								best = j;
+								break;
+							}
+						}
+					}
+				}
+			}
+			first[i] = best;
+		}
+
+		std::vector<int> matchIndex(cnt, -1);
+		for (int i = 0; i < cnt; ++i) {
+			int f = first[i];
+			if (f == i)
+				continue;
+
+			if (matchIndex[f] < 0) {
+				matchIndex[f] = matches.size();
+				matches.push_back(std::vector<int>(1, f));
+			}
+			matches[matchIndex[f]].push_back(i);
+		}
+	}
+
+private:
+	static int64_t Cell(double v) {
+		// Far enough out that nothing matches anyway, and the cell still fits
+		const double limit = 1e12;
+		double c = std::floor(v * (1.0 / (EPSILON * 16.0)));
+		if (!(c > -limit))
+			c = -limit;
+		else if (c > limit)
+			c = limit;
+		return static_cast<int64_t>(c);
+	}
+
+	static uint Bucket(int64_t x, int64_t y, int64_t z, size_t numBuckets) {
+		uint64_t h = static_cast<uint64_t>(x) * 0x9E3779B185EBCA87ull;
+		h ^= static_cast<uint64_t>(y) * 0xC2B2AE3D27D4EB4Full;
+		h ^= static_cast<uint64_t>(z) * 0x165667B19E3779F9ull;
+		h ^= h >> 29;
+		return static_cast<uint>(h & (numBuckets - 1));
+	}
+};
+
 class kd_query_result {
 public:
 	Vector3* v;
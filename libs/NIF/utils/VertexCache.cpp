@@ -0,0 +1,214 @@
+#include "VertexCache.h"
+
+namespace {
+	// Tuning from Forsyth's article
+	const float CacheDecayPower = 1.5f;
+	const float LastTriScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	// Scores of the valences below this are looked up instead of computed
+	const int ValenceTableSize = 32;
+
+	struct ScoreTables {
+		float cache[VertexCacheOptimizer::CacheSize];
+		float valence[ValenceTableSize];
+
+		ScoreTables() {
+			for (int i = 0; i < VertexCacheOptimizer::CacheSize; i++) {
+				// The last triangle's vertices get a fixed score, or the
+				// next triangle would always share an edge with it, which
+				// uses the cache like a strip and no better.
+				if (i < 3)
+					cache[i] = LastTriScore;
+				else
+					cache[i] = std::pow(1.0f - (i - 3) / float(VertexCacheOptimizer::CacheSize - 3), CacheDecayPower);
+			}
+
+			valence[0] = 0.0f;
+			for (int i = 1; i < ValenceTableSize; i++)
+				valence[i] = ValenceBoostScale * std::pow(float(i), -ValenceBoostPower);
+		}
+	};
+
+	const ScoreTables scoreTables;
+
+	float VertexScore(const int cachePos, const int activeTris) {
+		// No triangles left to emit
+		if (activeTris == 0)
+			return -1.0f;
+
+		float score = cachePos >= 0 ? scoreTables.cache[cachePos] : 0.0f;
+
+		// Boost vertices with few triangles left, to finish them off
+		// rather than leave lone triangles behind for later.
+		if (activeTris < ValenceTableSize)
+			score += scoreTables.valence[activeTris];
+		else
+			score += ValenceBoostScale * std::pow(float(activeTris), -ValenceBoostPower);
+
+		return score;
+	}
+}
+
+void VertexCacheOptimizer::OrderTriangles(const std::vector<Triangle>& tris, const uint first, const uint count, const int numVerts, std::vector<uint>& order) {
+	if (count == 0)
+		return;
+
+	if (count < 3) {
+		for (uint t = 0; t < count; t++)
+			order.push_back(first + t);
+		return;
+	}
+
+	// Triangles using each vertex, in one flat array.  The triangles of
+	// vertex v are vertTris[triStart[v]] to vertTris[triStart[v] + activeTris[v] - 1];
+	// emitted triangles are swapped out past the end.
+	std::vector<uint> triStart(numVerts + 1, 0);
+	for (uint t = first; t < first + count; t++) {
+		triStart[tris[t].p1 + 1]++;
+		triStart[tris[t].p2 + 1]++;
+		triStart[tris[t].p3 + 1]++;
+	}
+
+	std::vector<int> activeTris(numVerts);
+	for (int v = 0; v < numVerts; v++) {
+		activeTris[v] = triStart[v + 1];
+		triStart[v + 1] += triStart[v];
+	}
+
+	std::vector<uint> vertTris(count * 3);
+	std::vector<uint> fill(triStart.begin(), triStart.end() - 1);
+	for (uint t = 0; t < count; t++) {
+		const Triangle& tri = tris[first + t];
+		vertTris[fill[tri.p1]++] = t;
+		vertTris[fill[tri.p2]++] = t;
+		vertTris[fill[tri.p3]++] = t;
+	}
+
+	std::vector<int> cachePos(numVerts, -1);
+	std::vector<float> vertScore(numVerts);
+	for (int v = 0; v < numVerts; v++)
+		vertScore[v] = VertexScore(-1, activeTris[v]);
+
+	std::vector<float> triScore(count);
+	std::vector<bool> emitted(count, false);
+	int bestTri = -1;
+	float bestScore = -1.0f;
+	for (uint t = 0; t < count; t++) {
+		const Triangle& tri = tris[first + t];
+		triScore[t] = vertScore[tri.p1] + vertScore[tri.p2] + vertScore[tri.p3];
+		if (triScore[t] > bestScore) {
+			bestScore = triScore[t];
+			bestTri = t;
+		}
+	}
+
+	// The cache grows by up to 3 vertices per triangle before the oldest drop out
+	std::vector<ushort> cache;
+	std::vector<ushort> newCache;
+	cache.reserve(CacheSize + 3);
+	newCache.reserve(CacheSize + 3);
+
+	uint nextTri = 0;
+	for (uint n = 0; n < count; n++) {
+		// Nothing left next to the cache, continue with the next triangle in the original order
+		if (bestTri < 0) {
+			while (emitted[nextTri])
+				nextTri++;
+			bestTri = nextTri;
+		}
+
+		emitted[bestTri] = true;
+		order.push_back(first + bestTri);
+
+		const Triangle& tri = tris[first + bestTri];
+		const ushort corners[3] = { tri.p1, tri.p2, tri.p3 };
+
+		newCache.clear();
+		for (ushort v : corners) {
+			// Swap the triangle out of the vertex's active triangles
+			uint* vt = &vertTris[triStart[v]];
+			int last = activeTris[v] - 1;
+			for (int i = 0; i <= last; i++) {
+				if (vt[i] == uint(bestTri)) {
+					std::swap(vt[i], vt[last]);
+					break;
+				}
+			}
+			activeTris[v]--;
+
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+				newCache.push_back(v);
+		}
+
+		for (ushort v : cache)
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+				newCache.push_back(v);
+
+		for (int i = 0; i < newCache.size(); i++) {
+			ushort v = newCache[i];
+			cachePos[v] = i < CacheSize ? i : -1;
+			vertScore[v] = VertexScore(cachePos[v], activeTris[v]);
+		}
+
+		// Rescore the triangles of every vertex whose score changed, the best of them is next
+		bestTri = -1;
+		bestScore = -1.0f;
+		for (ushort v : newCache) {
+			const uint* vt = &vertTris[triStart[v]];
+			for (int i = 0; i < activeTris[v]; i++) {
+				uint t = vt[i];
+				const Triangle& at = tris[first + t];
+				triScore[t] = vertScore[at.p1] + vertScore[at.p2] + vertScore[at.p3];
+				if (triScore[t] > bestScore) {
+					bestScore = triScore[t];
+					bestTri = t;
+				}
+			}
+		}
+
+		if (newCache.size() > CacheSize)
+			newCache.resize(CacheSize);
+		std::swap(cache, newCache);
+	}
+}
+
+std::vector<int> VertexCacheOptimizer::OrderVertices(const std::vector<Triangle>& tris, const int numVerts) {
+	std::vector<int> vertMap(numVerts, -1);
+	int next = 0;
+	for (const Triangle& tri : tris) {
+		for (ushort v : { tri.p1, tri.p2, tri.p3 })
+			if (v < numVerts && vertMap[v] < 0)
+				vertMap[v] = next++;
+	}
+
+	for (int v = 0; v < numVerts; v++)
+		if (vertMap[v] < 0)
+			vertMap[v] = next++;
+
+	return vertMap;
+}
+
+float VertexCacheOptimizer::CalcACMR(const std::vector<Triangle>& tris, const int numVerts, const int cacheSize) {
+	if (tris.empty())
+		return 0.0f;
+
+	// A vertex is in the FIFO while fewer than cacheSize misses happened since its own
+	std::vector<uint> missTime(numVerts, 0);
+	uint time = cacheSize + 1;
+	uint misses = 0;
+	for (const Triangle& tri : tris) {
+		for (ushort v : { tri.p1, tri.p2, tri.p3 }) {
+			if (v >= numVerts)
+				continue;
+
+			if (time - missTime[v] > uint(cacheSize)) {
+				missTime[v] = time++;
+				misses++;
+			}
+		}
+	}
+
+	return float(misses) / tris.size();
+}
@@ -0,0 +1,39 @@
+/*
+BodySlide and Outfit Studio
+See the included LICENSE file
+*/
+
+#pragma once
+
+#include "Object3d.h"
+
+// VertexCacheOptimizer: reorders triangles for the post-transform vertex
+// cache, following Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+// Each vertex is scored by its position in a simulated LRU cache and by
+// how many triangles still need it, and the next triangle is always the
+// best scoring one touching the cache.  Vertices are then renumbered in
+// the order the triangles first use them, so that fetches walk forward
+// through the vertex buffer.
+class VertexCacheOptimizer {
+public:
+	// Size of the simulated LRU cache.  Larger than the FIFO of any
+	// hardware the games run on, which the scoring accounts for.
+	static constexpr int CacheSize = 32;
+
+	// OrderTriangles: appends the indices of tris[first] to
+	// tris[first + count - 1] to order, best order for the cache first.
+	// Only triangles in that range are reordered, so ranges that must stay
+	// together (partitions, segments) can be optimized one at a time.
+	// All indices of the triangles must be below numVerts.
+	static void OrderTriangles(const std::vector<Triangle>& tris, const uint first, const uint count, const int numVerts, std::vector<uint>& order);
+
+	// OrderVertices: returns the new index of each vertex, numbered in
+	// order of first use by tris.  Unused vertices keep their relative
+	// order after all used ones.
+	static std::vector<int> OrderVertices(const std::vector<Triangle>& tris, const int numVerts);
+
+	// CalcACMR: average cache miss ratio, the number of vertices
+	// transformed per triangle with a FIFO cache of cacheSize entries.
+	// Between 0.5 (ideal for large meshes) and 3 (no reuse at all).
+	static float CalcACMR(const std::vector<Triangle>& tris, const int numVerts, const int cacheSize = 16);
+};
@@ -0,0 +1,382 @@
+/* Copyright (C) 2019 G'k
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include "bs_archive_reader.hpp"
+#include "bs_format.hpp"
+#include "bs_hash.hpp"
+#include "utils/parallel_for.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef BSARCH_HAS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef BSARCH_HAS_LZ4
+#include <lz4frame.h>
+#endif
+
+namespace libbsarch {
+namespace {
+//! Bounds-checked little endian reads from the mapping
+class cursor
+{
+public:
+    cursor(const uint8_t *data, size_t size, size_t position)
+        : data_(data)
+        , size_(size)
+        , position_(position)
+    {}
+
+    void need(size_t count) const
+    {
+        if (position_ > size_ || size_ - position_ < count)
+            throw std::runtime_error("Archive is truncated or corrupted");
+    }
+
+    template<typename T>
+    T read()
+    {
+        need(sizeof(T));
+        T value;
+        std::memcpy(&value, data_ + position_, sizeof(T));
+        position_ += sizeof(T);
+        return value;
+    }
+
+    //! Length prefixed, the length counts the terminating zero if there is one
+    std::string read_bstring()
+    {
+        const uint8_t length = read<uint8_t>();
+        need(length);
+        std::string result(reinterpret_cast<const char *>(data_ + position_), length);
+        position_ += length;
+        if (!result.empty() && result.back() == '\0')
+            result.pop_back();
+        return result;
+    }
+
+    //! Zero terminated
+    std::string_view read_zstring()
+    {
+        const auto *begin = reinterpret_cast<const char *>(data_ + position_);
+        need(1);
+        const void *end = std::memchr(begin, 0, size_ - position_);
+        if (!end)
+            throw std::runtime_error("Archive is truncated or corrupted");
+        const size_t length = static_cast<const char *>(end) - begin;
+        position_ += length + 1;
+        return {begin, length};
+    }
+
+    size_t position() const { return position_; }
+
+private:
+    const uint8_t *data_;
+    size_t size_;
+    size_t position_;
+};
+
+void decompress_zlib(byte_span source, void *destination, uint32_t size)
+{
+#ifdef BSARCH_HAS_ZLIB
+    uLongf destination_size = size;
+    const int result = uncompress(static_cast<Bytef *>(destination),
+                                  &destination_size,
+                                  source.data,
+                                  static_cast<uLong>(source.size));
+    // Z_BUF_ERROR happens in vanilla "Fallout - Misc.bsa", BSArch ignores it as well
+    if (result != Z_OK && result != Z_BUF_ERROR)
+        throw std::runtime_error("Failed to inflate archive file");
+#else
+    (void) source;
+    (void) destination;
+    (void) size;
+    throw std::runtime_error("libbsarch was built without zlib, compressed files can't be extracted");
+#endif
+}
+
+//! With partial set, stops once destination is full instead of requiring the frame to fill it exactly
+void decompress_lz4(byte_span source, void *destination, uint32_t size, bool partial = false)
+{
+#ifdef BSARCH_HAS_LZ4
+    LZ4F_dctx *context = nullptr;
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION)))
+        throw std::runtime_error("Failed to create an LZ4 context");
+
+    auto *out = static_cast<uint8_t *>(destination);
+    const uint8_t *in = source.data;
+    size_t out_left = size;
+    size_t in_left = source.size;
+    size_t hint = 1;
+    while (hint != 0 && in_left > 0 && out_left > 0)
+    {
+        size_t out_size = out_left;
+        size_t in_size = in_left;
+        hint = LZ4F_decompress(context, out, &out_size, in, &in_size, nullptr);
+        if (LZ4F_isError(hint))
+        {
+            LZ4F_freeDecompressionContext(context);
+            throw std::runtime_error("Failed to decompress LZ4 archive file");
+        }
+        out += out_size;
+        out_left -= out_size;
+        in += in_size;
+        in_left -= in_size;
+        if (out_size == 0 && in_size == 0)
+            break;
+    }
+    LZ4F_freeDecompressionContext(context);
+    if (out_left != 0 && !partial)
+        throw std::runtime_error("LZ4 archive file is shorter than its recorded size");
+#else
+    (void) source;
+    (void) destination;
+    (void) size;
+    (void) partial;
+    throw std::runtime_error("libbsarch was built without LZ4, compressed files can't be extracted");
+#endif
+}
+} // namespace
+
+bs_archive_reader::bs_archive_reader(const std::filesystem::path &archive_path)
+    : file_(archive_path)
+{
+    cursor in(file_.data(), file_.size(), 0);
+    if (in.read<uint32_t>() != tes4::magic)
+        throw std::runtime_error("Not a TES4/SSE archive: " + archive_path.string());
+
+    const uint32_t version = in.read<uint32_t>();
+    switch (version)
+    {
+        case tes4::version_tes4: format_ = format::tes4; break;
+        case tes4::version_fo3: format_ = format::fo3; break;
+        case tes4::version_sse: format_ = format::sse; break;
+        default: throw std::runtime_error("Unknown archive version " + std::to_string(version));
+    }
+
+    const uint32_t folders_offset = in.read<uint32_t>();
+    archive_flags_ = in.read<uint32_t>();
+    const uint32_t folder_count = in.read<uint32_t>();
+    const uint32_t file_count = in.read<uint32_t>();
+    in.read<uint32_t>(); // total folder names length
+    const uint32_t file_names_length = in.read<uint32_t>();
+    in.read<uint32_t>(); // file flags
+
+    const bool default_compressed = (archive_flags_ & tes4::archive_compress) != 0;
+
+    // Don't trust the counts for allocations before checking the records fit in the file
+    const uint64_t folder_record_size = format_ == format::sse ? 24 : 16;
+    if (folders_offset + folder_count * folder_record_size + file_count * uint64_t(16) > file_.size())
+        throw std::runtime_error("Archive is truncated or corrupted");
+
+    struct folder_record
+    {
+        uint64_t hash;
+        uint32_t count;
+    };
+    std::vector<folder_record> folders(folder_count);
+    cursor records(file_.data(), file_.size(), folders_offset);
+    for (auto &folder : folders)
+    {
+        folder.hash = records.read<uint64_t>();
+        folder.count = records.read<uint32_t>();
+        if (format_ == format::sse)
+        {
+            records.read<uint32_t>(); // padding
+            records.read<uint64_t>(); // offset
+        }
+        else
+        {
+            records.read<uint32_t>(); // offset
+        }
+    }
+
+    files_.reserve(file_count);
+    folder_names_.reserve(folder_count);
+    for (uint32_t i = 0; i < folder_count; i++)
+    {
+        folder_names_.push_back((archive_flags_ & tes4::archive_pathnames) ? records.read_bstring() : std::string());
+        for (uint32_t j = 0; j < folders[i].count; j++)
+        {
+            file_entry entry{};
+            entry.folder_hash = folders[i].hash;
+            entry.file_hash = records.read<uint64_t>();
+            const uint32_t size = records.read<uint32_t>();
+            entry.offset = records.read<uint32_t>();
+            entry.stored_size = size & ~tes4::file_size_compress;
+            entry.compressed = default_compressed != ((size & tes4::file_size_compress) != 0);
+            entry.folder_index = i;
+            entry.name_offset = no_name;
+
+            if (entry.offset > file_.size() || file_.size() - entry.offset < entry.stored_size)
+                throw std::runtime_error("Archive file record points past the end of the archive");
+            files_.push_back(entry);
+        }
+    }
+
+    // File names follow the records in the same order
+    if (archive_flags_ & tes4::archive_filenames)
+    {
+        cursor names(file_.data(), file_.size(), records.position());
+        names.need(file_names_length);
+        file_names_.reserve(file_names_length);
+        for (auto &entry : files_)
+        {
+            const std::string_view name = names.read_zstring();
+            entry.name_offset = static_cast<uint32_t>(file_names_.size());
+            file_names_.insert(file_names_.end(), name.begin(), name.end());
+            file_names_.push_back('\0');
+        }
+    }
+
+    // Records are normally sorted already, this is cheap then and keeps find() correct otherwise
+    std::stable_sort(files_.begin(), files_.end(), [](const file_entry &a, const file_entry &b) {
+        return a.folder_hash != b.folder_hash ? a.folder_hash < b.folder_hash : a.file_hash < b.file_hash;
+    });
+}
+
+const bs_archive_reader::file_entry *bs_archive_reader::find(std::string_view path) const
+{
+    const std::string normalized = normalize_path(path);
+    std::string_view folder, file_name;
+    split_path(normalized, folder, file_name);
+    const uint64_t folder_hash = hash_tes4_folder(folder);
+    const uint64_t file_hash = hash_tes4_file(file_name);
+
+    auto it = std::lower_bound(files_.begin(), files_.end(), std::make_pair(folder_hash, file_hash),
+                               [](const file_entry &entry, const std::pair<uint64_t, uint64_t> &key) {
+                                   return entry.folder_hash != key.first ? entry.folder_hash < key.first
+                                                                         : entry.file_hash < key.second;
+                               });
+
+    // Hashes can collide, use the names to pick the right one when the archive has them
+    const file_entry *match = nullptr;
+    for (; it != files_.end() && it->folder_hash == folder_hash && it->file_hash == file_hash; ++it)
+    {
+        if (!match)
+            match = &*it;
+        if (it->name_offset != no_name && normalize_path(path_of(*it)) == normalized)
+            return &*it;
+    }
+    return match;
+}
+
+std::string bs_archive_reader::path_of(const file_entry &entry) const
+{
+    if (entry.name_offset == no_name)
+        return {};
+    std::string result = folder_names_[entry.folder_index];
+    if (!result.empty())
+        result += '\\';
+    result += &file_names_[entry.name_offset];
+    return result;
+}
+
+byte_span bs_archive_reader::payload(const file_entry &entry) const
+{
+    cursor in(file_.data(), file_.size(), static_cast<size_t>(entry.offset));
+    size_t size = entry.stored_size;
+
+    if (format_ != format::tes4 && (archive_flags_ & tes4::archive_embedname))
+    {
+        const uint8_t length = in.read<uint8_t>();
+        if (size < length + 1u)
+            throw std::runtime_error("Archive file is smaller than its embedded name");
+        size -= length + 1u;
+        in = cursor(file_.data(), file_.size(), in.position() + length);
+    }
+
+    in.need(size);
+    return {file_.data() + in.position(), size};
+}
+
+uint32_t bs_archive_reader::extracted_size(const file_entry &entry) const
+{
+    const byte_span data = payload(entry);
+    if (!entry.compressed)
+        return static_cast<uint32_t>(data.size);
+
+    cursor in(data.data, data.size, 0);
+    return in.read<uint32_t>();
+}
+
+bool bs_archive_reader::view(const file_entry &entry, byte_span &result) const
+{
+    if (entry.compressed)
+        return false;
+    result = payload(entry);
+    return true;
+}
+
+void bs_archive_reader::extract(const file_entry &entry, void *buffer, size_t buffer_size) const
+{
+    const byte_span data = payload(entry);
+    if (!entry.compressed)
+    {
+        if (buffer_size < data.size)
+            throw std::runtime_error("Extraction buffer is too small");
+        if (data.size > 0)
+            std::memcpy(buffer, data.data, data.size);
+        return;
+    }
+
+    cursor in(data.data, data.size, 0);
+    const uint32_t size = in.read<uint32_t>();
+    if (buffer_size < size)
+        throw std::runtime_error("Extraction buffer is too small");
+    if (size == 0)
+        return;
+
+    const byte_span compressed{data.data + sizeof(uint32_t), data.size - sizeof(uint32_t)};
+    if (format_ == format::sse)
+        decompress_lz4(compressed, buffer, size);
+    else
+        decompress_zlib(compressed, buffer, size);
+}
+
+size_t bs_archive_reader::extract_head(const file_entry &entry, void *buffer, size_t buffer_size) const
+{
+    const byte_span data = payload(entry);
+    if (!entry.compressed)
+    {
+        const size_t size = std::min(buffer_size, data.size);
+        if (size > 0)
+            std::memcpy(buffer, data.data, size);
+        return size;
+    }
+
+    cursor in(data.data, data.size, 0);
+    const auto size = static_cast<uint32_t>(std::min<size_t>(buffer_size, in.read<uint32_t>()));
+    if (size == 0)
+        return 0;
+
+    // zlib reports a short destination as Z_BUF_ERROR, which is already ignored
+    const byte_span compressed{data.data + sizeof(uint32_t), data.size - sizeof(uint32_t)};
+    if (format_ == format::sse)
+        decompress_lz4(compressed, buffer, size, true);
+    else
+        decompress_zlib(compressed, buffer, size);
+    return size;
+}
+
+void bs_archive_reader::extract_parallel(const std::vector<const file_entry *> &entries,
+                                         const buffer_provider &provide,
+                                         unsigned threads) const
+{
+    std::vector<const file_entry *> ordered(entries);
+    std::sort(ordered.begin(), ordered.end(), [](const file_entry *a, const file_entry *b) {
+        return a->offset < b->offset;
+    });
+
+    parallel_for(ordered.size(), threads, [&](size_t i) {
+        const file_entry &entry = *ordered[i];
+        const uint32_t size = extracted_size(entry);
+        void *buffer = provide(entry, size);
+        if (buffer)
+            extract(entry, buffer, size);
+    });
+}
+} // namespace libbsarch
@@ -0,0 +1,115 @@
+/* Copyright (C) 2019 G'k
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "utils/mapped_file.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace libbsarch {
+struct byte_span
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+};
+
+/*!
+ * \brief Native reader for Oblivion, Fallout 3/New Vegas, Skyrim LE and Skyrim SE archives, without the Delphi DLL.
+ * The archive is memory-mapped and its records are parsed into one flat index sorted by (folder hash, file hash).
+ * Uncompressed files are returned as spans into the mapping; compressed ones (zlib before SSE, LZ4 frames for SSE)
+ * are decompressed into caller buffers. Once constructed, every const member is safe to call from any thread.
+ * Errors throw std::runtime_error, like the rest of the C++ wrappers.
+ */
+class bs_archive_reader
+{
+public:
+    enum class format
+    {
+        tes4, // Oblivion
+        fo3,  // Fallout 3, New Vegas, Skyrim LE
+        sse,  // Skyrim SE
+    };
+
+    struct file_entry
+    {
+        uint64_t folder_hash;
+        uint64_t file_hash;
+        uint64_t offset;       // start of the stored data, embedded name included
+        uint32_t stored_size;  // bytes at offset
+        uint32_t folder_index; // into folder names
+        uint32_t name_offset;  // into the file name pool, no_name if the archive has no file names
+        bool compressed;
+    };
+
+    static constexpr uint32_t no_name = 0xFFFFFFFFu;
+
+    explicit bs_archive_reader(const std::filesystem::path &archive_path);
+
+    format get_format() const { return format_; }
+    uint32_t get_archive_flags() const { return archive_flags_; }
+
+    //! \brief Every file, sorted by (folder_hash, file_hash)
+    const std::vector<file_entry> &files() const { return files_; }
+
+    /*!
+     * \brief Look a file up by its path inside the archive, case and slash direction don't matter
+     * \return nullptr if the archive doesn't contain it
+     */
+    const file_entry *find(std::string_view path) const;
+
+    //! \brief "folder\\file.ext", or an empty string if the archive doesn't store names
+    std::string path_of(const file_entry &entry) const;
+
+    //! \brief Size of the file once extracted
+    uint32_t extracted_size(const file_entry &entry) const;
+
+    /*!
+     * \brief Zero-copy access to an uncompressed file. The span lives as long as the reader
+     * \return False if the file is compressed and has to go through extract()
+     */
+    bool view(const file_entry &entry, byte_span &result) const;
+
+    /*!
+     * \brief Extract into buffer, which must hold at least extracted_size(entry) bytes
+     */
+    void extract(const file_entry &entry, void *buffer, size_t buffer_size) const;
+
+    /*!
+     * \brief Extract only the start of a file, such as a DDS header, decompressing no more than needed
+     * \return Bytes written to buffer, less than buffer_size if the file is smaller
+     */
+    size_t extract_head(const file_entry &entry, void *buffer, size_t buffer_size) const;
+
+    /*!
+     * \brief Returns where an entry should be extracted to, given its extracted size, or nullptr to skip it.
+     * Called from worker threads
+     */
+    using buffer_provider = std::function<void *(const file_entry &entry, uint32_t size)>;
+
+    /*!
+     * \brief Extract many files on worker threads. Entries are read in archive order so the mapping is walked
+     * sequentially. Uncompressed files are copied too; use view() first to avoid that.
+     * \param threads 0 uses one thread per core
+     */
+    void extract_parallel(const std::vector<const file_entry *> &entries,
+                          const buffer_provider &provide,
+                          unsigned threads = 0) const;
+
+private:
+    byte_span payload(const file_entry &entry) const;
+
+    mapped_file file_;
+    format format_;
+    uint32_t archive_flags_ = 0;
+    std::vector<file_entry> files_;
+    std::vector<std::string> folder_names_;
+    std::vector<char> file_names_;
+};
+} // namespace libbsarch
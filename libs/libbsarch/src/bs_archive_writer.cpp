@@ -0,0 +1,418 @@
+/* Copyright (C) 2019 G'k
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include "bs_archive_writer.hpp"
+#include "bs_format.hpp"
+#include "bs_hash.hpp"
+#include "utils/parallel_for.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+#ifdef BSARCH_HAS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef BSARCH_HAS_LZ4
+#include <lz4frame.h>
+#endif
+
+namespace libbsarch {
+namespace {
+// Files smaller than this are never compressed, like in BSArch
+constexpr size_t min_compressed_size = 32;
+
+inline uint64_t rotl64(uint64_t x, unsigned r)
+{
+    return (x << r) | (x >> (64u - r));
+}
+
+inline uint64_t fmix64(uint64_t h)
+{
+    h ^= h >> 33u;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33u;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33u;
+    return h;
+}
+
+//! Only used to find candidates, identical payloads are confirmed with memcmp
+uint64_t content_hash(byte_span data)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ data.size;
+    size_t i = 0;
+    for (; i + 8 <= data.size; i += 8)
+    {
+        uint64_t v;
+        std::memcpy(&v, data.data + i, 8);
+        h = rotl64(h ^ (v * 0x87C37B91114253D5ull), 31) * 0x4CF5AD432745937Full;
+    }
+    if (i < data.size)
+    {
+        uint64_t v = 0;
+        std::memcpy(&v, data.data + i, data.size - i);
+        h ^= v * 0x87C37B91114253D5ull;
+    }
+    return fmix64(h);
+}
+
+std::vector<uint8_t> compress_zlib(byte_span data)
+{
+#ifdef BSARCH_HAS_ZLIB
+    uLongf size = compressBound(static_cast<uLong>(data.size));
+    std::vector<uint8_t> result(size);
+    if (compress2(result.data(), &size, data.data, static_cast<uLong>(data.size), Z_DEFAULT_COMPRESSION) != Z_OK)
+        throw std::runtime_error("Failed to deflate archive file");
+    result.resize(size);
+    return result;
+#else
+    (void) data;
+    throw std::runtime_error("libbsarch was built without zlib, compressed archives can't be written");
+#endif
+}
+
+std::vector<uint8_t> compress_lz4(byte_span data)
+{
+#ifdef BSARCH_HAS_LZ4
+    std::vector<uint8_t> result(LZ4F_compressFrameBound(data.size, nullptr));
+    const size_t size = LZ4F_compressFrame(result.data(), result.size(), data.data, data.size, nullptr);
+    if (LZ4F_isError(size))
+        throw std::runtime_error("Failed to compress archive file with LZ4");
+    result.resize(size);
+    return result;
+#else
+    (void) data;
+    throw std::runtime_error("libbsarch was built without LZ4, compressed archives can't be written");
+#endif
+}
+
+uint32_t file_flag(std::string_view ext)
+{
+    if (ext == ".nif")
+        return tes4::file_nif;
+    if (ext == ".dds")
+        return tes4::file_dds;
+    if (ext == ".xml")
+        return tes4::file_xml | tes4::file_misc;
+    if (ext == ".wav" || ext == ".fuz")
+        return tes4::file_wav;
+    if (ext == ".mp3" || ext == ".ogg")
+        return tes4::file_mp3;
+    if (ext == ".txt" || ext == ".htm" || ext == ".bat" || ext == ".scc")
+        return tes4::file_txt;
+    if (ext == ".spt")
+        return tes4::file_spt;
+    if (ext == ".fnt" || ext == ".tex")
+        return tes4::file_fnt;
+    return tes4::file_misc;
+}
+
+class output_stream
+{
+public:
+    explicit output_stream(const std::filesystem::path &path)
+        : buffer_(1u << 20u)
+    {
+        out_.rdbuf()->pubsetbuf(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        out_.open(path, std::ios::binary | std::ios::trunc);
+        if (!out_)
+            throw std::runtime_error("Failed to create archive " + path.string());
+    }
+
+    template<typename T>
+    void write(T value)
+    {
+        out_.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void write(const void *data, size_t size)
+    {
+        out_.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    }
+
+    void close(const std::filesystem::path &path)
+    {
+        out_.close();
+        if (!out_)
+            throw std::runtime_error("Failed to write archive " + path.string());
+    }
+
+private:
+    std::vector<char> buffer_;
+    std::ofstream out_;
+};
+} // namespace
+
+bs_archive_writer::bs_archive_writer(format type)
+    : type_(type)
+{}
+
+void bs_archive_writer::add_file(const std::string &path_in_archive, std::vector<uint8_t> data)
+{
+    pending_file file;
+    file.path = normalize_path(path_in_archive);
+    file.owned = std::move(data);
+    file.data = {file.owned.data(), file.owned.size()};
+    files_.push_back(std::move(file));
+}
+
+void bs_archive_writer::add_file(const std::string &path_in_archive, byte_span data)
+{
+    pending_file file;
+    file.path = normalize_path(path_in_archive);
+    file.data = data;
+    files_.push_back(std::move(file));
+}
+
+bs_archive_writer::save_stats bs_archive_writer::save(const std::filesystem::path &archive_path, unsigned threads) const
+{
+    if (files_.empty())
+        throw std::runtime_error("Archive requires at least one file");
+
+    struct record
+    {
+        uint64_t folder_hash;
+        uint64_t file_hash;
+        const pending_file *file;
+        std::string_view folder;
+        std::string_view name;
+    };
+
+    // Folders and files are stored sorted by hash
+    uint32_t file_flags = 0;
+    std::vector<record> records;
+    records.reserve(files_.size());
+    for (const pending_file &file : files_)
+    {
+        record r{};
+        r.file = &file;
+        split_path(file.path, r.folder, r.name);
+        if (r.folder.empty())
+            throw std::runtime_error("File is missing the folder part: " + file.path);
+        if (r.folder.size() > 254 || file.path.size() > 255)
+            throw std::runtime_error("Path is too long to be stored: " + file.path);
+        if (file.data.size >= tes4::file_size_compress)
+            throw std::runtime_error("File is too large to be stored: " + file.path);
+        r.folder_hash = hash_tes4_folder(r.folder);
+        r.file_hash = hash_tes4_file(r.name);
+
+        const size_t dot = r.name.rfind('.');
+        file_flags |= file_flag(dot == std::string_view::npos ? std::string_view() : r.name.substr(dot));
+        records.push_back(r);
+    }
+    std::sort(records.begin(), records.end(), [](const record &a, const record &b) {
+        return a.folder_hash != b.folder_hash ? a.folder_hash < b.folder_hash : a.file_hash < b.file_hash;
+    });
+    for (size_t i = 1; i < records.size(); i++)
+    {
+        if (records[i].folder_hash == records[i - 1].folder_hash && records[i].file_hash == records[i - 1].file_hash)
+            throw std::runtime_error("Duplicate file or hash collision: " + records[i].file->path);
+    }
+
+    struct folder
+    {
+        uint64_t hash;
+        std::string_view name;
+        size_t first;
+        uint32_t count;
+    };
+    std::vector<folder> folders;
+    uint32_t folder_names_length = 0;
+    uint32_t file_names_length = 0;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        if (folders.empty() || folders.back().hash != records[i].folder_hash)
+        {
+            folders.push_back({records[i].folder_hash, records[i].folder, i, 0});
+            folder_names_length += static_cast<uint32_t>(records[i].folder.size() + 1);
+        }
+        folders.back().count++;
+        file_names_length += static_cast<uint32_t>(records[i].name.size() + 1);
+    }
+
+    // Same flags as TwbBSArchive.CreateArchiveCompat
+    uint32_t version = tes4::version_sse;
+    uint32_t archive_flags = tes4::archive_pathnames | tes4::archive_filenames;
+    switch (type_)
+    {
+        case format::tes4:
+            version = tes4::version_tes4;
+            archive_flags |= tes4::archive_embedname | tes4::archive_xmem | tes4::archive_unknown10;
+            break;
+        case format::fo3: version = tes4::version_fo3; break;
+        case format::sse: version = tes4::version_sse; break;
+    }
+    if (type_ == format::sse)
+        file_flags &= ~tes4::file_misc;
+    if (file_flags == tes4::file_dds)
+        archive_flags |= tes4::archive_embedname;
+    if (file_flags & tes4::file_nif)
+        archive_flags |= tes4::archive_startupstr;
+    if (file_flags & tes4::file_wav)
+        archive_flags |= tes4::archive_retainname;
+    if (type_ == format::tes4)
+        file_flags &= ~(tes4::file_xml | tes4::file_txt | tes4::file_fnt);
+    if (compressed_)
+        archive_flags |= tes4::archive_compress;
+
+    const bool embed_names = type_ != format::tes4 && (archive_flags & tes4::archive_embedname);
+
+    // Find identical payloads. Hashing runs in parallel, the matching is sequential so the result is deterministic
+    std::vector<size_t> source(records.size());
+    for (size_t i = 0; i < records.size(); i++)
+        source[i] = i;
+    if (share_data_)
+    {
+        std::vector<uint64_t> hashes(records.size());
+        parallel_for(records.size(), threads, [&](size_t i) { hashes[i] = content_hash(records[i].file->data); });
+
+        std::unordered_multimap<uint64_t, size_t> seen;
+        seen.reserve(records.size());
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            const byte_span data = records[i].file->data;
+            const auto range = seen.equal_range(hashes[i]);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                const byte_span other = records[it->second].file->data;
+                if (other.size == data.size && (data.size == 0 || std::memcmp(other.data, data.data, data.size) == 0))
+                {
+                    source[i] = it->second;
+                    break;
+                }
+            }
+            if (source[i] == i)
+                seen.emplace(hashes[i], i);
+        }
+    }
+
+    // Compress every unique payload into the staging area
+    std::vector<size_t> unique;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        if (source[i] == i)
+            unique.push_back(i);
+    }
+    std::vector<std::vector<uint8_t>> staged(records.size());
+    std::vector<bool> file_compressed(records.size(), false);
+    for (size_t i : unique)
+        file_compressed[i] = compressed_ && records[i].file->data.size >= min_compressed_size;
+    parallel_for(unique.size(), threads, [&](size_t u) {
+        const size_t i = unique[u];
+        if (file_compressed[i])
+            staged[i] = type_ == format::sse ? compress_lz4(records[i].file->data) : compress_zlib(records[i].file->data);
+    });
+
+    // Layout. Folder offsets point at the folder's name and file records, plus the file names length
+    const uint64_t folder_record_size = type_ == format::sse ? 24 : 16;
+    uint64_t position = tes4::header_size + folder_record_size * folders.size();
+    std::vector<uint64_t> folder_offsets(folders.size());
+    for (size_t f = 0; f < folders.size(); f++)
+    {
+        folder_offsets[f] = position + file_names_length;
+        position += 1 + folders[f].name.size() + 1 + 16ull * folders[f].count;
+    }
+    position += file_names_length;
+
+    std::vector<uint32_t> offsets(records.size());
+    std::vector<uint32_t> sizes(records.size());
+    save_stats stats{};
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        stats.files++;
+        stats.input_bytes += records[i].file->data.size;
+        if (source[i] != i)
+        {
+            stats.shared_files++;
+            offsets[i] = offsets[source[i]];
+            sizes[i] = sizes[source[i]];
+            continue;
+        }
+
+        uint64_t size = file_compressed[i] ? sizeof(uint32_t) + staged[i].size() : records[i].file->data.size;
+        if (embed_names)
+            size += 1 + records[i].file->path.size();
+        if (position + size > 0xFFFFFFFFull || size >= tes4::file_size_compress)
+            throw std::runtime_error("Archive is too large, split it: " + archive_path.string());
+
+        offsets[i] = static_cast<uint32_t>(position);
+        sizes[i] = static_cast<uint32_t>(size);
+        if (compressed_ && !file_compressed[i])
+            sizes[i] |= tes4::file_size_compress;
+        position += size;
+    }
+    stats.archive_bytes = position;
+
+    // Everything is known, write it all front to back
+    output_stream out(archive_path);
+    out.write(tes4::magic);
+    out.write(version);
+    out.write(tes4::header_size);
+    out.write(archive_flags);
+    out.write(static_cast<uint32_t>(folders.size()));
+    out.write(static_cast<uint32_t>(records.size()));
+    out.write(folder_names_length);
+    out.write(file_names_length);
+    out.write(file_flags);
+
+    for (size_t f = 0; f < folders.size(); f++)
+    {
+        out.write(folders[f].hash);
+        out.write(folders[f].count);
+        if (type_ == format::sse)
+        {
+            out.write(uint32_t(0));
+            out.write(folder_offsets[f]);
+        }
+        else
+        {
+            out.write(static_cast<uint32_t>(folder_offsets[f]));
+        }
+    }
+
+    for (const folder &f : folders)
+    {
+        out.write(static_cast<uint8_t>(f.name.size() + 1));
+        out.write(f.name.data(), f.name.size());
+        out.write(uint8_t(0));
+        for (size_t i = f.first; i < f.first + f.count; i++)
+        {
+            out.write(records[i].file_hash);
+            out.write(sizes[i]);
+            out.write(offsets[i]);
+        }
+    }
+
+    for (const record &r : records)
+    {
+        out.write(r.name.data(), r.name.size());
+        out.write(uint8_t(0));
+    }
+
+    for (size_t i : unique)
+    {
+        if (embed_names)
+        {
+            out.write(static_cast<uint8_t>(records[i].file->path.size()));
+            out.write(records[i].file->path.data(), records[i].file->path.size());
+        }
+        if (file_compressed[i])
+        {
+            out.write(static_cast<uint32_t>(records[i].file->data.size));
+            out.write(staged[i].data(), staged[i].size());
+        }
+        else if (records[i].file->data.size > 0)
+        {
+            out.write(records[i].file->data.data, records[i].file->data.size);
+        }
+    }
+
+    out.close(archive_path);
+    return stats;
+}
+} // namespace libbsarch
@@ -0,0 +1,65 @@
+/* Copyright (C) 2019 G'k
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "bs_archive_reader.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace libbsarch {
+/*!
+ * \brief Native writer for Oblivion, Fallout 3/New Vegas, Skyrim LE and Skyrim SE archives, without the Delphi DLL.
+ * Files are collected first. save() then hashes and compresses them on worker threads into a staging area,
+ * stores identical payloads once when share data is enabled, and writes the header, records and data in a single
+ * sequential pass. Flags follow TwbBSArchive.CreateArchiveCompat, so archives match what BSArch produces.
+ * Errors throw std::runtime_error.
+ */
+class bs_archive_writer
+{
+public:
+    using format = bs_archive_reader::format;
+
+    explicit bs_archive_writer(format type);
+
+    //! \brief Compress files of 32 bytes or more, zlib before SSE and LZ4 frames for SSE
+    void set_compressed(bool value) { compressed_ = value; }
+    //! \brief Store files with identical contents once
+    void set_share_data(bool value) { share_data_ = value; }
+
+    //! \brief Add a file, the writer keeps the data
+    void add_file(const std::string &path_in_archive, std::vector<uint8_t> data);
+    //! \brief Add a file without copying it, the data must stay valid until save() returns
+    void add_file(const std::string &path_in_archive, byte_span data);
+
+    struct save_stats
+    {
+        uint32_t files;
+        uint32_t shared_files; // stored as a reference to an identical file
+        uint64_t input_bytes;
+        uint64_t archive_bytes;
+    };
+
+    /*!
+     * \param threads 0 uses one thread per core
+     */
+    save_stats save(const std::filesystem::path &archive_path, unsigned threads = 0) const;
+
+private:
+    struct pending_file
+    {
+        std::string path; // normalized
+        std::vector<uint8_t> owned;
+        byte_span data;
+    };
+
+    format type_;
+    bool compressed_ = false;
+    bool share_data_ = false;
+    std::vector<pending_file> files_;
+};
+} // namespace libbsarch
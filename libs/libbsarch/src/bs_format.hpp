@@ -0,0 +1,42 @@
+/* Copyright (C) 2019 G'k
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <cstdint>
+
+// TES4/SSE archive constants, see https://github.com/jonwd7/bae/blob/master/src/bsa.h
+namespace libbsarch::tes4 {
+constexpr uint32_t magic = 0x00415342; // "BSA\0"
+
+constexpr uint32_t version_tes4 = 0x67; // Oblivion
+constexpr uint32_t version_fo3 = 0x68;  // FO3, FNV, TES5
+constexpr uint32_t version_sse = 0x69;  // SSE
+
+constexpr uint32_t header_size = 36;
+
+// archive flags
+constexpr uint32_t archive_pathnames = 0x0001;
+constexpr uint32_t archive_filenames = 0x0002;
+constexpr uint32_t archive_compress = 0x0004;
+constexpr uint32_t archive_retainname = 0x0010;
+constexpr uint32_t archive_startupstr = 0x0080;
+constexpr uint32_t archive_embedname = 0x0100;
+constexpr uint32_t archive_xmem = 0x0200;
+constexpr uint32_t archive_unknown10 = 0x0400;
+
+// file flags
+constexpr uint32_t file_nif = 0x0001;
+constexpr uint32_t file_dds = 0x0002;
+constexpr uint32_t file_xml = 0x0004;
+constexpr uint32_t file_wav = 0x0008;
+constexpr uint32_t file_mp3 = 0x0010;
+constexpr uint32_t file_txt = 0x0020;
+constexpr uint32_t file_spt = 0x0040;
+constexpr uint32_t file_fnt = 0x0080;
+constexpr uint32_t file_misc = 0x0100;
+
+// set in a file record's size when the file's compression is the opposite of archive_compress
+constexpr uint32_t file_size_compress = 0x40000000;
+} // namespace libbsarch::tes4
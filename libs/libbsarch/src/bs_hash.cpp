@@ -0,0 +1,90 @@
+/* Copyright (C) 2019 G'k
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include "bs_hash.hpp"
+
+namespace libbsarch {
+static inline uint8_t lower_byte(char c)
+{
+    const auto b = static_cast<uint8_t>(c);
+    return (b >= 'A' && b <= 'Z') ? static_cast<uint8_t>(b + ('a' - 'A')) : b;
+}
+
+std::string normalize_path(std::string_view path)
+{
+    std::string result(path);
+    for (char &c : result)
+    {
+        if (c == '/')
+            c = '\\';
+        else
+            c = static_cast<char>(lower_byte(c));
+    }
+    return result;
+}
+
+uint64_t hash_tes4(std::string_view name, std::string_view ext)
+{
+    const size_t l = name.size();
+    if (l == 0)
+        return 0;
+
+    uint64_t result = lower_byte(name[l - 1]);
+    if (l > 2)
+        result |= static_cast<uint64_t>(lower_byte(name[l - 2])) << 8u;
+    result |= static_cast<uint64_t>(l) << 16u;
+    result |= static_cast<uint64_t>(lower_byte(name[0])) << 24u;
+
+    uint32_t ext4 = 0;
+    for (size_t i = 0; i < ext.size() && i < 4; i++)
+        ext4 |= static_cast<uint32_t>(lower_byte(ext[i])) << (8u * i);
+
+    switch (ext4)
+    {
+        case 0x00666B2E: result |= 0x80; break;       // .kf
+        case 0x66696E2E: result |= 0x8000; break;     // .nif
+        case 0x7364642E: result |= 0x8080; break;     // .dds
+        case 0x7661772E: result |= 0x80000000; break; // .wav
+        default: break;
+    }
+
+    uint32_t hash = 0;
+    for (size_t i = 1; i + 2 < l; i++)
+        hash = lower_byte(name[i]) + (hash << 6u) + (hash << 16u) - hash;
+    result += static_cast<uint64_t>(hash) << 32u;
+
+    hash = 0;
+    for (char c : ext)
+        hash = lower_byte(c) + (hash << 6u) + (hash << 16u) - hash;
+    result += static_cast<uint64_t>(hash) << 32u;
+
+    return result;
+}
+
+uint64_t hash_tes4_folder(std::string_view folder)
+{
+    return hash_tes4(folder, {});
+}
+
+uint64_t hash_tes4_file(std::string_view file_name)
+{
+    const size_t dot = file_name.rfind('.');
+    if (dot == std::string_view::npos)
+        return hash_tes4(file_name, {});
+    return hash_tes4(file_name.substr(0, dot), file_name.substr(dot));
+}
+
+void split_path(std::string_view path, std::string_view &folder, std::string_view &file_name)
+{
+    const size_t slash = path.rfind('\\');
+    if (slash == std::string_view::npos)
+    {
+        folder = {};
+        file_name = path;
+        return;
+    }
+    folder = path.substr(0, slash);
+    file_name = path.substr(slash + 1);
+}
+} // namespace libbsarch
@@ -0,0 +1,31 @@
+/* Copyright (C) 2019 G'k
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace libbsarch {
+/*!
+ * \brief Lowercase the path and use backslashes, the form names are hashed and stored in
+ */
+std::string normalize_path(std::string_view path);
+
+/*!
+ * \brief Same as CreateHashTES4 in wbBSArchive.pas. ext includes the dot
+ */
+uint64_t hash_tes4(std::string_view name, std::string_view ext);
+
+//! \brief Hash of a folder path, without trailing backslash
+uint64_t hash_tes4_folder(std::string_view folder);
+//! \brief Hash of a file name, without its folder
+uint64_t hash_tes4_file(std::string_view file_name);
+
+/*!
+ * \brief Split a normalized path into its folder and file name. The folder is empty if there is no backslash
+ */
+void split_path(std::string_view path, std::string_view &folder, std::string_view &file_name);
+} // namespace libbsarch
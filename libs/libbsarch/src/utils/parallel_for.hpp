@@ -0,0 +1,68 @@
+/* Copyright (C) 2019 G'k
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libbsarch {
+/*!
+ * \brief Run function(i) for every i in [0, count) on up to threads threads, the calling one included.
+ * Indices are handed out in increasing order, so work over offset-sorted items stays close to sequential.
+ * The first exception stops the remaining work and is rethrown on the calling thread.
+ * \param threads 0 uses one thread per core
+ */
+template<typename Function>
+void parallel_for(size_t count, unsigned threads, const Function &function)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, count));
+
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto work = [&]() {
+        for (size_t i = next++; i < count; i = next++)
+        {
+            try
+            {
+                function(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+                next = count;
+            }
+        }
+    };
+
+    if (threads <= 1)
+    {
+        work();
+    }
+    else
+    {
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for (unsigned t = 1; t < threads; t++)
+            pool.emplace_back(work);
+        work();
+        for (auto &thread : pool)
+            thread.join();
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+}
+} // namespace libbsarch
@@ -7,13 +7,25 @@
 
 #include "main.h"
 
-#include "libbsarch.h"
+#include <bs_archive_reader.hpp>
+#include "archive_index.h"
 #include "processor.h"
 #include "resizer.h"
+#include "encoder.h"
+#include "output.h"
+#include "metrics.h"
+#include "memory_budget.h"
+#include "trace.h"
+#include "plan.h"
+#include "scoreboard.h"
+#include "textures.hpp"
 #include "sha2_512_256.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <chrono>
+#include <memory>
 #include <filesystem>
 #include <concurrent_queue.h>
 #include <concurrent_unordered_map.h>
@@ -42,6 +54,307 @@ inline bool isValidTexture(std::string const &str) {
            str.find("textures\\lod\\") == std::string::npos;
 }
 
+using ArchiveEntry = libbsarch::bs_archive_reader::file_entry;
+
+// Sizes every entry first, so each file is decompressed straight into a buffer from the PayloadPool, on the reader's
+// worker threads. The total is reserved in the memory budget under phase before anything is allocated, the workers
+// give it back
+static bool extractEntries(const libbsarch::bs_archive_reader &archive, const std::vector<const ArchiveEntry *> &entries,
+                           std::vector<GameData> &files, MemoryBudget::Phase phase) {
+    static Metrics::Stage &extractStage = Metrics::stage("archive.extract");
+    Metrics::Timer timer(extractStage);
+    timer.setItems(entries.size());
+
+    uint64_t reserved = 0;
+    bool acquired = false;
+    files.assign(entries.size(), GameData{nullptr, 0});
+    try {
+        std::unordered_map<const ArchiveEntry *, size_t> slots;
+        for (size_t i = 0; i < entries.size(); i++) {
+            files[i].length = archive.extracted_size(*entries[i]);
+            reserved += files[i].length;
+            slots[entries[i]] = i;
+        }
+        MemoryBudget::global().acquire(phase, reserved);
+        acquired = true;
+
+        for (auto &file : files) {
+            file.data = PayloadPool::global().allocate(file.length);
+            if (!file.data) {
+                throw std::runtime_error("Out of memory extracting " + std::to_string(entries.size()) + " files");
+            }
+        }
+
+        archive.extract_parallel(entries, [&](const ArchiveEntry &entry, uint32_t) -> void * {
+            return files[slots.at(&entry)].data;
+        });
+    } catch (const std::exception &e) {
+        std::wcout << "Failed to load BSA " << e.what() << std::endl;
+        for (auto &file : files) {
+            PayloadPool::global().free(file.data);
+        }
+        files.clear();
+        if (acquired) {
+            MemoryBudget::global().release(phase, reserved);
+        }
+        timer.fail();
+        return false;
+    }
+    timer.setBytesOut(reserved);
+    return true;
+}
+
+// A loose file read into memory we own, reserved in the budget like extractRecords. data is null if it can't be read
+static GameData readLooseFile(const std::filesystem::path &path, MemoryBudget::Phase phase) {
+    std::error_code ec;
+    const auto size = static_cast<size_t>(std::filesystem::file_size(path, ec));
+    if (ec) {
+        std::wcerr << L"Failed to read " << path << std::endl;
+        return GameData{nullptr, 0};
+    }
+    MemoryBudget::global().acquire(phase, size);
+
+    const Trace::Span span("read.loose", path.native());
+    std::ifstream in(path, std::ios::binary);
+    auto data = PayloadPool::global().allocate(size);
+    if (!data) {
+        std::wcerr << L"Out of memory reading " << path << std::endl;
+        MemoryBudget::global().release(phase, size);
+        return GameData{nullptr, 0};
+    }
+    in.read(data, static_cast<std::streamsize>(size));
+    const auto read = static_cast<size_t>(in.gcount());
+    MemoryBudget::global().release(phase, size - read);
+    return GameData{data, read};
+}
+
+// Where a mesh or texture is read from once a worker is ready for it: a record in one of the open archives, or a loose
+// file under data
+struct SourceLocation {
+    const libbsarch::bs_archive_reader *archive; // null for loose files
+    const ArchiveEntry *entry;
+    std::filesystem::path file;
+};
+
+using ArchiveList = std::vector<std::unique_ptr<libbsarch::bs_archive_reader>>;
+
+// Archives in load order then loose files, so consecutive items come out of one extraction
+template<typename Key>
+static void sortByArchive(std::vector<std::pair<Key, SourceLocation>> &items, const ArchiveList &order) {
+    std::unordered_map<const libbsarch::bs_archive_reader *, size_t> rank;
+    for (size_t i = 0; i < order.size(); i++) {
+        rank[order[i].get()] = i;
+    }
+    const auto rankOf = [&](const SourceLocation &location) {
+        return location.archive ? rank[location.archive] : order.size();
+    };
+    std::stable_sort(items.begin(), items.end(), [&](const auto &a, const auto &b) {
+        return rankOf(a.second) < rankOf(b.second);
+    });
+}
+
+// Reads items from next on, at most count of them and all from the same archive, and moves next past them. Blocks
+// while the memory budget is full, until the workers are done with earlier items
+template<typename Key>
+static bool loadBatch(const std::vector<std::pair<Key, SourceLocation>> &items, size_t &next, size_t count,
+                      MemoryBudget::Phase phase, std::vector<GameData> &files) {
+    const size_t first = next;
+    const libbsarch::bs_archive_reader *archive = items[first].second.archive;
+    while (next < items.size() && next - first < count && items[next].second.archive == archive) {
+        next++;
+    }
+
+    files.clear();
+    if (archive) {
+        std::vector<const ArchiveEntry *> entries;
+        for (size_t i = first; i < next; i++) {
+            entries.push_back(items[i].second.entry);
+        }
+        return extractEntries(*archive, entries, files, phase);
+    }
+    for (size_t i = first; i < next; i++) {
+        files.push_back(readLooseFile(items[i].second.file, phase));
+    }
+    return true;
+}
+
+// Magic, DDS_HEADER and DDS_HEADER_DXT10, everything GetMetadataFromDDSMemory looks at
+static constexpr size_t DDSHeadLength = 4 + 124 + 20;
+
+// The start of a texture, enough for its DDS header, and the size of the whole file. The rest is neither read nor
+// decompressed
+static bool readTextureHead(const SourceLocation &location, std::vector<char> &head, uint64_t &fileSize) {
+    head.resize(DDSHeadLength);
+    if (location.archive) {
+        try {
+            fileSize = location.archive->extracted_size(*location.entry);
+            head.resize(location.archive->extract_head(*location.entry, head.data(), head.size()));
+        } catch (const std::exception &e) {
+            std::wcout << "Failed to read BSA " << e.what() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::error_code ec;
+    fileSize = std::filesystem::file_size(location.file, ec);
+    std::ifstream in(location.file, std::ios::binary);
+    if (ec || !in) {
+        std::wcerr << L"Failed to read " << location.file << std::endl;
+        return false;
+    }
+    in.read(head.data(), static_cast<std::streamsize>(head.size()));
+    head.resize(static_cast<size_t>(in.gcount()));
+    return true;
+}
+
+// --plan: what the resizers would do to every texture, from the headers alone
+static bool planTextures(const std::vector<std::pair<std::string, SourceLocation>> &pendingTextures,
+                         const std::unordered_map<std::string, struct SizeData> &sizes,
+                         const std::filesystem::path &output) {
+    static Metrics::Stage &headerStage = Metrics::stage("plan.header");
+    TexturePlan plan;
+    std::vector<char> head;
+    for (const auto &texture : pendingTextures) {
+        const Trace::Span span("plan", texture.first);
+        Metrics::Timer timer(headerStage);
+
+        uint64_t fileSize = 0;
+        DirectX::TexMetadata info;
+        if (!readTextureHead(texture.second, head, fileSize) ||
+            FAILED(DirectX::GetMetadataFromDDSMemory(head.data(), head.size(), DirectX::DDS_FLAGS_NONE, info))) {
+            std::cerr << "Failed to read the header of " << texture.first << std::endl;
+            timer.fail();
+            continue;
+        }
+        timer.setBytesIn(head.size());
+
+        const SizeData &size = sizes.at(texture.first);
+        const size_t neededSize = targetTextureSize(texture.first, size.size, info.width);
+        const DirectX::TexMetadata target = TexturesOptimizer::planTarget(info, neededSize, neededSize);
+        plan.add(TexturePlan::Entry{texture.first, size.mesh, fileSize, info, target,
+                                    TexturePlan::estimateFileSize(target)});
+    }
+
+    const uint64_t current = plan.currentBytes();
+    const uint64_t target = plan.targetBytes();
+    std::cout << "Planned " << plan.size() << " textures, " << (current >> 20u) << " MB now, about "
+              << (target >> 20u) << " MB once processed" << std::endl;
+
+    std::error_code ec;
+    std::filesystem::create_directories(output, ec);
+    const auto csvPath = std::filesystem::path(output).append("SkyrimTexOptimizer.plan.csv.mohidden");
+    const auto jsonPath = std::filesystem::path(output).append("SkyrimTexOptimizer.plan.json.mohidden");
+    if (!plan.writeCsv(csvPath) || !plan.writeJson(jsonPath)) {
+        return false;
+    }
+    std::wcout << L"Wrote the plan to " << csvPath << L" and " << jsonPath << std::endl;
+    return true;
+}
+
+// --scoreboard: every encoder, format and quality on a sample of the textures, one texture at a time
+static bool scoreEncoders(const std::vector<std::pair<std::string, SourceLocation>> &pendingTextures,
+                          const std::unordered_map<std::string, struct SizeData> &sizes, size_t samples,
+                          const std::filesystem::path &output) {
+#ifdef _WIN32
+    // WIC (used by the resize filters) needs COM on this thread too
+    if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED))) {
+        std::cerr << "Failed to initialize COM, textures can't be scored" << std::endl;
+        return false;
+    }
+#endif
+
+    // Every backend that runs on this machine, the CPU one always does
+    std::vector<std::pair<std::unique_ptr<EncoderBackend>, std::unique_ptr<EncoderSession>>> encoders;
+    for (const auto type : {EncoderBackend::Type::CPU, EncoderBackend::Type::D3D11}) {
+        std::unique_ptr<EncoderBackend> backend = EncoderBackend::create(type, 0);
+        std::unique_ptr<EncoderSession> session = backend ? backend->createSession() : nullptr;
+        if (session) {
+            encoders.emplace_back(std::move(backend), std::move(session));
+        }
+    }
+
+    // Spread evenly over the load order, so every archive and the loose files get their share
+    std::vector<std::pair<std::string, SourceLocation>> sample;
+    const size_t count = std::min(samples, pendingTextures.size());
+    for (size_t i = 0; i < count; i++) {
+        sample.push_back(pendingTextures[i * pendingTextures.size() / count]);
+    }
+
+    EncoderScoreboard scoreboard;
+    size_t next = 0;
+    while (next < sample.size()) {
+        const size_t index = next;
+        std::vector<GameData> files;
+        if (!loadBatch(sample, next, 1, MemoryBudget::Phase::TextureSources, files)) {
+            return false;
+        }
+        if (files.empty() || !files[0].data) {
+            continue;
+        }
+        const std::unique_ptr<char, PayloadDeleter> data(files[0].data);
+        const MemoryBudget::Reservation source = MemoryBudget::global().adopt(MemoryBudget::Phase::TextureSources,
+                                                                              files[0].length);
+        const std::string &path = sample[index].first;
+        const Trace::Span span("score", path);
+
+        DirectX::ScratchImage reference;
+        if (!EncoderScoreboard::loadReference(path, files[0].data, files[0].length, sizes.at(path).size, reference)) {
+            std::cerr << "Failed to open " << path << std::endl;
+            continue;
+        }
+        for (const auto &encoder : encoders) {
+            scoreboard.score(path, *reference.GetImage(0, 0, 0), encoder.first->name(), *encoder.second);
+        }
+        std::cout << "Scored " << next << "/" << sample.size() << " " << path << std::endl;
+    }
+
+    scoreboard.printSummary();
+
+    std::error_code ec;
+    std::filesystem::create_directories(output, ec);
+    const auto csvPath = std::filesystem::path(output).append("SkyrimTexOptimizer.scoreboard.csv.mohidden");
+    const auto jsonPath = std::filesystem::path(output).append("SkyrimTexOptimizer.scoreboard.json.mohidden");
+    if (!scoreboard.writeCsv(csvPath) || !scoreboard.writeJson(jsonPath)) {
+        return false;
+    }
+    std::wcout << L"Wrote the scoreboard to " << csvPath << L" and " << jsonPath << std::endl;
+    return true;
+}
+
+// The run report, and the trace when it is recorded
+static void writeRunFiles(const std::filesystem::path &output) {
+    // Hidden from Mod Organizer like the .info files, so it doesn't end up in the game's data
+    std::error_code ec;
+    std::filesystem::create_directories(output, ec);
+    const auto reportPath = std::filesystem::path(output).append("SkyrimTexOptimizer.report.json.mohidden");
+    if (Metrics::writeReport(reportPath)) {
+        std::wcout << L"Wrote the run report to " << reportPath << std::endl;
+    }
+    if (Trace::enabled()) {
+        const auto tracePath = std::filesystem::path(output).append("SkyrimTexOptimizer.trace.json.mohidden");
+        if (Trace::write(tracePath)) {
+            std::wcout << L"Wrote the trace to " << tracePath << std::endl;
+        }
+    }
+}
+
+// Maps an archive and reads its records with the native reader, timed for the run report. Appended to archives
+static bool loadArchive(const std::filesystem::path &path, ArchiveList &archives) {
+    static Metrics::Stage &openStage = Metrics::stage("archive.open");
+    std::error_code ec;
+    Metrics::Timer timer(openStage, std::filesystem::file_size(path, ec));
+
+    try {
+        archives.push_back(std::make_unique<libbsarch::bs_archive_reader>(path));
+    } catch (const std::exception &e) {
+        std::wcout << "Failed to load BSA " << path.filename() << ": " << e.what() << std::endl;
+        timer.fail();
+        return false;
+    }
+    return true;
+}
+
 static std::vector<std::string> parseBSAList(const std::string &str) {
     std::vector<std::string> list;
 
@@ -60,8 +373,35 @@ static std::vector<std::string> parseBSAList(const std::string &str) {
 }
 
 int main(int argc, char **argv) {
+    // Flags can go anywhere, the positional arguments are read without them
+    bool planOnly = false;
+    size_t scoreboardSamples = 0;
+    std::vector<char *> args;
+    for (int i = 0; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--plan") {
+            planOnly = true;
+        } else if (arg == "--scoreboard") {
+            scoreboardSamples = 50;
+        } else if (arg.rfind("--scoreboard=", 0) == 0) {
+            const long long samples = atoll(arg.c_str() + strlen("--scoreboard="));
+            if (samples <= 0) {
+                std::cerr << "Invalid scoreboard sample " << arg << ", expected a number of textures" << std::endl;
+                return 1;
+            }
+            scoreboardSamples = static_cast<size_t>(samples);
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    argc = static_cast<int>(args.size());
+    argv = args.data();
+    // Neither writes textures, they only look at what a run would do
+    const bool analysisOnly = planOnly || scoreboardSamples > 0;
+
     if (argc < 5) {
-        std::cerr << "Usage: skyrimtexoptimizer <output> <texsize> <normalsize>" << std::endl;
+        std::cerr << "Usage: skyrimtexoptimizer <input> <output> <texsize> <normalsize> [auto|cpu|d3d11] [loose|bsa]"
+                     " [memory budget in MB] [--plan] [--scoreboard[=textures]]" << std::endl;
         return 1;
     }
     auto input = std::filesystem::absolute(argv[1]);
@@ -69,8 +409,48 @@ int main(int argc, char **argv) {
     uint32_t texsize = atoi(argv[3]);
     uint32_t normalsize = atoi(argv[4]);
 
+    EncoderBackend::Type encoderType = EncoderBackend::Type::Auto;
+    if (argc > 5 && !EncoderBackend::parseType(argv[5], encoderType)) {
+        std::cerr << "Unknown encoder " << argv[5] << ", expected auto, cpu or d3d11" << std::endl;
+        return 1;
+    }
+
+    bool packArchives = false;
+    if (argc > 6) {
+        const std::string mode = argv[6];
+        if (mode == "bsa") {
+            packArchives = true;
+        } else if (mode != "loose") {
+            std::cerr << "Unknown output mode " << mode << ", expected loose or bsa" << std::endl;
+            return 1;
+        }
+    }
+
+    if (argc > 7) {
+        const long long megabytes = atoll(argv[7]);
+        if (megabytes <= 0) {
+            std::cerr << "Invalid memory budget " << argv[7] << ", expected a number of MB" << std::endl;
+            return 1;
+        }
+        MemoryBudget::global().setLimit(static_cast<uint64_t>(megabytes) << 20u);
+    }
+
+    // Set STO_TRACE to record what every thread does, written next to the run report for Perfetto
+    if (std::getenv("STO_TRACE")) {
+        Trace::enable();
+        Trace::nameThread("dispatcher");
+    }
+
+    const std::unique_ptr<EncoderBackend> encoder = EncoderBackend::create(encoderType, 0);
+    if (!encoder) {
+        std::cerr << "The requested encoder is not available on this machine" << std::endl;
+        return 1;
+    }
+
     std::cout << "input: " << input << " output: " << output << " texsize: " << texsize << " normalsize: " << normalsize
-              << std::endl;
+              << " encoder: " << encoder->name() << " output mode: " << (packArchives ? "bsa" : "loose")
+              << " memory budget: " << (MemoryBudget::global().limit() >> 20u) << " MB"
+              << (planOnly ? " plan only" : "") << (scoreboardSamples > 0 ? " scoreboard" : "") << std::endl;
 
     auto running = new std::atomic<bool>(true);
 
@@ -148,7 +528,9 @@ int main(int argc, char **argv) {
     // lowercase path ex meshes\\path\\somemesh to the location
     //   because we iterate over the BSAs in order, then over the
     //   lose files it should be good
-    std::unordered_map<std::wstring, FileLocation> meshes;
+    // Nothing is read yet, meshes are extracted as the processors ask for more so the budget bounds what is held
+    std::unordered_map<std::wstring, SourceLocation> meshes;
+    ArchiveList meshArchives;
 
     // todo load BSAs on multiple threads, would save a lot of time given there's like 10 BSAs base alone
     for (std::filesystem::path &path : archives) {
@@ -163,11 +545,17 @@ int main(int argc, char **argv) {
 #define BUFFER_SIZE 1024 * 10
         char readBuf[BUFFER_SIZE];
 
-        if (in.is_open()) {
+        // The plan has to stay quick, and reading every archive through would take longer than the rest of it
+        if (!analysisOnly && in.is_open()) {
+            static Metrics::Stage &hashStage = Metrics::stage("archive.hash");
+            Metrics::Timer timer(hashStage);
+            uint64_t hashed = 0;
             long long read = 0;
             while ((read = in.readsome(readBuf, BUFFER_SIZE)) > 0) {
                 sha2.addData(readBuf, read);
+                hashed += read;
             }
+            timer.setBytesIn(hashed);
         }
 
         auto dataPath = std::filesystem::path(output).append(path.filename().string() + ".data.mohidden");
@@ -175,49 +563,21 @@ int main(int argc, char **argv) {
 
         }
 
-        bsa_result_message_t result = {0};
-        bsa_archive_t archive = bsa_create();
-
-        result = bsa_load_from_file(archive, path.wstring().c_str());
-        if (result.code < 0) {
-            std::wcout << "Failed to load BSA " << result.text << std::endl;
+        if (!loadArchive(path, meshArchives)) {
             return 1;
         }
+        const libbsarch::bs_archive_reader &archive = *meshArchives.back();
 
-        bsa_entry_list_t entries = bsa_entry_list_create();
-        bsa_get_resource_list(archive, entries, L"");
-
-        for (size_t index = 0; index < bsa_entry_list_count(entries); index++) {
-            wchar_t filename[2048];
-            bsa_entry_list_get(entries, index, 2048, filename);
-
-            auto internalPath = std::wstring(filename);
+        for (const ArchiveEntry &entry : archive.files()) {
+            // Names are stored in the game's 8 bit code page, widened byte by byte like the loose file names below
+            std::wstring internalPath;
+            for (const unsigned char c : archive.path_of(entry)) {
+                internalPath.push_back(static_cast<wchar_t>(::tolower(c)));
+            }
             if (isValidNIF(internalPath)) {
-                bsa_result_message_buffer_t buf = bsa_extract_file_data_by_filename(archive, filename);
-                result = buf.message;
-                if (result.code < 0) {
-                    std::wcout << "Failed to load BSA " << result.text << std::endl;
-                    return 1;
-                }
-                bsa_result_buffer_t resultBuf = buf.buffer;
-                auto copy = new char[buf.buffer.size];
-                memcpy_s(copy, buf.buffer.size, buf.buffer.data, buf.buffer.size);
-                bsa_file_data_free(archive, resultBuf);
-
-                bsa_result_buffer_t resultBuffer{
-                        buf.buffer.size,
-                        (bsa_buffer_t) copy
-                };
-
-                struct FileLocation loc{
-                        internalPath,
-                        resultBuffer
-                };
-                meshes.insert(std::make_pair(internalPath, loc));
+                meshes.insert(std::make_pair(internalPath, SourceLocation{&archive, &entry, {}}));
             }
         }
-        bsa_entry_list_free(entries);
-        bsa_close(archive);
     }
 
     // now load filesystem meshes
@@ -233,23 +593,9 @@ int main(int argc, char **argv) {
             transform(filepath.begin(), filepath.end(), filepath.begin(), ::tolower);
 
             if (isValidNIF(filepath)) {
-
-                std::ifstream in(path);
-                std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-                auto copy = new char[contents.size()];
-                memcpy_s(copy, contents.size(), contents.c_str(), contents.size());
-                bsa_result_buffer_t resultBuffer{
-                        static_cast<uint32_t>(contents.size()),
-                        (bsa_buffer_t) copy
-                };
-
                 auto internalPath = std::wstring(path.lexically_relative(dataDir));
                 std::transform(internalPath.begin(), internalPath.end(), internalPath.begin(), ::tolower);
-                struct FileLocation loc{
-                        internalPath,
-                        resultBuffer
-                };
-                meshes.insert(std::make_pair(internalPath, loc));
+                meshes.insert(std::make_pair(internalPath, SourceLocation{nullptr, nullptr, path}));
             }
         }
 
@@ -261,30 +607,45 @@ int main(int argc, char **argv) {
         }
     }
 
-    std::cout << "Loaded " << meshes.size() << " meshes" << std::endl;
+    std::cout << "Found " << meshes.size() << " meshes" << std::endl;
+
+    std::vector<std::pair<std::wstring, SourceLocation>> pendingMeshes(meshes.begin(), meshes.end());
+    meshes.clear();
+    sortByArchive(pendingMeshes, meshArchives);
 
     int millis = 0;
 
-    while (!meshes.empty()) {
+    size_t nextMesh = 0;
+    while (nextMesh < pendingMeshes.size()) {
         for (struct ThreadData &data : threadData) {
-            if (data.queue->empty()) {
-                // give it 25 items
-                for (int i = 0; i < 25 && !meshes.empty(); i++) {
-                    auto elem = meshes.begin();
-                    struct FileLocation loc = elem->second;
-                    meshes.erase(elem);
-                    data.queue->push(loc);
+            if (data.queue->empty() && nextMesh < pendingMeshes.size()) {
+                // give it 25 items, decompressed on the archive reader's worker threads
+                const size_t first = nextMesh;
+                std::vector<GameData> files;
+                if (!loadBatch(pendingMeshes, nextMesh, 25, MemoryBudget::Phase::Meshes, files)) {
+                    return 1;
+                }
+                for (size_t i = 0; i < files.size(); i++) {
+                    if (!files[i].data) {
+                        continue;
+                    }
+                    bsa_result_buffer_t resultBuffer{
+                            static_cast<uint32_t>(files[i].length),
+                            (bsa_buffer_t) files[i].data
+                    };
+                    data.queue->push(FileLocation{pendingMeshes[first + i].first, resultBuffer});
                 }
             }
         }
 
         if (++millis % 1000 == 0) {
-            std::cout << "Meshes left: " << meshes.size() << std::endl;
+            std::cout << "Meshes left: " << pendingMeshes.size() - nextMesh << std::endl;
         }
 
         using namespace std::chrono_literals;
         std::this_thread::sleep_for(1ms);
     }
+    meshArchives.clear();
 
     running->store(false);
     std::cout << "Waiting on thread.. " << std::endl;
@@ -312,70 +673,74 @@ int main(int argc, char **argv) {
     std::cout << "Texture Count: " << finalMap.size() << std::endl;
     std::cout << "Checking filesystem for textures.." << std::endl;
 
-    std::unordered_map<std::string, GameResource *> resources;
+    // Filesystem takes prio, archived textures are only added where there is no loose file
+    std::unordered_map<std::string, SourceLocation> textures;
 
     for (const auto &value : finalMap) {
         auto file = std::filesystem::current_path().append("data").append(value.first);
 
         if (std::filesystem::exists(file)) {
-            if (resources[value.first]) {
-                delete resources[value.first];
-            }
-            resources[value.first] = new FileSystemResource(file, value.second.size, value.second.mesh);
+            textures[value.first] = SourceLocation{nullptr, nullptr, file};
         }
     }
 
     std::wcout << "Loading BSAs again for textures" << std::endl;
+    // One index over every archive, later archives override earlier ones like the load order
+    ArchiveIndex index;
+    ArchiveList textureArchives;
     for (std::filesystem::path &path : archives) {
         if (!std::filesystem::exists(path)) {
             std::wcerr << L"Failed to find BSA " << path << std::endl;
             return 1;
         }
-        bsa_result_message_t result = {0};
-        bsa_archive_t archive = bsa_create();
-
-        result = bsa_load_from_file(archive, path.wstring().c_str());
-        if (result.code < 0) {
-            std::wcout << "Failed to load BSA " << result.text << std::endl;
+        if (!loadArchive(path, textureArchives)) {
             return 1;
         }
+        index.add(*textureArchives.back());
+    }
+    std::cout << "Indexed " << index.size() << " archived files" << std::endl;
 
-        for (const auto &value : finalMap) {
-            std::wstring wide = shortToWide(value.first);
-            bsa_file_record_t record = bsa_find_file_record(archive, wide.c_str());
-            if (record) {
-                auto existing = resources[value.first];
-                if (!existing || dynamic_cast<BSAResource *>(existing) != nullptr) {
-                    // only override if it's overriding a BSAResource, as filesystem takes prio
-                    if (existing) {
-                        delete resources[value.first];
-                    }
-//                    resources[value.first] = new BSAResource(wide, value.second, &archive);
-                    bsa_result_message_buffer_t buf = bsa_extract_file_data_by_record(archive, record);
-                    result = buf.message;
-                    if (result.code < 0) {
-                        std::wcout << "Failed to load BSA " << result.text << std::endl;
-                        return 1;
-                    }
-                    auto copy = new char[buf.buffer.size];
-                    memcpy_s(copy, buf.buffer.size, buf.buffer.data, buf.buffer.size);
-                    struct GameData data{
-                            copy,
-                            buf.buffer.size
-                    };
-                    bsa_file_data_free(archive, buf.buffer);
-                    resources[value.first] = new BSAResource(data, value.second.size, value.second.mesh);
-                }
-            }
+    for (const auto &value : finalMap) {
+        const ArchiveIndex::Location *location = index.find(value.first);
+        if (location) {
+            textures.insert(std::make_pair(value.first, SourceLocation{location->archive, location->entry, {}}));
         }
+    }
+
+    std::vector<std::pair<std::string, SourceLocation>> pendingTextures(textures.begin(), textures.end());
+    textures.clear();
+    sortByArchive(pendingTextures, textureArchives);
 
-        bsa_close(archive);
+    if (analysisOnly) {
+        bool succeeded = true;
+        if (planOnly) {
+            succeeded = planTextures(pendingTextures, finalMap, output);
+        }
+        if (scoreboardSamples > 0) {
+            succeeded = scoreEncoders(pendingTextures, finalMap, scoreboardSamples, output) && succeeded;
+        }
+        writeRunFiles(output);
+        return succeeded ? 0 : 1;
     }
 
     std::cout << "Done processing textures, starting resizing.." << std::endl;
 
     running->store(true);
 
+    std::unique_ptr<OutputSink> sink;
+    if (packArchives) {
+        std::error_code ec;
+        std::filesystem::create_directories(output, ec);
+        if (ec) {
+            std::cerr << "Error creating directories " << output << ": " << ec.message() << std::endl;
+            return 1;
+        }
+        sink = std::make_unique<ArchiveSink>(OptimizerSettings{output, input}, "SkyrimTexOptimizer");
+    } else {
+        // Two writers keep a disk busy, the budget bounds how far the resizers can run ahead of it
+        sink = std::make_unique<LooseFileSink>(output, 2, size_t(512) << 20u);
+    }
+
     std::vector<struct ResizeData> resizeData;
     for (int i = 0; i < 1; i++) {
         auto queue = new concurrency::concurrent_queue<struct TextureData>();
@@ -383,36 +748,49 @@ int main(int argc, char **argv) {
         struct ResizeData data{
                 queue,
                 output,
-                running
+                running,
+                encoder.get(),
+                sink.get()
         };
         resizeData.emplace_back(data);
 
         threads.emplace_back(std::thread(resizer, data));
     }
 
-    while (!resources.empty()) {
+    size_t nextTexture = 0;
+    while (nextTexture < pendingTextures.size()) {
         for (auto &thread : resizeData) {
-            if (thread.queue->empty()) {
-                // give it a few items
-                for (int i = 0; i < 2 && !resources.empty(); i++) {
-                    auto elem = resources.begin();
+            if (thread.queue->empty() && nextTexture < pendingTextures.size()) {
+                // give it a few items, loose ones are read here too so the budget admits them like archived ones
+                const size_t first = nextTexture;
+                std::vector<GameData> files;
+                if (!loadBatch(pendingTextures, nextTexture, 2, MemoryBudget::Phase::TextureSources, files)) {
+                    return 1;
+                }
+                for (size_t i = 0; i < files.size(); i++) {
+                    if (!files[i].data) {
+                        continue;
+                    }
+                    const std::string &path = pendingTextures[first + i].first;
+                    const SizeData &size = finalMap[path];
                     struct TextureData data{
-                            elem->first,
-                            elem->second,
+                            path,
+                            new BSAResource(files[i], size.size, size.mesh),
+                            files[i].length
                     };
-                    resources.erase(elem);
                     thread.queue->push(data);
                 }
             }
         }
 
         if (++millis % 1000 == 0) {
-            std::cout << "Textures left: " << resources.size() << std::endl;
+            std::cout << "Textures left: " << pendingTextures.size() - nextTexture << std::endl;
         }
 
         using namespace std::chrono_literals;
         std::this_thread::sleep_for(1ms);
     }
+    textureArchives.clear();
 
     running->store(false);
     std::cout << "Waiting on thread.. " << std::endl;
@@ -422,6 +800,31 @@ int main(int argc, char **argv) {
         }
     }
 
+    std::cout << "Waiting on writes.. " << std::endl;
+    const bool written = sink->flush();
+    if (auto loose = dynamic_cast<LooseFileSink *>(sink.get())) {
+        const auto sinkStats = loose->getStats();
+        std::cout << "Wrote " << sinkStats.files << " textures (" << (sinkStats.bytes >> 20u) << " MB), created "
+                  << sinkStats.directoriesCreated << " directories, resizers waited on the disk " << sinkStats.stalls
+                  << " times" << std::endl;
+    } else if (auto archives = dynamic_cast<ArchiveSink *>(sink.get())) {
+        const auto sinkStats = archives->getStats();
+        std::cout << "Packed " << sinkStats.files << " textures (" << (sinkStats.bytes >> 20u) << " MB) into "
+                  << sinkStats.archives << " archives, resizers waited on the disk " << sinkStats.stalls << " times"
+                  << std::endl;
+    }
+
+    const auto budgetStats = MemoryBudget::global().getStats();
+    std::cout << "Memory budget " << (budgetStats.limit >> 20u) << " MB, peak reserved " << (budgetStats.peak >> 20u)
+              << " MB, work waited for memory " << budgetStats.waits << " times" << std::endl;
+
+    writeRunFiles(output);
+
+    if (!written) {
+        std::cerr << "Some textures failed to save" << std::endl;
+        return 1;
+    }
+
     std::cout << "Finished" << std::endl;
 
     return 0;
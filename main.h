@@ -2,6 +2,7 @@
 #define STO_MAIN_H
 
 #include <bs_archive.h>
+#include "payload_pool.h"
 #include <string>
 #include <utility>
 #include <fstream>
@@ -35,6 +36,8 @@ public:
         this->mesh = std::move(mesh);
     }
 
+    virtual ~GameResource() = default;
+
 public:
     float size;
     std::wstring mesh;
@@ -80,7 +83,8 @@ public:
     }
 
     void freeData(GameData *data) override {
-        delete data->data;
+        PayloadPool::global().free(data->data);
+        data->data = nullptr;
 //        delete data;
     }
 };
@@ -0,0 +1,161 @@
+#include "memory_budget.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+# define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+MemoryBudget::Reservation::Reservation(Reservation &&other) noexcept
+        : _budget(other._budget), _phase(other._phase), _bytes(other._bytes) {
+    other._budget = nullptr;
+    other._bytes = 0;
+}
+
+MemoryBudget::Reservation &MemoryBudget::Reservation::operator=(Reservation &&other) noexcept {
+    if (this != &other) {
+        release();
+        _budget = other._budget;
+        _phase = other._phase;
+        _bytes = other._bytes;
+        other._budget = nullptr;
+        other._bytes = 0;
+    }
+    return *this;
+}
+
+MemoryBudget::Reservation::~Reservation() {
+    release();
+}
+
+void MemoryBudget::Reservation::release() {
+    if (_budget) {
+        _budget->release(_phase, _bytes);
+        _budget = nullptr;
+        _bytes = 0;
+    }
+}
+
+MemoryBudget::MemoryBudget(uint64_t limit) : _limit(limit), _total(Metrics::gauge("memory.total")) {
+    for (size_t i = 0; i < PhaseCount; i++) {
+        const std::string name = phaseName(static_cast<Phase>(i));
+        _phaseGauges[i] = &Metrics::gauge("memory." + name);
+        _waitStages[i] = &Metrics::stage("memory.wait." + name);
+    }
+}
+
+MemoryBudget &MemoryBudget::global() {
+    static MemoryBudget instance(defaultLimit());
+    return instance;
+}
+
+uint64_t MemoryBudget::defaultLimit() {
+    uint64_t physical = 0;
+#ifdef _WIN32
+    MEMORYSTATUSEX status{};
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status)) {
+        physical = status.ullTotalPhys;
+    }
+#else
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long pageSize = sysconf(_SC_PAGE_SIZE);
+    if (pages > 0 && pageSize > 0) {
+        physical = static_cast<uint64_t>(pages) * static_cast<uint64_t>(pageSize);
+    }
+#endif
+    if (physical == 0) {
+        physical = uint64_t(8) << 30u;
+    }
+    return physical / 2;
+}
+
+const char *MemoryBudget::phaseName(Phase phase) {
+    switch (phase) {
+        case Phase::Meshes: return "meshes";
+        case Phase::TextureSources: return "texture.sources";
+        case Phase::TextureWork: return "texture.work";
+        case Phase::Output: return "output";
+        default: return "unknown";
+    }
+}
+
+void MemoryBudget::setLimit(uint64_t limit) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _limit = limit;
+    }
+    _released.notify_all();
+}
+
+uint64_t MemoryBudget::limit() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _limit;
+}
+
+void MemoryBudget::acquire(Phase phase, uint64_t bytes) {
+    const auto index = static_cast<size_t>(phase);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    const auto admitted = [&] { return _phaseReserved[index] == 0 || _reserved + bytes <= _limit; };
+    if (!admitted()) {
+        _waits++;
+        Metrics::Timer timer(*_waitStages[index], bytes);
+        _released.wait(lock, admitted);
+    }
+    _reserved += bytes;
+    _phaseReserved[index] += bytes;
+    _peak = std::max(_peak, _reserved);
+    lock.unlock();
+
+    _total.add(bytes);
+    _phaseGauges[index]->add(bytes);
+}
+
+void MemoryBudget::charge(Phase phase, uint64_t bytes) {
+    const auto index = static_cast<size_t>(phase);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _reserved += bytes;
+        _phaseReserved[index] += bytes;
+        _peak = std::max(_peak, _reserved);
+    }
+    _total.add(bytes);
+    _phaseGauges[index]->add(bytes);
+}
+
+void MemoryBudget::release(Phase phase, uint64_t bytes) {
+    if (bytes == 0) {
+        return;
+    }
+    const auto index = static_cast<size_t>(phase);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        bytes = std::min(bytes, _phaseReserved[index]);
+        _reserved -= bytes;
+        _phaseReserved[index] -= bytes;
+    }
+    _released.notify_all();
+
+    _total.subtract(bytes);
+    _phaseGauges[index]->subtract(bytes);
+}
+
+MemoryBudget::Reservation MemoryBudget::reserve(Phase phase, uint64_t bytes) {
+    acquire(phase, bytes);
+    return Reservation(this, phase, bytes);
+}
+
+MemoryBudget::Reservation MemoryBudget::adopt(Phase phase, uint64_t bytes) {
+    return Reservation(this, phase, bytes);
+}
+
+MemoryBudget::Stats MemoryBudget::getStats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return Stats{_limit, _reserved, _peak, _waits};
+}
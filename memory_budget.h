@@ -0,0 +1,119 @@
+#ifndef STO_MEMORY_BUDGET_H
+#define STO_MEMORY_BUDGET_H
+
+#include "metrics.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/*!
+ * \brief Process wide limit on the bytes held by work in flight. Every phase reserves an estimate of what an item
+ * will need before starting it and gives it back when the item is done, so a long list of meshes or textures
+ * can't outgrow the machine. Each phase is always allowed one item, even one over the limit, which keeps every
+ * phase moving: the bytes it waits for are held by other phases or by its own earlier items, and both finish
+ * without needing more.
+ */
+class MemoryBudget {
+public:
+    enum class Phase {
+        Meshes, // extracted NIFs, queued for or being parsed by a processor
+        TextureSources, // extracted DDS files, queued for or held by a resizer
+        TextureWork, // images decoded, resized, mipmapped and encoded by a resizer
+        Output, // encoded textures waiting for the output sink, counted but never waited for
+        Count
+    };
+
+    /*!
+     * \brief Bytes reserved for a scope, given back when it ends
+     */
+    class Reservation {
+    public:
+        Reservation() = default;
+        Reservation(Reservation &&other) noexcept;
+        Reservation &operator=(Reservation &&other) noexcept;
+        ~Reservation();
+
+        Reservation(const Reservation &) = delete;
+        Reservation &operator=(const Reservation &) = delete;
+
+        //! \brief Give the bytes back now
+        void release();
+
+        [[nodiscard]] uint64_t bytes() const {
+            return _bytes;
+        }
+
+    private:
+        friend class MemoryBudget;
+
+        Reservation(MemoryBudget *budget, Phase phase, uint64_t bytes)
+                : _budget(budget), _phase(phase), _bytes(bytes) {}
+
+        MemoryBudget *_budget = nullptr;
+        Phase _phase = Phase::Meshes;
+        uint64_t _bytes = 0;
+    };
+
+    explicit MemoryBudget(uint64_t limit);
+
+    MemoryBudget(const MemoryBudget &) = delete;
+    MemoryBudget &operator=(const MemoryBudget &) = delete;
+
+    /*!
+     * \brief The budget shared by every phase, limited to defaultLimit() until setLimit is called
+     */
+    static MemoryBudget &global();
+
+    //! \brief Half the physical memory, the rest is left to the OS, the DLLs and what the estimates miss
+    static uint64_t defaultLimit();
+
+    static const char *phaseName(Phase phase);
+
+    void setLimit(uint64_t limit);
+
+    [[nodiscard]] uint64_t limit() const;
+
+    /*!
+     * \brief Reserve bytes for an item, blocking until they fit in the limit or the phase holds nothing else
+     */
+    void acquire(Phase phase, uint64_t bytes);
+
+    //! \brief Count bytes against the budget without waiting, for memory that is already allocated
+    void charge(Phase phase, uint64_t bytes);
+
+    void release(Phase phase, uint64_t bytes);
+
+    //! \brief acquire, released when the reservation goes out of scope
+    [[nodiscard]] Reservation reserve(Phase phase, uint64_t bytes);
+
+    //! \brief Take over bytes acquired elsewhere, for items handed from one thread to another
+    [[nodiscard]] Reservation adopt(Phase phase, uint64_t bytes);
+
+    struct Stats {
+        uint64_t limit;
+        uint64_t reserved;
+        uint64_t peak;
+        uint64_t waits; // acquires that had to wait for another item to finish
+    };
+
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    static constexpr size_t PhaseCount = static_cast<size_t>(Phase::Count);
+
+    mutable std::mutex _mutex;
+    std::condition_variable _released;
+    uint64_t _limit;
+    uint64_t _reserved = 0;
+    uint64_t _peak = 0;
+    uint64_t _waits = 0;
+    std::array<uint64_t, PhaseCount> _phaseReserved{};
+
+    Metrics::Gauge &_total;
+    std::array<Metrics::Gauge *, PhaseCount> _phaseGauges{};
+    std::array<Metrics::Stage *, PhaseCount> _waitStages{};
+};
+
+#endif //STO_MEMORY_BUDGET_H
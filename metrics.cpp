@@ -0,0 +1,207 @@
+#include "metrics.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+# define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <ctime>
+#endif
+
+namespace {
+    std::mutex stagesMutex;
+    // Ordered, so the report lists related stages ("encode.*", "nif.*") next to each other
+    std::map<std::string, std::unique_ptr<Metrics::Stage>> stages;
+    std::map<std::string, std::unique_ptr<Metrics::Gauge>> gauges;
+
+    const auto processStart = std::chrono::steady_clock::now();
+
+    void storeMax(std::atomic<uint64_t> &target, uint64_t value) {
+        uint64_t current = target.load(std::memory_order_relaxed);
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    double toMillis(uint64_t nanos) {
+        return static_cast<double>(nanos) / 1e6;
+    }
+}
+
+void Metrics::Stage::record(uint64_t wallNanos, uint64_t cpuNanos, uint64_t bytesIn, uint64_t bytesOut,
+                            uint64_t items, bool failed) {
+    _runs.fetch_add(1, std::memory_order_relaxed);
+    if (failed) {
+        _failures.fetch_add(1, std::memory_order_relaxed);
+    }
+    _items.fetch_add(items, std::memory_order_relaxed);
+    _bytesIn.fetch_add(bytesIn, std::memory_order_relaxed);
+    _bytesOut.fetch_add(bytesOut, std::memory_order_relaxed);
+    _wallNanos.fetch_add(wallNanos, std::memory_order_relaxed);
+    _cpuNanos.fetch_add(cpuNanos, std::memory_order_relaxed);
+    storeMax(_maxNanos, wallNanos);
+    _latency[bucketOf(wallNanos)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::Stage::count(uint64_t items, uint64_t bytes) {
+    _items.fetch_add(items, std::memory_order_relaxed);
+    _bytesIn.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Metrics::Gauge::add(uint64_t amount) {
+    storeMax(_peak, _value.fetch_add(amount, std::memory_order_relaxed) + amount);
+}
+
+void Metrics::Gauge::subtract(uint64_t amount) {
+    _value.fetch_sub(amount, std::memory_order_relaxed);
+}
+
+size_t Metrics::Stage::bucketOf(uint64_t nanos) {
+    if (nanos < SubBuckets) {
+        return static_cast<size_t>(nanos);
+    }
+    size_t exponent = 3;
+    while ((nanos >> (exponent + 1)) != 0) {
+        exponent++;
+    }
+    const size_t sub = static_cast<size_t>(nanos >> (exponent - 3)) & (SubBuckets - 1);
+    return (exponent - 2) * SubBuckets + sub;
+}
+
+uint64_t Metrics::Stage::bucketValue(size_t bucket) {
+    if (bucket < SubBuckets) {
+        return bucket;
+    }
+    const size_t exponent = bucket / SubBuckets + 2;
+    const uint64_t width = uint64_t(1) << (exponent - 3);
+    return (SubBuckets + bucket % SubBuckets) * width + width / 2;
+}
+
+uint64_t Metrics::Stage::percentile(double fraction) const {
+    const uint64_t runs = _runs.load(std::memory_order_relaxed);
+    if (runs == 0) {
+        return 0;
+    }
+    const auto wanted = static_cast<uint64_t>(fraction * static_cast<double>(runs - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BucketCount; i++) {
+        seen += _latency[i].load(std::memory_order_relaxed);
+        if (seen >= wanted) {
+            // The bucket midpoint can overshoot the slowest run of a sparse stage
+            return std::min(bucketValue(i), _maxNanos.load(std::memory_order_relaxed));
+        }
+    }
+    return _maxNanos.load(std::memory_order_relaxed);
+}
+
+Metrics::Timer::Timer(Metrics::Stage &stage, uint64_t bytesIn)
+        : _stage(stage), _start(std::chrono::steady_clock::now()), _cpuStart(threadCpuNanos()), _bytesIn(bytesIn) {}
+
+Metrics::Timer::~Timer() {
+    const auto end = std::chrono::steady_clock::now();
+    const auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>(end - _start);
+    const uint64_t cpuEnd = threadCpuNanos();
+    _stage.record(static_cast<uint64_t>(wall.count()), cpuEnd > _cpuStart ? cpuEnd - _cpuStart : 0, _bytesIn,
+                  _bytesOut, _items, _failed);
+    // Stage names live until exit, so the trace can point at them
+    Trace::record(_stage.name().c_str(), _start, end);
+}
+
+Metrics::Stage &Metrics::stage(const std::string &name) {
+    std::lock_guard<std::mutex> lock(stagesMutex);
+    auto &stage = stages[name];
+    if (!stage) {
+        stage = std::make_unique<Stage>(name);
+    }
+    return *stage;
+}
+
+Metrics::Gauge &Metrics::gauge(const std::string &name) {
+    std::lock_guard<std::mutex> lock(stagesMutex);
+    auto &gauge = gauges[name];
+    if (!gauge) {
+        gauge = std::make_unique<Gauge>(name);
+    }
+    return *gauge;
+}
+
+uint64_t Metrics::threadCpuNanos() {
+#ifdef _WIN32
+    // Kernel and user time in 100ns units, updated on every scheduler tick
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    const auto toTicks = [](const FILETIME &time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32u) | time.dwLowDateTime;
+    };
+    return (toTicks(kernel) + toTicks(user)) * 100;
+#else
+    timespec time{};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(time.tv_sec) * 1000000000u + static_cast<uint64_t>(time.tv_nsec);
+#endif
+}
+
+bool Metrics::writeReport(const std::filesystem::path &path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to write the run report to " << path << std::endl;
+        return false;
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - processStart;
+    out << "{\n  \"wallMs\": " << toMillis(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())
+        << ",\n  \"stages\": [";
+
+    std::lock_guard<std::mutex> lock(stagesMutex);
+    bool first = true;
+    for (const auto &entry : stages) {
+        const Stage &stage = *entry.second;
+        const uint64_t runs = stage._runs.load();
+        out << (first ? "\n" : ",\n") << "    {\"name\": \"" << stage._name << "\""
+            << ", \"items\": " << stage._items.load()
+            << ", \"runs\": " << runs
+            << ", \"failures\": " << stage._failures.load()
+            << ", \"bytesIn\": " << stage._bytesIn.load()
+            << ", \"bytesOut\": " << stage._bytesOut.load()
+            << ", \"wallMs\": " << toMillis(stage._wallNanos.load())
+            << ", \"cpuMs\": " << toMillis(stage._cpuNanos.load());
+        if (runs > 0) {
+            out << ", \"latencyMs\": {\"p50\": " << toMillis(stage.percentile(0.50))
+                << ", \"p90\": " << toMillis(stage.percentile(0.90))
+                << ", \"p99\": " << toMillis(stage.percentile(0.99))
+                << ", \"max\": " << toMillis(stage._maxNanos.load()) << "}";
+        }
+        out << "}";
+        first = false;
+    }
+    out << "\n  ],\n  \"gauges\": [";
+
+    first = true;
+    for (const auto &entry : gauges) {
+        const Gauge &gauge = *entry.second;
+        out << (first ? "\n" : ",\n") << "    {\"name\": \"" << gauge.name() << "\""
+            << ", \"value\": " << gauge.value()
+            << ", \"peak\": " << gauge.peak() << "}";
+        first = false;
+    }
+    out << "\n  ]\n}\n";
+
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write the run report to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,155 @@
+#ifndef STO_METRICS_H
+#define STO_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+/*!
+ * \brief Run wide timers and counters for each pipeline stage, such as "nif.parse" or "encode.BC7_UNORM".
+ * Stages are created on first use and live until the process exits. Everything is recorded with atomics,
+ * so any thread can feed the same stage and the totals are already aggregated when the report is written.
+ */
+class Metrics {
+public:
+    class Stage {
+    public:
+        explicit Stage(std::string name) : _name(std::move(name)) {}
+
+        Stage(const Stage &) = delete;
+        Stage &operator=(const Stage &) = delete;
+
+        /*!
+         * \brief Account for one timed run of the stage
+         * \param items Files, shapes or records handled by the run
+         * \param failed The run returned an error, it still counts towards the time
+         */
+        void record(uint64_t wallNanos, uint64_t cpuNanos, uint64_t bytesIn, uint64_t bytesOut, uint64_t items,
+                    bool failed);
+
+        //! \brief Account for items without a timing, for hits, misses and other plain counters
+        void count(uint64_t items = 1, uint64_t bytes = 0);
+
+        [[nodiscard]] const std::string &name() const {
+            return _name;
+        }
+
+    private:
+        friend class Metrics;
+
+        // Log-linear latency buckets, 8 per power of two, so percentiles are within about 6%
+        static constexpr size_t SubBuckets = 8;
+        static constexpr size_t BucketCount = (64 - 2) * SubBuckets;
+
+        static size_t bucketOf(uint64_t nanos);
+        static uint64_t bucketValue(size_t bucket);
+        [[nodiscard]] uint64_t percentile(double fraction) const;
+
+        std::string _name;
+        std::atomic<uint64_t> _runs{0};
+        std::atomic<uint64_t> _failures{0};
+        std::atomic<uint64_t> _items{0};
+        std::atomic<uint64_t> _bytesIn{0};
+        std::atomic<uint64_t> _bytesOut{0};
+        std::atomic<uint64_t> _wallNanos{0};
+        std::atomic<uint64_t> _cpuNanos{0};
+        std::atomic<uint64_t> _maxNanos{0};
+        std::array<std::atomic<uint64_t>, BucketCount> _latency{};
+    };
+
+    /*!
+     * \brief A level that goes up and down, such as bytes held in memory, with the highest value it reached
+     */
+    class Gauge {
+    public:
+        explicit Gauge(std::string name) : _name(std::move(name)) {}
+
+        Gauge(const Gauge &) = delete;
+        Gauge &operator=(const Gauge &) = delete;
+
+        void add(uint64_t amount);
+        void subtract(uint64_t amount);
+
+        [[nodiscard]] uint64_t value() const {
+            return _value.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] uint64_t peak() const {
+            return _peak.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] const std::string &name() const {
+            return _name;
+        }
+
+    private:
+        std::string _name;
+        std::atomic<uint64_t> _value{0};
+        std::atomic<uint64_t> _peak{0};
+    };
+
+    /*!
+     * \brief Times a scope into a stage: wall clock and the calling thread's CPU time. Work the stage hands to other
+     * threads, like DirectXTex's OpenMP loops, shows up as wall time only. The scope is also a span in the Trace
+     * when tracing is enabled.
+     */
+    class Timer {
+    public:
+        explicit Timer(Stage &stage, uint64_t bytesIn = 0);
+        ~Timer();
+
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+
+        void setBytesIn(uint64_t bytes) {
+            _bytesIn = bytes;
+        }
+
+        void setBytesOut(uint64_t bytes) {
+            _bytesOut = bytes;
+        }
+
+        void setItems(uint64_t items) {
+            _items = items;
+        }
+
+        //! \brief Mark the run as failed, it is recorded when the timer goes out of scope
+        void fail() {
+            _failed = true;
+        }
+
+    private:
+        Stage &_stage;
+        std::chrono::steady_clock::time_point _start;
+        uint64_t _cpuStart;
+        uint64_t _bytesIn;
+        uint64_t _bytesOut = 0;
+        uint64_t _items = 1;
+        bool _failed = false;
+    };
+
+    /*!
+     * \brief The stage called name, created on first use. Cache the reference in hot paths, lookups take a lock
+     */
+    static Stage &stage(const std::string &name);
+
+    /*!
+     * \brief The gauge called name, created on first use. Cache the reference like stages
+     */
+    static Gauge &gauge(const std::string &name);
+
+    /*!
+     * \brief Write every stage as JSON: counts, bytes, wall and CPU milliseconds and latency percentiles, then every
+     * gauge with its current and peak value
+     * \return False if the file can't be written
+     */
+    static bool writeReport(const std::filesystem::path &path);
+
+    //! \brief CPU time used so far by the calling thread, 0 if the platform can't tell
+    static uint64_t threadCpuNanos();
+};
+
+#endif //STO_METRICS_H
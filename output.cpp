@@ -0,0 +1,358 @@
+#include "output.h"
+#include "metrics.h"
+#include "memory_budget.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+namespace {
+    const char *ArchiveSuffix = " - Textures.bsa";
+
+    // Little endian, like every field of a plugin
+    void put(std::string &out, uint64_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; i++) {
+            out.push_back(static_cast<char>((value >> (i * 8u)) & 0xFFu));
+        }
+    }
+
+    /*!
+     * \brief Write a plugin with no records, only the TES4 header flagged as light (ESL)
+     * \return False if the file can't be written
+     */
+    bool writeLightPlugin(const std::filesystem::path &path, const std::string &author) {
+        const float version = 1.7f;
+        uint32_t versionBits;
+        std::memcpy(&versionBits, &version, sizeof(versionBits));
+
+        std::string fields;
+        // HEDR: plugin version, record count, next free object id
+        fields.append("HEDR");
+        put(fields, 12, 2);
+        put(fields, versionBits, 4);
+        put(fields, 0, 4);
+        put(fields, 0x800, 4);
+        // CNAM: author, zero terminated
+        fields.append("CNAM");
+        put(fields, author.size() + 1, 2);
+        fields.append(author);
+        fields.push_back('\0');
+
+        std::string record("TES4");
+        put(record, fields.size(), 4);
+        put(record, 0x200, 4); // light plugin flag
+        put(record, 0, 4); // form id
+        put(record, 0, 4); // version control
+        put(record, 44, 2); // Skyrim Special Edition form version
+        put(record, 0, 2);
+        record.append(fields);
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(record.data(), static_cast<std::streamsize>(record.size()));
+        out.close();
+        return static_cast<bool>(out);
+    }
+}
+
+LooseFileSink::LooseFileSink(std::filesystem::path root, size_t threads, size_t maxQueuedBytes)
+        : _root(std::move(root)), _maxQueuedBytes(maxQueuedBytes) {
+    threads = std::max<size_t>(threads, 1);
+    _threads.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+        _threads.emplace_back(&LooseFileSink::run, this);
+    }
+}
+
+LooseFileSink::~LooseFileSink() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _hasWork.notify_all();
+    for (auto &thread : _threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+bool LooseFileSink::submit(const std::string &path, DirectX::Blob dds, std::string info) {
+    const size_t size = dds.GetBufferSize() + info.size();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    // Always let one job through, even if it alone is bigger than the budget
+    if (_queuedBytes > 0 && _queuedBytes + size > _maxQueuedBytes) {
+        _stalls++;
+        _hasRoom.wait(lock, [&] { return _stopping || _queuedBytes == 0 || _queuedBytes + size <= _maxQueuedBytes; });
+    }
+    if (_stopping) {
+        return false;
+    }
+
+    // Bounded by maxQueuedBytes already, only counted so the budget sees everything that is held
+    MemoryBudget::global().charge(MemoryBudget::Phase::Output, size);
+    _jobs.push_back(Job{std::filesystem::path(_root).append(path), std::move(dds), std::move(info)});
+    _queuedBytes += size;
+    lock.unlock();
+
+    _hasWork.notify_one();
+    return true;
+}
+
+bool LooseFileSink::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [&] { return _jobs.empty() && _inFlight == 0; });
+    return !_failed;
+}
+
+LooseFileSink::Stats LooseFileSink::getStats() const {
+    return Stats{_files.load(), _bytes.load(), _directoriesCreated.load(), _stalls.load()};
+}
+
+void LooseFileSink::run() {
+    Trace::nameThread("writer");
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _hasWork.wait(lock, [&] { return _stopping || !_jobs.empty(); });
+        if (_jobs.empty()) {
+            return; // stopping
+        }
+
+        Job job = std::move(_jobs.front());
+        _jobs.pop_front();
+        _inFlight++;
+        lock.unlock();
+
+        bool written;
+        {
+            static Metrics::Stage &writeStage = Metrics::stage("write.loose");
+            Metrics::Timer timer(writeStage, job.dds.GetBufferSize());
+            written = write(job);
+            if (written) {
+                timer.setBytesOut(job.dds.GetBufferSize() + job.info.size());
+            } else {
+                timer.fail();
+            }
+        }
+        const size_t size = job.dds.GetBufferSize() + job.info.size();
+        job.dds.Release();
+        MemoryBudget::global().release(MemoryBudget::Phase::Output, size);
+
+        lock.lock();
+        _inFlight--;
+        _queuedBytes -= size;
+        if (!written) {
+            _failed = true;
+        }
+        _hasRoom.notify_all();
+        if (_jobs.empty() && _inFlight == 0) {
+            _idle.notify_all();
+        }
+    }
+}
+
+bool LooseFileSink::write(const Job &job) {
+    if (!ensureDirectory(job.path.parent_path())) {
+        return false;
+    }
+
+    if (!writeFile(job.path, job.dds.GetBufferPointer(), job.dds.GetBufferSize())) {
+        std::cerr << "Failed to save " << job.path << std::endl;
+        return false;
+    }
+    _files++;
+    _bytes += job.dds.GetBufferSize();
+
+    // The info file marks the texture as done, so it only goes out once the texture is in place
+    if (!job.info.empty()) {
+        const auto infoFile = std::filesystem::path(job.path).concat(".info.mohidden");
+        if (!writeFile(infoFile, job.info.data(), job.info.size())) {
+            std::cerr << "Failed to save " << infoFile << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LooseFileSink::ensureDirectory(const std::filesystem::path &directory) {
+    {
+        std::lock_guard<std::mutex> lock(_directoriesMutex);
+        if (_directories.count(directory.native()) != 0) {
+            return true;
+        }
+    }
+
+    // Two threads may race to create the same directory, create_directories is fine with that
+    std::error_code ec;
+    if (std::filesystem::create_directories(directory, ec)) {
+        _directoriesCreated++;
+    }
+    if (ec) {
+        std::cerr << "Error creating directories " << directory << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_directoriesMutex);
+    for (auto parent = directory; !parent.empty() && parent != _root; parent = parent.parent_path()) {
+        if (!_directories.insert(parent.native()).second) {
+            break;
+        }
+        if (parent == parent.parent_path()) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool LooseFileSink::writeFile(const std::filesystem::path &path, const void *data, size_t size) {
+    const auto temporary = std::filesystem::path(path).concat(".tmp");
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+        out.close();
+        if (!out) {
+            std::error_code ignored;
+            std::filesystem::remove(temporary, ignored);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        return false;
+    }
+    return true;
+}
+
+ArchiveSink::ArchiveSink(struct OptimizerSettings settings, std::string name, size_t maxArchiveSize)
+        : _settings(std::move(settings)), _name(std::move(name)), _maxArchiveSize(maxArchiveSize) {
+    _thread = std::thread(&ArchiveSink::run, this);
+}
+
+ArchiveSink::~ArchiveSink() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _hasWork.notify_all();
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+std::unique_ptr<MeshBSA> ArchiveSink::nextArchive() {
+    const uint64_t index = _stats.archives++;
+    std::string filename = _name + (index == 0 ? "" : std::to_string(index + 1)) + ArchiveSuffix;
+    return std::make_unique<MeshBSA>(std::filesystem::path(_settings.outputDirectory).append(filename), _settings);
+}
+
+std::filesystem::path ArchiveSink::pluginFor(const MeshBSA &archive) const {
+    std::string filename = archive.path().filename().string();
+    filename.resize(filename.size() - strlen(ArchiveSuffix));
+    return std::filesystem::path(archive.path()).replace_filename(filename + ".esl");
+}
+
+bool ArchiveSink::submit(const std::string &path, DirectX::Blob dds, std::string info) {
+    (void) info;
+    const size_t size = MeshBSA::entrySize(path, dds.GetBufferSize());
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        if (_stopping) {
+            return false;
+        }
+        if (!_current) {
+            _current = nextArchive();
+        }
+        // An empty archive takes anything, a texture too big to ever fit still gets an archive of its own
+        if (_current->count() == 0 || _current->size() + size <= _maxArchiveSize) {
+            break;
+        }
+        if (!_sealed) {
+            _sealed = std::move(_current);
+            _sealedBytes = std::exchange(_currentBytes, 0);
+            _hasWork.notify_one();
+            continue;
+        }
+        // Both the current archive and the one being written are full, wait for the disk
+        _stats.stalls++;
+        _hasRoom.wait(lock);
+    }
+
+    const size_t held = dds.GetBufferSize();
+    _current->add(path, std::move(dds));
+    _currentBytes += held;
+    MemoryBudget::global().charge(MemoryBudget::Phase::Output, held);
+    _stats.files++;
+    _stats.bytes += size;
+    return true;
+}
+
+bool ArchiveSink::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        if (_sealed) {
+            _hasRoom.wait(lock);
+        } else if (_current && _current->count() > 0) {
+            _sealed = std::move(_current);
+            _sealedBytes = std::exchange(_currentBytes, 0);
+            _hasWork.notify_one();
+        } else {
+            return !_failed;
+        }
+    }
+}
+
+ArchiveSink::Stats ArchiveSink::getStats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+void ArchiveSink::run() {
+    Trace::nameThread("archive writer");
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _hasWork.wait(lock, [&] { return _stopping || _sealed; });
+        if (!_sealed) {
+            return; // stopping
+        }
+
+        // _sealed stays set while saving, so at most two archives are held in memory
+        MeshBSA *archive = _sealed.get();
+        const size_t held = _sealedBytes;
+        lock.unlock();
+
+        std::wcout << L"Writing " << archive->path().filename() << L" (" << archive->count() << L" textures, "
+                   << (archive->size() >> 20u) << L" MB)" << std::endl;
+        bool saved;
+        {
+            static Metrics::Stage &writeStage = Metrics::stage("write.archive");
+            Metrics::Timer timer(writeStage, archive->size());
+            timer.setItems(archive->count());
+            saved = archive->save();
+            if (saved && !writeLightPlugin(pluginFor(*archive), _name)) {
+                std::wcerr << L"Failed to write " << pluginFor(*archive).filename() << std::endl;
+                saved = false;
+            }
+            if (!saved) {
+                timer.fail();
+            }
+        }
+        MemoryBudget::global().release(MemoryBudget::Phase::Output, held);
+
+        lock.lock();
+        if (!saved) {
+            _failed = true;
+        }
+        _sealed.reset();
+        _hasRoom.notify_all();
+    }
+}
@@ -0,0 +1,185 @@
+#ifndef STO_OUTPUT_H
+#define STO_OUTPUT_H
+
+#include "libs/DirectXTex/DirectXTex.h"
+#include "MeshBSA.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+/*!
+ * \brief Destination for encoded textures. Workers hand over the finished DDS and move on, the sink owns the I/O.
+ * submit() is thread safe.
+ */
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    [[nodiscard]] virtual const char *name() const = 0;
+
+    /*!
+     * \brief Queue a texture for writing, blocks while the sink is over its memory budget
+     * \param path Path relative to the output, e.g. textures\\architecture\\wall.dds
+     * \param dds The encoded file, from SaveToDDSMemory
+     * \param info Contents of the .info.mohidden file written next to the texture once it is complete
+     * \return False if the texture can't be accepted
+     */
+    virtual bool submit(const std::string &path, DirectX::Blob dds, std::string info) = 0;
+
+    /*!
+     * \brief Wait for everything submitted so far to be written
+     * \return False if any write failed
+     */
+    virtual bool flush() = 0;
+
+    /*!
+     * \brief True if textures from a previous run stay in place, so up to date ones can be skipped
+     */
+    [[nodiscard]] virtual bool keepsPreviousOutput() const = 0;
+};
+
+/*!
+ * \brief Writes loose files under a directory from a small pool of I/O threads. Each file is written to a
+ * temporary name and renamed into place, so an interrupted run never leaves a truncated texture behind.
+ */
+class LooseFileSink final : public OutputSink {
+public:
+    /*!
+     * \param threads Number of I/O threads, a couple is enough to keep a disk busy
+     * \param maxQueuedBytes Submitters block once this much data is waiting to be written
+     */
+    LooseFileSink(std::filesystem::path root, size_t threads, size_t maxQueuedBytes);
+    ~LooseFileSink() override;
+
+    LooseFileSink(const LooseFileSink &) = delete;
+    LooseFileSink &operator=(const LooseFileSink &) = delete;
+
+    [[nodiscard]] const char *name() const override {
+        return "loose files";
+    }
+
+    bool submit(const std::string &path, DirectX::Blob dds, std::string info) override;
+    bool flush() override;
+
+    [[nodiscard]] bool keepsPreviousOutput() const override {
+        return true;
+    }
+
+    struct Stats {
+        uint64_t files;
+        uint64_t bytes;
+        uint64_t directoriesCreated;
+        uint64_t stalls; // submits that had to wait for the I/O threads
+    };
+
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    struct Job {
+        std::filesystem::path path;
+        DirectX::Blob dds;
+        std::string info;
+    };
+
+    void run();
+    bool write(const Job &job);
+    bool ensureDirectory(const std::filesystem::path &directory);
+    static bool writeFile(const std::filesystem::path &path, const void *data, size_t size);
+
+    std::filesystem::path _root;
+    size_t _maxQueuedBytes;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _hasWork;
+    std::condition_variable _hasRoom;
+    std::condition_variable _idle;
+    std::deque<Job> _jobs;
+    size_t _queuedBytes = 0;
+    size_t _inFlight = 0;
+    bool _stopping = false;
+    bool _failed = false;
+
+    std::mutex _directoriesMutex;
+    std::unordered_set<std::filesystem::path::string_type> _directories;
+
+    std::atomic<uint64_t> _files{0};
+    std::atomic<uint64_t> _bytes{0};
+    std::atomic<uint64_t> _directoriesCreated{0};
+    std::atomic<uint64_t> _stalls{0};
+
+    std::vector<std::thread> _threads;
+};
+
+/*!
+ * \brief Packs textures into "<name> - Textures.bsa", "<name>2 - Textures.bsa", ... in the output directory.
+ * A new archive is started whenever the next texture would push the current one over maxArchiveSize, and full
+ * archives are written from a background thread while the next one fills up.
+ * The game only loads an archive named after an enabled plugin, so each one is written with an empty light plugin,
+ * "<name>.esl", "<name>2.esl", ... Light plugins don't take one of the 254 full plugin slots.
+ */
+class ArchiveSink final : public OutputSink {
+public:
+    ArchiveSink(struct OptimizerSettings settings, std::string name, size_t maxArchiveSize = MeshBSA::MaxSize);
+    ~ArchiveSink() override;
+
+    ArchiveSink(const ArchiveSink &) = delete;
+    ArchiveSink &operator=(const ArchiveSink &) = delete;
+
+    [[nodiscard]] const char *name() const override {
+        return "archives";
+    }
+
+    /*!
+     * \brief info is dropped, archives are rebuilt from scratch on every run
+     */
+    bool submit(const std::string &path, DirectX::Blob dds, std::string info) override;
+    bool flush() override;
+
+    [[nodiscard]] bool keepsPreviousOutput() const override {
+        return false;
+    }
+
+    struct Stats {
+        uint64_t archives;
+        uint64_t files;
+        uint64_t bytes;
+        uint64_t stalls; // submits that had to wait for an archive to be written
+    };
+
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    void run();
+    std::unique_ptr<MeshBSA> nextArchive();
+    //! \brief The .esl an archive written by nextArchive is loaded by
+    [[nodiscard]] std::filesystem::path pluginFor(const MeshBSA &archive) const;
+
+    struct OptimizerSettings _settings;
+    std::string _name;
+    size_t _maxArchiveSize;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _hasWork;
+    std::condition_variable _hasRoom;
+    std::unique_ptr<MeshBSA> _current; // filling up
+    std::unique_ptr<MeshBSA> _sealed; // full, owned by the writer thread until it is saved
+    size_t _currentBytes = 0; // texture bytes held by each archive, charged to the memory budget
+    size_t _sealedBytes = 0;
+    bool _stopping = false;
+    bool _failed = false;
+
+    Stats _stats{};
+
+    std::thread _thread;
+};
+
+#endif //STO_OUTPUT_H
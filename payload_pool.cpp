@@ -0,0 +1,95 @@
+#include "payload_pool.h"
+
+#include <cstdlib>
+
+namespace {
+    // Each buffer starts with its size class, the caller's data comes after it and stays 16 bytes aligned
+    constexpr size_t HeaderSize = 16;
+
+    // Smaller files are cheap to allocate, and rounding them to a class would waste more than it saves
+    constexpr size_t MinPooledSize = 4 * 1024;
+}
+
+PayloadPool::PayloadPool(size_t maxRetainedBytes)
+        : _maxRetainedBytes(maxRetainedBytes), _hits(Metrics::stage("payload.hit")),
+          _misses(Metrics::stage("payload.miss")), _retainedGauge(Metrics::gauge("payload.retained")) {}
+
+PayloadPool::~PayloadPool() {
+    trim();
+}
+
+PayloadPool &PayloadPool::global() {
+    static PayloadPool instance(size_t(64) << 20u);
+    return instance;
+}
+
+size_t PayloadPool::sizeClass(size_t size) {
+    if (size <= MinPooledSize) {
+        return size;
+    }
+
+    size_t bits = 0;
+    for (size_t v = size - 1; v > 1; v >>= 1u) {
+        ++bits;
+    }
+
+    const size_t step = size_t(1) << (bits - 2);
+    return (size + step - 1) & ~(step - 1);
+}
+
+char *PayloadPool::allocate(size_t size) {
+    const size_t capacity = sizeClass(size);
+
+    if (capacity > MinPooledSize) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _retained.find(capacity);
+        if (it != _retained.end() && !it->second.empty()) {
+            char *block = it->second.back();
+            it->second.pop_back();
+            _retainedBytes -= capacity;
+            _retainedGauge.subtract(capacity);
+            _hits.count(1, capacity);
+            return block + HeaderSize;
+        }
+    }
+
+    auto block = static_cast<char *>(std::malloc(HeaderSize + capacity));
+    if (!block) {
+        return nullptr;
+    }
+    *reinterpret_cast<size_t *>(block) = capacity;
+    _misses.count(1, capacity);
+    return block + HeaderSize;
+}
+
+void PayloadPool::free(char *data) {
+    if (!data) {
+        return;
+    }
+    char *block = data - HeaderSize;
+    const size_t capacity = *reinterpret_cast<size_t *>(block);
+
+    if (capacity > MinPooledSize) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_retainedBytes + capacity <= _maxRetainedBytes) {
+            _retained[capacity].push_back(block);
+            _retainedBytes += capacity;
+            _retainedGauge.add(capacity);
+            return;
+        }
+    }
+
+    std::free(block);
+}
+
+void PayloadPool::trim() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &sized : _retained) {
+        for (char *block : sized.second) {
+            std::free(block);
+        }
+    }
+    _retained.clear();
+    _retainedGauge.subtract(_retainedBytes);
+    _retainedBytes = 0;
+}
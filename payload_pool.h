@@ -0,0 +1,60 @@
+#ifndef STO_PAYLOAD_POOL_H
+#define STO_PAYLOAD_POOL_H
+
+#include "metrics.h"
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/*!
+ * \brief Recycling allocator for the files extracted from archives or read from disk. Meshes and textures are read in
+ * batches of similar sizes, so a buffer freed by a worker is usually the right size for the next batch. Buffers are
+ * rounded up to 4 size classes per power of two and remember their class, so they are freed without their size and
+ * from any thread. Only a little memory is kept, it sits outside the MemoryBudget like the DLL's own buffers.
+ */
+class PayloadPool {
+public:
+    explicit PayloadPool(size_t maxRetainedBytes);
+    ~PayloadPool();
+
+    PayloadPool(const PayloadPool &) = delete;
+    PayloadPool &operator=(const PayloadPool &) = delete;
+
+    //! \brief The pool the extraction loops and the workers share
+    static PayloadPool &global();
+
+    /*!
+     * \brief A buffer of at least size bytes, to be given back with free
+     * \return Null if the memory can't be allocated
+     */
+    char *allocate(size_t size);
+
+    //! \brief Give a buffer from allocate back, null is ignored
+    void free(char *data);
+
+    //! \brief Free every retained buffer
+    void trim();
+
+private:
+    static size_t sizeClass(size_t size);
+
+    std::mutex _mutex;
+    std::map<size_t, std::vector<char *>> _retained;
+    size_t _maxRetainedBytes;
+    size_t _retainedBytes = 0;
+
+    Metrics::Stage &_hits;
+    Metrics::Stage &_misses;
+    Metrics::Gauge &_retainedGauge;
+};
+
+//! \brief Deleter for buffers owned by a std::unique_ptr
+struct PayloadDeleter {
+    void operator()(char *data) const {
+        PayloadPool::global().free(data);
+    }
+};
+
+#endif //STO_PAYLOAD_POOL_H
@@ -0,0 +1,150 @@
+#include "plan.h"
+#include "textures.hpp"
+#include "report_text.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    // Paths are ASCII in practice, anything else is replaced rather than written as broken UTF-8
+    template<typename Char>
+    std::string narrow(const std::basic_string<Char> &text) {
+        std::string result(text.size(), '?');
+        for (size_t i = 0; i < text.size(); i++) {
+            const auto c = static_cast<uint32_t>(text[i]);
+            if (c < 0x80) {
+                result[i] = static_cast<char>(c);
+            }
+        }
+        return result;
+    }
+
+    int64_t savedBytes(const TexturePlan::Entry &entry) {
+        return static_cast<int64_t>(entry.currentBytes) - static_cast<int64_t>(entry.targetBytes);
+    }
+
+    void writeJsonTexture(std::ostream &out, const DirectX::TexMetadata &info, uint64_t bytes) {
+        out << "{\"width\": " << info.width
+            << ", \"height\": " << info.height
+            << ", \"mips\": " << info.mipLevels
+            << ", \"format\": ";
+        writeJsonString(out, TexturesOptimizer::formatName(info.format));
+        out << ", \"bytes\": " << bytes << "}";
+    }
+}
+
+uint64_t TexturePlan::estimateFileSize(const DirectX::TexMetadata &info) {
+    // Magic, DDS_HEADER and DDS_HEADER_DXT10, which BC7 needs
+    uint64_t bytes = 4 + 124 + 20;
+    size_t width = info.width, height = info.height, depth = info.depth;
+    for (size_t mip = 0; mip < info.mipLevels; mip++) {
+        size_t rowPitch = 0, slicePitch = 0;
+        if (FAILED(DirectX::ComputePitch(info.format, width, height, rowPitch, slicePitch))) {
+            return 0;
+        }
+        bytes += static_cast<uint64_t>(slicePitch) * info.arraySize * depth;
+        width = std::max<size_t>(width / 2, 1);
+        height = std::max<size_t>(height / 2, 1);
+        depth = std::max<size_t>(depth / 2, 1);
+    }
+    return bytes;
+}
+
+void TexturePlan::add(Entry entry) {
+    _entries.push_back(std::move(entry));
+}
+
+uint64_t TexturePlan::currentBytes() const {
+    uint64_t total = 0;
+    for (const Entry &entry : _entries) {
+        total += entry.currentBytes;
+    }
+    return total;
+}
+
+uint64_t TexturePlan::targetBytes() const {
+    uint64_t total = 0;
+    for (const Entry &entry : _entries) {
+        total += entry.targetBytes;
+    }
+    return total;
+}
+
+std::vector<const TexturePlan::Entry *> TexturePlan::bySavings() const {
+    std::vector<const Entry *> sorted;
+    sorted.reserve(_entries.size());
+    for (const Entry &entry : _entries) {
+        sorted.push_back(&entry);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Entry *a, const Entry *b) {
+        return savedBytes(*a) > savedBytes(*b);
+    });
+    return sorted;
+}
+
+bool TexturePlan::writeCsv(const std::filesystem::path &path) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to write the plan to " << path << std::endl;
+        return false;
+    }
+
+    out << "path,mesh,currentWidth,currentHeight,currentMips,currentFormat,currentBytes,"
+           "targetWidth,targetHeight,targetMips,targetFormat,targetBytes,savedBytes\n";
+    for (const Entry *entry : bySavings()) {
+        writeCsvField(out, entry->path);
+        out << ',';
+        writeCsvField(out, narrow(entry->mesh));
+        out << ',' << entry->current.width << ',' << entry->current.height << ',' << entry->current.mipLevels
+            << ',' << TexturesOptimizer::formatName(entry->current.format) << ',' << entry->currentBytes
+            << ',' << entry->target.width << ',' << entry->target.height << ',' << entry->target.mipLevels
+            << ',' << TexturesOptimizer::formatName(entry->target.format) << ',' << entry->targetBytes
+            << ',' << savedBytes(*entry) << '\n';
+    }
+
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write the plan to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TexturePlan::writeJson(const std::filesystem::path &path) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to write the plan to " << path << std::endl;
+        return false;
+    }
+
+    const uint64_t current = currentBytes();
+    const uint64_t target = targetBytes();
+    out << "{\n  \"textures\": " << _entries.size()
+        << ",\n  \"currentBytes\": " << current
+        << ",\n  \"targetBytes\": " << target
+        << ",\n  \"savedBytes\": " << static_cast<int64_t>(current) - static_cast<int64_t>(target)
+        << ",\n  \"entries\": [";
+
+    bool first = true;
+    for (const Entry *entry : bySavings()) {
+        out << (first ? "\n" : ",\n") << "    {\"path\": ";
+        writeJsonString(out, entry->path);
+        out << ", \"mesh\": ";
+        writeJsonString(out, narrow(entry->mesh));
+        out << ", \"current\": ";
+        writeJsonTexture(out, entry->current, entry->currentBytes);
+        out << ", \"target\": ";
+        writeJsonTexture(out, entry->target, entry->targetBytes);
+        out << ", \"savedBytes\": " << savedBytes(*entry) << "}";
+        first = false;
+    }
+    out << "\n  ]\n}\n";
+
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write the plan to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef STO_PLAN_H
+#define STO_PLAN_H
+
+#include "libs/DirectXTex/DirectXTex.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief What a run would do to every texture, worked out by --plan from the mesh scan and the DDS headers without
+ * decoding a single pixel. Written as CSV for spreadsheets and as JSON for scripts, largest savings first
+ */
+class TexturePlan {
+public:
+    struct Entry {
+        std::string path;
+        std::wstring mesh; // the mesh showing the texture the largest, which decided its size
+        uint64_t currentBytes; // the DDS file as it is now
+        DirectX::TexMetadata current;
+        DirectX::TexMetadata target;
+        uint64_t targetBytes; // estimated from target, see estimateFileSize
+    };
+
+    /*!
+     * \brief Size of a DDS file holding every image described by info, headers included
+     */
+    static uint64_t estimateFileSize(const DirectX::TexMetadata &info);
+
+    void add(Entry entry);
+
+    [[nodiscard]] size_t size() const {
+        return _entries.size();
+    }
+
+    [[nodiscard]] uint64_t currentBytes() const;
+
+    [[nodiscard]] uint64_t targetBytes() const;
+
+    /*!
+     * \return False if the file can't be written
+     */
+    bool writeCsv(const std::filesystem::path &path) const;
+
+    /*!
+     * \return False if the file can't be written
+     */
+    bool writeJson(const std::filesystem::path &path) const;
+
+private:
+    [[nodiscard]] std::vector<const Entry *> bySavings() const;
+
+    std::vector<Entry> _entries;
+};
+
+#endif //STO_PLAN_H
@@ -2,6 +2,11 @@
 #include <iostream>
 #include <sstream>
 #include "processor.h"
+#include "metrics.h"
+#include "memory_budget.h"
+#include "payload_pool.h"
+#include "texture_sizes.h"
+#include "trace.h"
 
 using namespace std::chrono_literals;
 
@@ -10,6 +15,9 @@ using namespace std::chrono_literals;
 void processor(struct ThreadData data) {
     struct FileLocation input;
     NifFile nif;
+    Metrics::Stage &parseStage = Metrics::stage("nif.parse");
+    Metrics::Stage &sizesStage = Metrics::stage("nif.sizes");
+    Trace::nameThread("processor #" + std::to_string(data.threadNum));
     while (data.running->load() || !data.queue->empty()) {
         if (!data.queue->try_pop(input)) {
             std::this_thread::sleep_for(1ms);
@@ -20,42 +28,43 @@ void processor(struct ThreadData data) {
             std::cout << "NULL??" << std::endl;
             continue;
         }
+        const Trace::Span span("mesh", input.path);
+        // Reserved when the mesh was extracted, given back once it is parsed and freed
+        const MemoryBudget::Reservation held = MemoryBudget::global().adopt(MemoryBudget::Phase::Meshes,
+                                                                            input.buffer.size);
 
         std::string strinput(reinterpret_cast<char*>(input.buffer.data), input.buffer.size);
         std::stringstream ss(strinput);
 
         int error;
-        if ((error = nif.Load(ss))) {
+        {
+            Metrics::Timer timer(parseStage, input.buffer.size);
+            error = nif.Load(ss);
+            if (error) {
+                timer.fail();
+            }
+        }
+        if (error) {
             std::wcerr << "thread #" << data.threadNum << " failed to handle " << input.path << ": " << error << std::endl;
-            delete (char*) input.buffer.data;
+            PayloadPool::global().free((char*) input.buffer.data);
             input.buffer.data = nullptr;
             continue;
         }
 
         // calculate size
-        for (const auto &shape : nif.GetShapes()) {
-            NiShader *shader = nif.GetShader(shape);
-            if (shader) {
-                BoundingSphere sphere = shape->GetBounds();
-                std::vector<std::string> texFiles;
-                for (int i = 0; i < 20; i++) {
-                    std::string texture;
-                    nif.GetTextureSlot(shader, texture, i);
-                    if (!texture.empty()) {
-                        texFiles.push_back(texture);
-                        if (sphere.radius > (*data.sizes)[texture].size) {
-                            struct SizeData sizeData{
-                                sphere.radius,
-                                input.path
-                            };
-                            (*data.sizes)[texture] = sizeData;
-                        }
-                    }
-                }
+        Metrics::Timer sizesTimer(sizesStage);
+        sizesTimer.setItems(nif.GetShapes().size());
+        forEachTextureSize(nif, [&](const std::string &texture, float radius) {
+            if (radius > (*data.sizes)[texture].size) {
+                struct SizeData sizeData{
+                    radius,
+                    input.path
+                };
+                (*data.sizes)[texture] = sizeData;
             }
-        }
+        });
 
-        delete (char*) input.buffer.data;
+        PayloadPool::global().free((char*) input.buffer.data);
         input.buffer.data = nullptr;
     }
 }
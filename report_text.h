@@ -0,0 +1,17 @@
+#ifndef STO_REPORT_TEXT_H
+#define STO_REPORT_TEXT_H
+
+#include <ostream>
+#include <string_view>
+
+/*
+ * Text escaping shared by the CSV and JSON files the analysis modes and the trace write
+ */
+
+//! \brief Write text as one CSV field, quoted only when it holds a comma, quote or line break
+void writeCsvField(std::ostream &out, std::string_view text);
+
+//! \brief Write text as a quoted JSON string. Control characters become spaces, no path or name needs them
+void writeJsonString(std::ostream &out, std::string_view text);
+
+#endif //STO_REPORT_TEXT_H
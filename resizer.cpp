@@ -2,6 +2,12 @@
 #include "resizer.h"
 #include "textures.hpp"
 #include "sha2_512_256.h"
+#include "metrics.h"
+#include "memory_budget.h"
+#include "trace.h"
+
+#include <memory>
+#include <optional>
 
 using namespace std::chrono_literals;
 
@@ -13,48 +19,108 @@ inline bool hasEnding(std::string const &fullString, std::string const &ending)
     }
 }
 
+size_t targetTextureSize(const std::string &path, float meshSize, size_t width) {
+    size_t neededSize = std::max<size_t>(((size_t) meshSize) << 4u, 128);
+
+    // http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
+    neededSize--;
+    neededSize |= neededSize >> 1u;
+    neededSize |= neededSize >> 2u;
+    neededSize |= neededSize >> 4u;
+    neededSize |= neededSize >> 8u;
+    neededSize |= neededSize >> 16u;
+    neededSize |= neededSize >> 32u;
+    neededSize++;
+
+    neededSize = std::min<size_t>(neededSize, width);
+
+    if (hasEnding(path, "_n.dds")) {
+        neededSize >>= 2u;
+    }
+
+    if (neededSize < 128) { // only resize below 128 if the original is such
+        neededSize = std::max<size_t>(neededSize, width);
+    }
+    return neededSize;
+}
+
 void resizer(const struct ResizeData &data) {
+#ifdef _WIN32
+    // WIC (used by the resize filters) needs COM on every worker thread
+    if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED))) {
+        std::cerr << "Failed to initialize COM, textures processing won't work" << std::endl;
+        return;
+    }
+#endif
+
+    const std::unique_ptr<EncoderSession> encoder = data.encoder->createSession();
+    if (!encoder) {
+        std::cerr << "Failed to create a " << data.encoder->name() << " encoder session" << std::endl;
+        return;
+    }
+
+    Metrics::Stage &hashStage = Metrics::stage("hash");
+    Metrics::Stage &cacheHits = Metrics::stage("cache.hit");
+    Metrics::Stage &cacheMisses = Metrics::stage("cache.miss");
+    Metrics::Stage &submitStage = Metrics::stage("write.submit");
+    Metrics::Gauge &poolRetained = Metrics::gauge("pool.retained");
+    MemoryBudget &budget = MemoryBudget::global();
+    Trace::nameThread("resizer");
+
+    // Every texture goes through the same few image sizes, so keep this worker's pixel blobs around between textures
+    DirectX::ScratchImagePool pool(std::min<uint64_t>(uint64_t(1) << 30u, budget.limit() / 4));
+    DirectX::ScratchImagePool::Scope poolScope(pool);
+
+    // The retained blobs count as texture work between textures. The next texture reuses them, so its reservation
+    // takes them over, and they are trimmed when the worker runs dry so they never hold up the other phases.
+    MemoryBudget::Reservation pooled;
+    const auto chargePool = [&] {
+        poolRetained.subtract(pooled.bytes());
+        pooled.release();
+        const uint64_t bytes = pool.GetStats().retainedBytes;
+        budget.charge(MemoryBudget::Phase::TextureWork, bytes);
+        pooled = budget.adopt(MemoryBudget::Phase::TextureWork, bytes);
+        poolRetained.add(bytes);
+    };
+
     struct TextureData texture;
+    std::optional<std::chrono::steady_clock::time_point> idleSince;
     while (data.running->load() || !data.queue->empty()) {
+        chargePool();
         if (!data.queue->try_pop(texture)) {
+            // The queue is refilled within a few milliseconds while there are textures left
+            const auto now = std::chrono::steady_clock::now();
+            if (!idleSince) {
+                idleSince = now;
+            } else if (pooled.bytes() && now - *idleSince > 50ms) {
+                pool.Trim();
+            }
             std::this_thread::sleep_for(1ms);
             continue;
         }
-        auto resource = texture.resource->getData();
+        idleSince.reset();
+        const Trace::Span span("texture", texture.path);
+        // The file is freed and its reservation given back however the texture ends, skipped, failed or written
+        const MemoryBudget::Reservation source = budget.adopt(MemoryBudget::Phase::TextureSources, texture.reserved);
+        const std::unique_ptr<GameResource> owner(texture.resource);
+        const auto freeData = [&](GameData *gameData) { owner->freeData(gameData); };
+        const std::unique_ptr<GameData, decltype(freeData)> resource(owner->getData(), freeData);
+
         auto output = std::filesystem::path(data.output_dir).append(texture.path);
         std::string inputHash;
         std::filesystem::path infoFile = std::filesystem::path(output).concat(".info.mohidden");
 
-        TexturesOptimizer opt;
-        if (!opt.read(texture.path, resource->data, resource->length, TexturesOptimizer::TextureType::DDS)) {
+        // Only the header for now, the texture is decoded once the budget has room for it
+        DirectX::TexMetadata info;
+        if (FAILED(DirectX::GetMetadataFromDDSMemory(resource->data, resource->length, DirectX::DDS_FLAGS_NONE,
+                                                     info))) {
             std::cerr << "Failed to open " << texture.path << std::endl;
             continue;
         }
-        auto info = opt.getInfo();
         size_t previousHeight = info.height, previousWidth = info.width;
-        size_t neededSize = std::max<size_t>(((size_t) texture.resource->size) << 4u, 128);
-
-        // http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
-        neededSize--;
-        neededSize |= neededSize >> 1u;
-        neededSize |= neededSize >> 2u;
-        neededSize |= neededSize >> 4u;
-        neededSize |= neededSize >> 8u;
-        neededSize |= neededSize >> 16u;
-        neededSize |= neededSize >> 32u;
-        neededSize++;
-
-        neededSize = std::min<size_t>(neededSize, previousWidth);
-
-        if (hasEnding(texture.path, "_n.dds")) {
-            neededSize >>= 2u;
-        }
-
-        if (neededSize < 128) { // only resize below 128 if the original is such
-            neededSize = std::max<size_t>(neededSize, previousWidth);
-        }
+        const size_t neededSize = targetTextureSize(texture.path, texture.resource->size, previousWidth);
 
-        if (std::filesystem::exists(infoFile)) {
+        if (data.output->keepsPreviousOutput() && std::filesystem::exists(infoFile)) {
             std::ifstream infoIn(infoFile);
             std::stringstream buf;
             buf << infoIn.rdbuf();
@@ -65,51 +131,85 @@ void resizer(const struct ResizeData &data) {
                 std::string previousHash = fileContents.substr(0, middleIndex);
                 uint32_t previousSize = atoi(fileContents.substr(middleIndex + 1).c_str());
 
-                Chocobo1::SHA2_512_256 sha2;
-                sha2.addData(resource->data, resource->length);
-                inputHash = sha2.toString();
+                {
+                    Metrics::Timer timer(hashStage, resource->length);
+                    Chocobo1::SHA2_512_256 sha2;
+                    sha2.addData(resource->data, resource->length);
+                    inputHash = sha2.toString();
+                }
 
                 if (inputHash == previousHash && previousSize == neededSize) {
+                    cacheHits.count(1, resource->length);
                     continue;
                 }
             }
         }
 
-
-        std::wcout << "Previous height: " << previousHeight << " new height: " << neededSize;
-        std::wcout << " Previous width: " << previousWidth << " new width: " << neededSize << " " << texture.path.c_str() << " from: " << texture.resource->mesh << std::endl;
-        if (!opt.doCPUWork(neededSize, neededSize)) {
-            std::cerr << "Failed to do CPU work for " << texture.path << std::endl;
-            continue;
+        if (data.output->keepsPreviousOutput()) {
+            cacheMisses.count(1, resource->length);
         }
-        if (!opt.doGPUWork(0)) {
-            std::cerr << "Failed to do GPU work for " << texture.path << std::endl;
+
+        const bool streamed = encoder->prefersStreaming() && TexturesOptimizer::canStream(info);
+        const uint64_t retained = pooled.bytes();
+        poolRetained.subtract(retained);
+        pooled.release();
+        const MemoryBudget::Reservation work = budget.reserve(
+                MemoryBudget::Phase::TextureWork,
+                TexturesOptimizer::estimateFootprint(info, neededSize, neededSize, streamed) + retained);
+
+        TexturesOptimizer opt(*encoder);
+        if (!opt.read(texture.path, resource->data, resource->length, TexturesOptimizer::TextureType::DDS)) {
+            std::cerr << "Failed to open " << texture.path << std::endl;
             continue;
         }
 
-        std::filesystem::path outputDirectory = output.parent_path();
-        if (!std::filesystem::exists(outputDirectory)) {
-            std::error_code ec;
-            std::filesystem::create_directories(outputDirectory, ec);
-            if (ec) {
-                std::cerr << "Error creating directories " << outputDirectory << ": " << ec.message() << std::endl;
+        std::wcout << "Previous height: " << previousHeight << " new height: " << neededSize;
+        std::wcout << " Previous width: " << previousWidth << " new width: " << neededSize << " " << texture.path.c_str() << " from: " << texture.resource->mesh << std::endl;
+        if (streamed && opt.canStreamWork(neededSize, neededSize)) {
+            // Everything runs on the CPU, so avoid keeping every stage of the texture around
+            if (!opt.doStreamedWork(neededSize, neededSize)) {
+                std::cerr << "Failed to do streamed work for " << texture.path << std::endl;
+                continue;
+            }
+        } else {
+            if (!opt.doCPUWork(neededSize, neededSize)) {
+                std::cerr << "Failed to do CPU work for " << texture.path << std::endl;
+                continue;
+            }
+            if (!opt.doEncoderWork()) {
+                std::cerr << "Failed to compress " << texture.path << " with " << data.encoder->name() << std::endl;
                 continue;
             }
         }
 
-        if (!opt.saveToFile(output.string())) {
-            std::cerr << "Failed to save " << output << std::endl;
+        DirectX::Blob dds;
+        if (!opt.saveToMemory(dds)) {
+            std::cerr << "Failed to encode " << output << std::endl;
             continue;
         }
 
         if (inputHash.empty()) {
+            Metrics::Timer timer(hashStage, resource->length);
             Chocobo1::SHA2_512_256 sha2;
             sha2.addData(resource->data, resource->length);
             inputHash = sha2.toString();
         }
 
-        std::ofstream outInfo(infoFile);
-        outInfo << inputHash << ":" << resource->length;
-        outInfo.close();
+        // The .info file pairs the source hash with the size it was resized to, which is what the cache check compares
+        // Writing happens on the sink's threads, this only blocks if the sink is too far behind
+        Metrics::Timer submitTimer(submitStage, dds.GetBufferSize());
+        if (!data.output->submit(texture.path, std::move(dds), inputHash + ":" + std::to_string(neededSize))) {
+            submitTimer.fail();
+            std::cerr << "Failed to queue " << output << " for writing" << std::endl;
+            continue;
+        }
     }
+
+    const auto stats = pool.GetStats();
+    Metrics::gauge("pool.allocations").add(stats.allocations);
+    Metrics::gauge("pool.hits").add(stats.hits);
+    Metrics::gauge("pool.discarded").add(stats.discardedBytes);
+
+    poolRetained.subtract(pooled.bytes());
+    pooled.release();
 }
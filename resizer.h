@@ -2,6 +2,8 @@
 #define STO_RESIZER_H
 
 #include "main.h"
+#include "encoder.h"
+#include "output.h"
 
 #include <string>
 #include <concurrent_queue.h>
@@ -9,15 +11,25 @@
 
 struct TextureData {
     std::string path;
-    GameResource *resource;
+    GameResource *resource; // owned by the resizer once queued
+    uint64_t reserved; // bytes of MemoryBudget::Phase::TextureSources held for the file, released by the resizer
 };
 
 struct ResizeData {
     concurrency::concurrent_queue<struct TextureData> *queue;
     std::filesystem::path output_dir;
     std::atomic<bool>* running;
+    EncoderBackend *encoder; // shared, each worker opens its own session
+    OutputSink *output; // shared, written to from the sink's own threads
 };
 
 void resizer(const struct ResizeData& data);
 
+/*!
+ * \brief Width a texture is resized to, shared with --plan so both pick the same size
+ * \param meshSize The largest size a mesh shows the texture at, SizeData::size
+ * \param width The texture's current width
+ */
+size_t targetTextureSize(const std::string &path, float meshSize, size_t width);
+
 #endif //STO_RESIZER_H
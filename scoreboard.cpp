@@ -0,0 +1,304 @@
+#include "scoreboard.h"
+#include "textures.hpp"
+#include "resizer.h"
+#include "metrics.h"
+#include "report_text.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    bool hasEnding(const std::string &fullString, const std::string &ending) {
+        return fullString.length() >= ending.length() &&
+               0 == fullString.compare(fullString.length() - ending.length(), ending.length(), ending);
+    }
+
+}
+
+EncoderScoreboard::Role EncoderScoreboard::roleOf(const std::string &path) {
+    if (hasEnding(path, "_n.dds") || hasEnding(path, "_msn.dds")) {
+        return Role::Normal;
+    }
+    if (hasEnding(path, "_m.dds") || hasEnding(path, "_s.dds") || hasEnding(path, "_sk.dds") ||
+        hasEnding(path, "_p.dds")) {
+        return Role::Mask;
+    }
+    if (hasEnding(path, "_g.dds")) {
+        return Role::Glow;
+    }
+    if (hasEnding(path, "_e.dds")) {
+        return Role::Environment;
+    }
+    return Role::Diffuse;
+}
+
+const char *EncoderScoreboard::roleName(Role role) {
+    switch (role) {
+        case Role::Diffuse: return "diffuse";
+        case Role::Normal: return "normal";
+        case Role::Mask: return "mask";
+        case Role::Glow: return "glow";
+        case Role::Environment: return "environment";
+        default: return "unknown";
+    }
+}
+
+double EncoderScoreboard::psnr(double mse) {
+    if (mse <= 0) {
+        return LosslessDb;
+    }
+    return std::min(10.0 * std::log10(1.0 / mse), LosslessDb);
+}
+
+bool EncoderScoreboard::loadReference(const std::string &path, const char *data, size_t length, float meshSize,
+                                      DirectX::ScratchImage &reference) {
+    DirectX::TexMetadata info;
+    DirectX::ScratchImage source;
+    if (FAILED(DirectX::LoadFromDDSMemory(data, length, DirectX::DDS_FLAGS_NONE, &info, source))) {
+        return false;
+    }
+    const DirectX::Image *top = source.GetImage(0, 0, 0);
+    if (!top) {
+        return false;
+    }
+
+    DirectX::ScratchImage decoded;
+    HRESULT hr;
+    if (DirectX::IsCompressed(info.format)) {
+        hr = DirectX::Decompress(*top, DXGI_FORMAT_R8G8B8A8_UNORM, decoded);
+    } else if (info.format != DXGI_FORMAT_R8G8B8A8_UNORM) {
+        hr = DirectX::Convert(*top, DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT,
+                              DirectX::TEX_THRESHOLD_DEFAULT, decoded);
+    } else {
+        hr = decoded.InitializeFromImage(*top);
+    }
+    if (FAILED(hr)) {
+        return false;
+    }
+
+    const size_t neededSize = targetTextureSize(path, meshSize, info.width);
+    const DirectX::TexMetadata target = TexturesOptimizer::planTarget(info, neededSize, neededSize);
+    if (target.width == info.width && target.height == info.height) {
+        reference = std::move(decoded);
+        return true;
+    }
+    return SUCCEEDED(DirectX::Resize(*decoded.GetImage(0, 0, 0), target.width, target.height,
+                                     DirectX::TEX_FILTER_FANT | DirectX::TEX_FILTER_SEPARATE_ALPHA, reference));
+}
+
+bool EncoderScoreboard::score(const std::string &path, const DirectX::Image &reference, const std::string &encoder,
+                              EncoderSession &session) {
+    // BC1 and BC3 are what most mods ship, BC4 and BC5 suit masks and normal maps, BC7 is what the resizers write.
+    // All are compared on every channel, so the ones BC4 and BC5 drop count against them
+    static const DXGI_FORMAT formats[] = {DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_BC4_UNORM,
+                                          DXGI_FORMAT_BC5_UNORM, DXGI_FORMAT_BC7_UNORM};
+    static const EncoderSession::Quality qualities[] = {EncoderSession::Quality::Fast,
+                                                        EncoderSession::Quality::Default,
+                                                        EncoderSession::Quality::Best};
+
+    DirectX::TexMetadata info{};
+    info.width = reference.width;
+    info.height = reference.height;
+    info.depth = 1;
+    info.arraySize = 1;
+    info.mipLevels = 1;
+    info.format = reference.format;
+    info.dimension = DirectX::TEX_DIMENSION_TEXTURE2D;
+
+    const Role role = roleOf(path);
+    const EncoderSession::Quality previous = session.quality();
+    bool scored = false;
+    for (DXGI_FORMAT format : formats) {
+        for (EncoderSession::Quality quality : qualities) {
+            session.setQuality(quality);
+            const std::string combination = encoder + "." + TexturesOptimizer::formatName(format) + "." +
+                                            EncoderSession::qualityName(quality);
+
+            DirectX::ScratchImage encoded;
+            bool compressed;
+            std::chrono::steady_clock::duration elapsed{};
+            {
+                Metrics::Timer timer(Metrics::stage("score." + combination), reference.slicePitch);
+                const auto start = std::chrono::steady_clock::now();
+                compressed = TexturesOptimizer::encode(session, &reference, 1, info, format, encoded);
+                elapsed = std::chrono::steady_clock::now() - start;
+                if (compressed) {
+                    timer.setBytesOut(encoded.GetPixelsSize());
+                } else {
+                    timer.fail();
+                }
+            }
+
+            float mse = 0;
+            float mseChannels[4] = {};
+            if (!compressed || FAILED(DirectX::ComputeMSE(reference, *encoded.GetImage(0, 0, 0), mse, mseChannels))) {
+                std::cerr << "Failed to score " << combination << " on " << path << std::endl;
+                continue;
+            }
+
+            _results.push_back(Result{path, role, encoder, format, quality, reference.width, reference.height,
+                                      std::chrono::duration<double>(elapsed).count(), encoded.GetPixelsSize(), mse,
+                                      {mseChannels[0], mseChannels[1], mseChannels[2], mseChannels[3]}});
+            scored = true;
+        }
+    }
+    session.setQuality(previous);
+    return scored;
+}
+
+std::vector<EncoderScoreboard::Combination> EncoderScoreboard::combinations(Role role) const {
+    std::vector<Combination> result;
+    for (const Result &item : _results) {
+        if (item.role != role) {
+            continue;
+        }
+        auto combination = std::find_if(result.begin(), result.end(), [&](const Combination &existing) {
+            return existing.encoder == item.encoder && existing.format == item.format &&
+                   existing.quality == item.quality;
+        });
+        if (combination == result.end()) {
+            result.push_back(Combination{item.encoder, item.format, item.quality, 0, 0, 0, 0, {}});
+            combination = result.end() - 1;
+        }
+        combination->samples++;
+        combination->seconds += item.seconds;
+        combination->bytes += item.bytes;
+        combination->psnr += psnr(item.mse);
+        for (size_t channel = 0; channel < 4; channel++) {
+            combination->psnrChannels[channel] += psnr(item.mseChannels[channel]);
+        }
+    }
+
+    for (Combination &combination : result) {
+        combination.psnr /= static_cast<double>(combination.samples);
+        for (double &channel : combination.psnrChannels) {
+            channel /= static_cast<double>(combination.samples);
+        }
+    }
+    return result;
+}
+
+const EncoderScoreboard::Combination *EncoderScoreboard::recommended(const std::vector<Combination> &combinations) {
+    double best = 0;
+    for (const Combination &combination : combinations) {
+        best = std::max(best, combination.psnr);
+    }
+    const Combination *fastest = nullptr;
+    for (const Combination &combination : combinations) {
+        if (combination.psnr >= best - ToleranceDb && (!fastest || combination.seconds < fastest->seconds)) {
+            fastest = &combination;
+        }
+    }
+    return fastest;
+}
+
+void EncoderScoreboard::printSummary() const {
+    for (size_t i = 0; i < static_cast<size_t>(Role::Count); i++) {
+        const auto role = static_cast<Role>(i);
+        const std::vector<Combination> scored = combinations(role);
+        if (scored.empty()) {
+            continue;
+        }
+        const Combination *pick = recommended(scored);
+        std::cout << roleName(role) << ", " << scored.front().samples << " textures:" << std::endl;
+        for (const Combination &combination : scored) {
+            std::cout << "  " << combination.encoder << " " << TexturesOptimizer::formatName(combination.format)
+                      << " " << EncoderSession::qualityName(combination.quality) << ": "
+                      << std::round(combination.psnr * 10) / 10 << " dB, "
+                      << std::round(combination.seconds * 100) / 100 << " s, " << (combination.bytes >> 10u) << " KB"
+                      << (&combination == pick ? " (recommended)" : "") << std::endl;
+        }
+    }
+}
+
+bool EncoderScoreboard::writeCsv(const std::filesystem::path &path) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to write the scoreboard to " << path << std::endl;
+        return false;
+    }
+
+    out << "path,role,encoder,format,quality,width,height,seconds,bytes,mse,psnr,psnrR,psnrG,psnrB,psnrA\n";
+    for (const Result &result : _results) {
+        writeCsvField(out, result.path);
+        out << ',' << roleName(result.role) << ',' << result.encoder
+            << ',' << TexturesOptimizer::formatName(result.format) << ',' << EncoderSession::qualityName(result.quality)
+            << ',' << result.width << ',' << result.height << ',' << result.seconds << ',' << result.bytes
+            << ',' << result.mse << ',' << psnr(result.mse);
+        for (float channel : result.mseChannels) {
+            out << ',' << psnr(channel);
+        }
+        out << '\n';
+    }
+
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write the scoreboard to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool EncoderScoreboard::writeJson(const std::filesystem::path &path) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to write the scoreboard to " << path << std::endl;
+        return false;
+    }
+
+    const auto writeCombination = [&out](const Combination &combination) {
+        out << "{\"encoder\": ";
+        writeJsonString(out, combination.encoder);
+        out << ", \"format\": ";
+        writeJsonString(out, TexturesOptimizer::formatName(combination.format));
+        out << ", \"quality\": ";
+        writeJsonString(out, EncoderSession::qualityName(combination.quality));
+    };
+
+    out << "{\n  \"toleranceDb\": " << ToleranceDb << ",\n  \"roles\": [";
+    bool firstRole = true;
+    for (size_t i = 0; i < static_cast<size_t>(Role::Count); i++) {
+        const auto role = static_cast<Role>(i);
+        const std::vector<Combination> scored = combinations(role);
+        if (scored.empty()) {
+            continue;
+        }
+
+        out << (firstRole ? "\n" : ",\n") << "    {\"role\": ";
+        writeJsonString(out, roleName(role));
+        out << ", \"textures\": " << scored.front().samples << ", \"recommended\": ";
+        if (const Combination *pick = recommended(scored)) {
+            writeCombination(*pick);
+            out << "}";
+        } else {
+            out << "null";
+        }
+        out << ", \"combinations\": [";
+
+        bool first = true;
+        for (const Combination &combination : scored) {
+            out << (first ? "\n" : ",\n") << "      ";
+            writeCombination(combination);
+            out << ", \"samples\": " << combination.samples
+                << ", \"seconds\": " << combination.seconds
+                << ", \"bytes\": " << combination.bytes
+                << ", \"psnr\": " << combination.psnr
+                << ", \"psnrChannels\": [" << combination.psnrChannels[0] << ", " << combination.psnrChannels[1]
+                << ", " << combination.psnrChannels[2] << ", " << combination.psnrChannels[3] << "]}";
+            first = false;
+        }
+        out << "\n    ]}";
+        firstRole = false;
+    }
+    out << "\n  ]\n}\n";
+
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write the scoreboard to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,115 @@
+#ifndef STO_SCOREBOARD_H
+#define STO_SCOREBOARD_H
+
+#include "encoder.h"
+#include "libs/DirectXTex/DirectXTex.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/*!
+ * \brief Quality against speed for every encoder, format and quality setting, measured on a sample of the real
+ * textures by --scoreboard. Each sample is encoded with every combination and compared to the uncompressed image with
+ * DirectX::ComputeMSE. Results are grouped by texture role, since normal maps and diffuse textures don't need the same
+ * encoder
+ */
+class EncoderScoreboard {
+public:
+    enum class Role {
+        Diffuse,
+        Normal, // _n and _msn
+        Mask, // _m, _s, _sk and _p, the specular, environment, skin and parallax masks
+        Glow, // _g
+        Environment, // _e, cubemaps
+        Count
+    };
+
+    //! \brief Combinations within this many dB of a role's best PSNR count as good enough to recommend
+    static constexpr double ToleranceDb = 1.0;
+
+    //! \brief Reported for channels encoded without any loss
+    static constexpr double LosslessDb = 99.0;
+
+    struct Result {
+        std::string path;
+        Role role;
+        std::string encoder;
+        DXGI_FORMAT format;
+        EncoderSession::Quality quality;
+        size_t width;
+        size_t height;
+        double seconds;
+        uint64_t bytes;
+        float mse; // all channels, 0 to 1 values
+        float mseChannels[4]; // RGBA
+    };
+
+    static Role roleOf(const std::string &path);
+
+    static const char *roleName(Role role);
+
+    //! \brief Peak signal to noise ratio of a mean squared error over 0 to 1 values
+    static double psnr(double mse);
+
+    /*!
+     * \brief The top mip of a DDS file as a resizer hands it to the encoder: 8 bits per channel, at the size
+     * targetTextureSize picks for it
+     * \param meshSize SizeData::size of the texture
+     * \return False if the texture can't be read
+     */
+    static bool loadReference(const std::string &path, const char *data, size_t length, float meshSize,
+                              DirectX::ScratchImage &reference);
+
+    /*!
+     * \brief Encode reference with every format and quality on session and score each against it
+     * \param reference One uncompressed R8G8B8A8 image, at the size the resizer would produce
+     * \return False if nothing could be encoded
+     */
+    bool score(const std::string &path, const DirectX::Image &reference, const std::string &encoder,
+               EncoderSession &session);
+
+    [[nodiscard]] size_t size() const {
+        return _results.size();
+    }
+
+    /*!
+     * \brief Print each role's combinations and the recommended one. Recommendations are advice for choosing encoder
+     * settings, the resizers don't read them and keep writing BC7 at the session's quality
+     */
+    void printSummary() const;
+
+    /*!
+     * \brief Every result, one row per texture and combination
+     * \return False if the file can't be written
+     */
+    bool writeCsv(const std::filesystem::path &path) const;
+
+    /*!
+     * \brief Totals per role and combination, with the recommended combination of each role
+     * \return False if the file can't be written
+     */
+    bool writeJson(const std::filesystem::path &path) const;
+
+private:
+    struct Combination {
+        std::string encoder;
+        DXGI_FORMAT format;
+        EncoderSession::Quality quality;
+        size_t samples;
+        double seconds;
+        uint64_t bytes;
+        double psnr; // mean over the samples
+        double psnrChannels[4];
+    };
+
+    [[nodiscard]] std::vector<Combination> combinations(Role role) const;
+
+    //! \brief The fastest combination within ToleranceDb of the best PSNR, null without any
+    static const Combination *recommended(const std::vector<Combination> &combinations);
+
+    std::vector<Result> _results;
+};
+
+#endif //STO_SCOREBOARD_H
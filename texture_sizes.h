@@ -0,0 +1,31 @@
+#ifndef STO_TEXTURE_SIZES_H
+#define STO_TEXTURE_SIZES_H
+
+#include "libs/NIF/NifFile.h"
+
+#include <string>
+
+/*!
+ * \brief Call visit(texture, radius) for every texture slot set on a shape of nif, radius being the shape's bounding
+ * sphere. A texture shared by several shapes is visited once per shape, the callers keep the biggest radius
+ */
+template<typename Visit>
+void forEachTextureSize(NifFile &nif, Visit &&visit) {
+    for (const auto &shape : nif.GetShapes()) {
+        NiShader *shader = nif.GetShader(shape);
+        if (!shader) {
+            continue;
+        }
+        const BoundingSphere sphere = shape->GetBounds();
+        // More than any texture set or effect shader has
+        for (int slot = 0; slot < 20; slot++) {
+            std::string texture;
+            nif.GetTextureSlot(shader, texture, slot);
+            if (!texture.empty()) {
+                visit(texture, sphere.radius);
+            }
+        }
+    }
+}
+
+#endif //STO_TEXTURE_SIZES_H
@@ -3,119 +3,74 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
 
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
+#include <vector>
 #include "textures.hpp"
-
-TexturesOptimizer::TexturesOptimizer() {
-    if (!createDevice(0, _pDevice.GetAddressOf())) {
-        std::cerr << "failed to create device for adapter 0" << std::endl;
+#include "metrics.h"
+
+TexturesOptimizer::TexturesOptimizer(EncoderSession &encoder) : _encoder(&encoder) {}
+
+// Stage names for the run report, the formats this tool writes are spelled out
+std::string TexturesOptimizer::formatName(DXGI_FORMAT format) {
+    switch (format) {
+        case DXGI_FORMAT_BC1_UNORM: return "BC1_UNORM";
+        case DXGI_FORMAT_BC2_UNORM: return "BC2_UNORM";
+        case DXGI_FORMAT_BC3_UNORM: return "BC3_UNORM";
+        case DXGI_FORMAT_BC4_UNORM: return "BC4_UNORM";
+        case DXGI_FORMAT_BC5_UNORM: return "BC5_UNORM";
+        case DXGI_FORMAT_BC6H_UF16: return "BC6H_UF16";
+        case DXGI_FORMAT_BC7_UNORM: return "BC7_UNORM";
+        case DXGI_FORMAT_R8G8B8A8_UNORM: return "R8G8B8A8_UNORM";
+        case DXGI_FORMAT_B8G8R8A8_UNORM: return "B8G8R8A8_UNORM";
+        default: return "format" + std::to_string(static_cast<int>(format));
     }
-
-    // Initialize COM (needed for WIC)
-    const HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-
-    if (FAILED(hr))
-        throw std::runtime_error("Failed to initialize COM. Textures processing won't work.");
 }
 
-bool TexturesOptimizer::getDXGIFactory(IDXGIFactory1 **pFactory) {
-    if (!pFactory)
-        return false;
-
-    *pFactory = nullptr;
-
-    typedef HRESULT(WINAPI *pfn_CreateDXGIFactory1)(REFIID riid, _Out_ void **ppFactory);
-
-    static pfn_CreateDXGIFactory1 sCreateDXGIFactory1 = nullptr;
-
-    if (!sCreateDXGIFactory1) {
-        const HMODULE hModDXGI = LoadLibraryW(L"dxgi.dll");
-        if (!hModDXGI)
-            return false;
-
-        sCreateDXGIFactory1 = reinterpret_cast<pfn_CreateDXGIFactory1>(
-                reinterpret_cast<void *>(GetProcAddress(hModDXGI, "CreateDXGIFactory1")));
-        if (!sCreateDXGIFactory1)
-            return false;
+bool TexturesOptimizer::encoderFormat(DXGI_FORMAT format, EncoderSession::Format &result) {
+    switch (format) {
+        case DXGI_FORMAT_BC1_UNORM: result = EncoderSession::Format::BC1; return true;
+        case DXGI_FORMAT_BC3_UNORM: result = EncoderSession::Format::BC3; return true;
+        case DXGI_FORMAT_BC4_UNORM: result = EncoderSession::Format::BC4; return true;
+        case DXGI_FORMAT_BC5_UNORM: result = EncoderSession::Format::BC5; return true;
+        case DXGI_FORMAT_BC7_UNORM: result = EncoderSession::Format::BC7; return true;
+        default: return false;
     }
-
-    return SUCCEEDED(sCreateDXGIFactory1(IID_PPV_ARGS(pFactory)));
 }
 
-bool TexturesOptimizer::createDevice(const uint32_t adapter, ID3D11Device **pDevice) const {
-    if (!pDevice)
+bool TexturesOptimizer::encode(EncoderSession &session, const DirectX::Image *images, size_t nimages,
+                               const DirectX::TexMetadata &info, DXGI_FORMAT format, DirectX::ScratchImage &result) {
+    EncoderSession::Format encoderFormat;
+    if (!TexturesOptimizer::encoderFormat(format, encoderFormat))
         return false;
 
-    *pDevice = nullptr;
-
-    static PFN_D3D11_CREATE_DEVICE s_DynamicD3D11CreateDevice = nullptr;
-
-    if (!s_DynamicD3D11CreateDevice) {
-        const HMODULE hModD3D11 = LoadLibraryW(L"d3d11.dll");
-        if (!hModD3D11)
-            return false;
-
-        s_DynamicD3D11CreateDevice = reinterpret_cast<PFN_D3D11_CREATE_DEVICE>(
-                reinterpret_cast<void *>(GetProcAddress(hModD3D11, "D3D11CreateDevice")));
-        if (!s_DynamicD3D11CreateDevice)
+    // Sessions take 8-bit RGBA, which is what decompressed BC1-BC3 and BC7 already are
+    DirectX::ScratchImage converted;
+    if (info.format != DXGI_FORMAT_R8G8B8A8_UNORM) {
+        if (FAILED(Convert(images, nimages, info, DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT,
+                           DirectX::TEX_THRESHOLD_DEFAULT, converted)))
             return false;
+        images = converted.GetImages();
+        nimages = converted.GetImageCount();
     }
 
-    D3D_FEATURE_LEVEL featureLevels[] = {
-            D3D_FEATURE_LEVEL_11_0,
-            D3D_FEATURE_LEVEL_10_1,
-            D3D_FEATURE_LEVEL_10_0,
-    };
-
-    const UINT createDeviceFlags = 0;
-
-    Microsoft::WRL::ComPtr<IDXGIAdapter> pAdapter;
-    if (adapter >= 0) {
-        Microsoft::WRL::ComPtr<IDXGIFactory1> dxgiFactory;
-        if (getDXGIFactory(dxgiFactory.GetAddressOf())) {
-            if (FAILED(dxgiFactory->EnumAdapters(adapter, pAdapter.GetAddressOf()))) {
-                return false;
-            }
-        }
-    }
+    DirectX::TexMetadata target = info;
+    target.format = format;
+    if (FAILED(result.Initialize(target)) || result.GetImageCount() != nimages)
+        return false;
 
-    D3D_FEATURE_LEVEL fl;
-    HRESULT hr = s_DynamicD3D11CreateDevice(pAdapter.Get(),
-                                            (pAdapter) ? D3D_DRIVER_TYPE_UNKNOWN : D3D_DRIVER_TYPE_HARDWARE,
-                                            nullptr,
-                                            createDeviceFlags,
-                                            featureLevels,
-                                            _countof(featureLevels),
-                                            D3D11_SDK_VERSION,
-                                            pDevice,
-                                            &fl,
-                                            nullptr);
-    if (SUCCEEDED(hr)) {
-        if (fl < D3D_FEATURE_LEVEL_11_0) {
-            D3D11_FEATURE_DATA_D3D10_X_HARDWARE_OPTIONS hwopts;
-            hr = (*pDevice)->CheckFeatureSupport(D3D11_FEATURE_D3D10_X_HARDWARE_OPTIONS, &hwopts, sizeof(hwopts));
-            if (FAILED(hr))
-                memset(&hwopts, 0, sizeof(hwopts));
-
-            if (!hwopts.ComputeShaders_Plus_RawAndStructuredBuffers_Via_Shader_4_x) {
-                if (*pDevice) {
-                    (*pDevice)->Release();
-                    *pDevice = nullptr;
-                }
-                hr = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-            }
-        }
+    std::vector<EncoderImage> sources(nimages);
+    std::vector<EncodedImage> results(nimages);
+    for (size_t i = 0; i < nimages; ++i) {
+        sources[i] = EncoderImage{images[i].width, images[i].height, images[i].rowPitch, images[i].pixels};
+        results[i] = EncodedImage{result.GetImages()[i].rowPitch, result.GetImages()[i].pixels};
     }
-
-    if (SUCCEEDED(hr)) {
-        Microsoft::WRL::ComPtr<IDXGIDevice> dxgiDevice;
-        hr = (*pDevice)->QueryInterface(IID_PPV_ARGS(dxgiDevice.GetAddressOf()));
-
-        return SUCCEEDED(hr);
+    if (!session.compress(sources.data(), nimages, encoderFormat, results.data())) {
+        result.Release();
+        return false;
     }
-    std::cerr << "Failed to create GPU device: " << std::system_category().message(hr) << std::endl;
-    return false;
+    return true;
 }
 
 TexturesOptimizer::TexOptOptionsResult TexturesOptimizer::processArguments(const std::optional<size_t> &tWidth,
@@ -168,12 +123,138 @@ bool TexturesOptimizer::doCPUWork(const std::optional<size_t> &tWidth,
     return true;
 }
 
-bool TexturesOptimizer::doGPUWork(uint32_t adapter) {
+bool TexturesOptimizer::doEncoderWork() {
     DXGI_FORMAT targetFormat = _info.format;
     if (canBeCompressed()) {
         targetFormat = DXGI_FORMAT_BC7_UNORM;
     }
-    return convert(adapter, targetFormat);
+    return convert(targetFormat);
+}
+
+// Bands of the streamed pass hold about 256x256 pixels, enough for the session to split them across threads
+static size_t streamBandRows(size_t width) {
+    const size_t rows = 256 * 256 / std::max<size_t>(width, 1);
+    return std::max<size_t>((rows + 3) & ~size_t(3), 4);
+}
+
+bool TexturesOptimizer::canStream(const DirectX::TexMetadata &info) {
+    const bool powerOfTwo = info.width != 0 && !(info.width & (info.width - 1))
+                            && info.height != 0 && !(info.height & (info.height - 1));
+    return info.dimension == DirectX::TEX_DIMENSION_TEXTURE2D && info.arraySize == 1 && info.depth == 1
+           && !info.IsCubemap() && powerOfTwo;
+}
+
+size_t TexturesOptimizer::estimateFootprint(const DirectX::TexMetadata &info, size_t tWidth, size_t tHeight,
+                                            bool streamed) {
+    const size_t images = info.arraySize * info.depth;
+    const auto bytes = [](size_t width, size_t height, size_t bitsPerPixel, bool mipmaps) {
+        const size_t base = width * height * bitsPerPixel / 8;
+        return mipmaps ? base + base / 3 : base; // a full chain adds a third
+    };
+
+    const size_t sourceBits = std::max<size_t>(DirectX::BitsPerPixel(info.format), 4);
+    // Block formats decompress to 8 bits per channel, BC6H to half floats, the rest keep their own depth
+    size_t workingBits = std::max<size_t>(sourceBits, 32);
+    if (DirectX::IsCompressed(info.format))
+        workingBits = info.format == DXGI_FORMAT_BC6H_UF16 || info.format == DXGI_FORMAT_BC6H_SF16 ? 64 : 32;
+
+    const size_t source = bytes(info.width, info.height, sourceBits, info.mipLevels > 1) * images;
+    const size_t output = bytes(tWidth, tHeight, 8, true) * images; // BC7
+    if (streamed) {
+        // Only a row of source blocks and a band per level are uncompressed at any time, the bands as floats
+        return source + output + info.width * 4 * workingBits / 8 * 2 + tWidth * streamBandRows(tWidth) * 16 * 2;
+    }
+    // Each step keeps its input until its result is done, so two uncompressed copies are alive at the peak
+    return source + 2 * bytes(info.width, info.height, workingBits, true) * images + output;
+}
+
+size_t TexturesOptimizer::targetMipLevels(const DirectX::TexMetadata &info, size_t width, size_t height) {
+    size_t fullChain = 1;
+    for (size_t w = width, h = height; w > 1 || h > 1; fullChain++) {
+        w = std::max<size_t>(w / 2, 1);
+        h = std::max<size_t>(h / 2, 1);
+    }
+
+    if (width < 4 || height < 4)
+        return fullChain;
+    // Resize keeps the top level only, generateMipMaps then only rebuilds the chain of tiny textures
+    if (width != info.width || height != info.height)
+        return 1;
+    return info.mipLevels;
+}
+
+DirectX::TexMetadata TexturesOptimizer::planTarget(const DirectX::TexMetadata &info, size_t tWidth, size_t tHeight) {
+    DirectX::TexMetadata target = info;
+    // Same halving as processArguments, tHeight is ignored there too
+    while (target.width > tWidth) {
+        target.width /= 2;
+        target.height /= 2;
+    }
+    target.width = std::max<size_t>(target.width, 1);
+    target.height = std::max<size_t>(target.height, 1);
+    target.mipLevels = targetMipLevels(info, target.width, target.height);
+
+    // canBeCompressed is always true, every texture ends up in BC7
+    target.format = DXGI_FORMAT_BC7_UNORM;
+    return target;
+}
+
+bool TexturesOptimizer::canStreamWork(const std::optional<size_t> &tWidth,
+                                      const std::optional<size_t> &tHeight) {
+    if (!canStream(_info) || !canBeCompressed())
+        return false;
+
+    const auto options = processArguments(tWidth, tHeight);
+    return options.tWidth > 0 && options.tHeight > 0;
+}
+
+bool TexturesOptimizer::doStreamedWork(const std::optional<size_t> &tWidth,
+                                       const std::optional<size_t> &tHeight) {
+    const auto options = processArguments(tWidth, tHeight);
+
+    const auto img = _image->GetImage(0, 0, 0);
+    if (!img)
+        return false;
+
+    const DXGI_FORMAT format = DXGI_FORMAT_BC7_UNORM;
+    EncoderSession::Format encoderFormat;
+    if (!TexturesOptimizer::encoderFormat(format, encoderFormat))
+        return false;
+
+    std::unique_ptr<DirectX::ScratchImage> timage(new(std::nothrow) DirectX::ScratchImage);
+    if (!timage) {
+        return false;
+    }
+
+    const size_t levels = targetMipLevels(_info, options.tWidth, options.tHeight);
+    if (FAILED(timage->Initialize2D(format, options.tWidth, options.tHeight, 1, levels)))
+        return false;
+
+    // Resize, mipmaps and compression can't be told apart in the streamed pass, they are one stage
+    Metrics::Timer timer(Metrics::stage("streamed." + formatName(format)), _image->GetPixelsSize());
+    const auto encodeBand = [&](size_t level, size_t y, const DirectX::Image &band) {
+        const DirectX::Image *dest = timage->GetImage(level, 0, 0);
+        const EncoderImage source{band.width, band.height, band.rowPitch, band.pixels};
+        const EncodedImage result{dest->rowPitch, dest->pixels + y / 4 * dest->rowPitch};
+        return _encoder->compress(&source, 1, encoderFormat, &result) ? S_OK : E_FAIL;
+    };
+    const HRESULT hr = StreamMipChain(*img,
+                                      options.tWidth,
+                                      options.tHeight,
+                                      levels,
+                                      DXGI_FORMAT_R8G8B8A8_UNORM,
+                                      streamBandRows(options.tWidth),
+                                      encodeBand);
+    if (FAILED(hr)) {
+        timer.fail();
+        return false;
+    }
+    timer.setBytesOut(timage->GetPixelsSize());
+
+    _info = timage->GetMetadata();
+    _image.swap(timage);
+    modifiedCurrentTexture = true;
+    return true;
 }
 
 bool TexturesOptimizer::canBeCompressed() const {
@@ -239,10 +320,15 @@ bool TexturesOptimizer::read(const std::string& filePath, const char *data, cons
     HRESULT hr = S_FALSE;
     switch (type) {
         case DDS:
+            static Metrics::Stage &decodeStage = Metrics::stage("dds.decode");
+            Metrics::Timer timer(decodeStage, length);
             const DWORD ddsFlags = DirectX::DDS_FLAGS_NONE;
             hr = LoadFromDDSMemory(data, length, ddsFlags, &_info, *_image);
-            if (FAILED(hr))
+            if (FAILED(hr)) {
+                timer.fail();
                 return false;
+            }
+            timer.setBytesOut(_image->GetPixelsSize());
 
             if (DirectX::IsTypeless(_info.format)) {
                 _info.format = DirectX::MakeTypelessUNORM(_info.format);
@@ -261,6 +347,17 @@ bool TexturesOptimizer::read(const std::string& filePath, const char *data, cons
     return false;
 }
 
+// Block rows of large textures are decoded on several threads when OpenMP is available.
+// There's only one resizer thread, so anything past 1k is worth splitting.
+static DWORD decompressFlags(const DirectX::TexMetadata &info) {
+    DWORD flags = DirectX::TEX_COMPRESS_DEFAULT;
+#ifdef _OPENMP
+    if (info.width * info.height >= 1024 * 1024)
+        flags |= DirectX::TEX_COMPRESS_PARALLEL;
+#endif
+    return flags;
+}
+
 bool TexturesOptimizer::decompress() {
     if (!DirectX::IsCompressed(_info.format))
         return false;
@@ -274,10 +371,14 @@ bool TexturesOptimizer::decompress() {
         return false;
     }
 
-    const HRESULT hr = Decompress(img, nimg, _info, DXGI_FORMAT_UNKNOWN /* picks good default */, *timage);
+    static Metrics::Stage &decompressStage = Metrics::stage("decompress");
+    Metrics::Timer timer(decompressStage, _image->GetPixelsSize());
+    const HRESULT hr = Decompress(img, nimg, _info, DXGI_FORMAT_UNKNOWN /* picks good default */, decompressFlags(_info), *timage);
     if (FAILED(hr)) {
+        timer.fail();
         return false;
     }
+    timer.setBytesOut(timage->GetPixelsSize());
 
     const auto &tinfo = timage->GetMetadata();
     _info.format = tinfo.format;
@@ -290,6 +391,14 @@ bool TexturesOptimizer::decompress() {
     return true;
 }
 
+// Few but huge textures would otherwise leave a single thread filtering one image
+static DWORD resizeFilter(const DirectX::TexMetadata &info) {
+    DWORD filter = DirectX::TEX_FILTER_FANT | DirectX::TEX_FILTER_SEPARATE_ALPHA;
+    if (info.width * info.height >= 4096 * 4096)
+        filter |= DirectX::TEX_FILTER_PARALLEL;
+    return filter;
+}
+
 bool TexturesOptimizer::resize(size_t targetWidth, size_t targetHeight) {
     if (_info.width <= targetWidth && _info.height <= targetHeight)
         return true;
@@ -305,11 +414,15 @@ bool TexturesOptimizer::resize(size_t targetWidth, size_t targetHeight) {
     if (!imgs)
         return false;
 
-    const DWORD filter = DirectX::TEX_FILTER_FANT | DirectX::TEX_FILTER_SEPARATE_ALPHA;
+    static Metrics::Stage &resizeStage = Metrics::stage("resize");
+    Metrics::Timer timer(resizeStage, _image->GetPixelsSize());
+    const DWORD filter = resizeFilter(_info);
     const HRESULT hr = Resize(imgs, _image->GetImageCount(), _info, targetWidth, targetHeight, filter, *timage);
     if (FAILED(hr)) {
+        timer.fail();
         return false;
     }
+    timer.setBytesOut(timage->GetPixelsSize());
 
     auto &tinfo = timage->GetMetadata();
 
@@ -372,8 +485,10 @@ bool TexturesOptimizer::generateMipMaps() {
             return false;
         }
 
+        static Metrics::Stage &mipmapsStage = Metrics::stage("mipmaps");
+        Metrics::Timer timer(mipmapsStage, _image->GetPixelsSize());
         //Forcing non wic since WIC won't work on my computer, and thus probably on other computers
-        const DWORD filter = DirectX::TEX_FILTER_FANT | DirectX::TEX_FILTER_SEPARATE_ALPHA;
+        const DWORD filter = resizeFilter(_info);
         const HRESULT hr = GenerateMipMaps(_image->GetImages(),
                                            _image->GetImageCount(),
                                            _image->GetMetadata(),
@@ -381,8 +496,10 @@ bool TexturesOptimizer::generateMipMaps() {
                                            tMips,
                                            *timage);
         if (FAILED(hr)) {
+            timer.fail();
             return false;
         }
+        timer.setBytesOut(timage->GetPixelsSize());
 
         const auto &tinfo = timage->GetMetadata();
         _info.mipLevels = tinfo.mipLevels;
@@ -421,9 +538,9 @@ DirectX::TexMetadata TexturesOptimizer::getInfo() const {
     return _info;
 }
 
-bool TexturesOptimizer::convert(uint32_t adapter, const DXGI_FORMAT &format) {
+bool TexturesOptimizer::convert(const DXGI_FORMAT &format) {
     if (DirectX::IsCompressed(format)) {
-        return convertWithCompression(adapter, format);
+        return convertWithCompression(format);
     }
     return convertWithoutCompression(format);
 }
@@ -435,6 +552,7 @@ bool TexturesOptimizer::convertWithoutCompression(const DXGI_FORMAT &format) {
             return false;
         }
 
+        Metrics::Timer timer(Metrics::stage("convert." + formatName(format)), _image->GetPixelsSize());
         const HRESULT hr = Convert(_image->GetImages(),
                                    _image->GetImageCount(),
                                    _image->GetMetadata(),
@@ -443,8 +561,10 @@ bool TexturesOptimizer::convertWithoutCompression(const DXGI_FORMAT &format) {
                                    DirectX::TEX_THRESHOLD_DEFAULT,
                                    *timage);
         if (FAILED(hr)) {
+            timer.fail();
             return false;
         }
+        timer.setBytesOut(timage->GetPixelsSize());
 
         const auto &tinfo = timage->GetMetadata();
         if (tinfo.format != format)
@@ -460,7 +580,7 @@ bool TexturesOptimizer::convertWithoutCompression(const DXGI_FORMAT &format) {
     return true;
 }
 
-bool TexturesOptimizer::convertWithCompression(uint32_t adapter, const DXGI_FORMAT &format) {
+bool TexturesOptimizer::convertWithCompression(const DXGI_FORMAT &format) {
     if (isCompressed() || _image->GetMetadata().format == format)
         return true;
 
@@ -475,37 +595,12 @@ bool TexturesOptimizer::convertWithCompression(uint32_t adapter, const DXGI_FORM
         return false;
     }
 
-    bool bc6hbc7 = false;
-    if (format == DXGI_FORMAT_BC6H_TYPELESS || format == DXGI_FORMAT_BC6H_UF16 || format == DXGI_FORMAT_BC6H_SF16
-        || format == DXGI_FORMAT_BC7_TYPELESS || format == DXGI_FORMAT_BC7_UNORM
-        || format == DXGI_FORMAT_BC7_UNORM_SRGB) {
-        bc6hbc7 = true;
-    }
-
-    HRESULT hr;
-    if (bc6hbc7 && _pDevice) {
-        hr = Compress(_pDevice.Get(),
-                      img,
-                      nimg,
-                      _info,
-                      format,
-                      DirectX::TEX_COMPRESS_FLAGS::TEX_COMPRESS_BC7_USE_3SUBSETS,
-                      1.f,
-                      *timage);
-    } else {
-        std::cerr << "uh oh, compressing with cpu! has pDevice: " << (_pDevice != nullptr) << std::endl;
-        hr = Compress(img,
-                      nimg,
-                      _info,
-                      format,
-                      DirectX::TEX_COMPRESS_DEFAULT | DirectX::TEX_FILTER_SEPARATE_ALPHA,
-                      DirectX::TEX_THRESHOLD_DEFAULT,
-                      *timage);
-    }
-
-    if (FAILED(hr)) {
+    Metrics::Timer timer(Metrics::stage("encode." + formatName(format)), _image->GetPixelsSize());
+    if (!encode(*_encoder, img, nimg, _info, format, *timage)) {
+        timer.fail();
         return false;
     }
+    timer.setBytesOut(timage->GetPixelsSize());
 
     const auto &tinfo = timage->GetMetadata();
     _info.format = tinfo.format;
@@ -529,6 +624,23 @@ bool TexturesOptimizer::saveToFile(const std::string &filePath) const {
     return SUCCEEDED(hr);
 }
 
+bool TexturesOptimizer::saveToMemory(DirectX::Blob &blob) const {
+    const auto img = _image->GetImage(0, 0, 0);
+    if (!img)
+        return false;
+    const size_t nimg = _image->GetImageCount();
+
+    static Metrics::Stage &saveStage = Metrics::stage("dds.save");
+    Metrics::Timer timer(saveStage, _image->GetPixelsSize());
+    const HRESULT hr = SaveToDDSMemory(img, nimg, _info, DirectX::DDS_FLAGS_NONE, blob);
+    if (FAILED(hr)) {
+        timer.fail();
+        return false;
+    }
+    timer.setBytesOut(blob.GetBufferSize());
+    return true;
+}
+
 void TexturesOptimizer::fitPowerOfTwo(size_t &resultX, size_t &resultY) {
     //Finding nearest power of two
     size_t x = 1;
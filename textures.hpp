@@ -10,14 +10,17 @@
 //#include "pch.h"
 
 #include "libs/DirectXTex/DirectXTex.h"
+#include "encoder.h"
 #include <optional>
-#include <wrl/client.h>
 
 class TexturesOptimizer final
 {
 
 public:
-    TexturesOptimizer();
+    /*!
+   * \brief The encoder session belongs to the calling worker and must outlive the optimizer
+   */
+    explicit TexturesOptimizer(EncoderSession &encoder);
 
     enum TextureType
     {
@@ -28,6 +31,11 @@ public:
 
     bool saveToFile(const std::string &filePath) const;
     /*!
+   * \brief Encode the current texture as a DDS file in memory, to be handed to an OutputSink
+   * \return False if an error happens
+   */
+    bool saveToMemory(DirectX::Blob &blob) const;
+    /*!
    * \brief Decompress the current texture. It is required to use several functions.
    * \return False if an error happens
    */
@@ -37,12 +45,12 @@ public:
    * \param format The format to use
    * \return False in case of error
    */
-    bool convert(uint32_t adapter, const DXGI_FORMAT &format);
+    bool convert(const DXGI_FORMAT &format);
     /*!
-   * \brief Compress the file using the provided compression format,
+   * \brief Compress the file with the encoder session, using the provided compression format
    * \param format The format to use
    */
-    bool convertWithCompression(uint32_t adapter, const DXGI_FORMAT &format);
+    bool convertWithCompression(const DXGI_FORMAT &format);
     bool convertWithoutCompression(const DXGI_FORMAT &format);
     /*!
    * \brief Check if a texture is compressed
@@ -57,7 +65,56 @@ public:
     bool doCPUWork(const std::optional<size_t> &tWidth,
                   const std::optional<size_t> &tHeight);
 
-    bool doGPUWork(uint32_t adapter);
+    /*!
+   * \brief Compress the texture with the encoder session
+   * \return False if an error happens
+   */
+    bool doEncoderWork();
+
+    /*!
+   * \brief Check if the texture can be resized, mipmapped and compressed in one streamed pass
+   * \return True if doStreamedWork can be used instead of doCPUWork and doGPUWork
+   */
+    [[nodiscard]] bool canStreamWork(const std::optional<size_t> &tWidth,
+                                     const std::optional<size_t> &tHeight);
+    /*!
+   * \brief Check from the metadata alone if a texture has the shape doStreamedWork supports
+   */
+    static bool canStream(const DirectX::TexMetadata &info);
+    /*!
+   * \brief Estimate the most memory processing a texture holds at once, from its DDS header alone
+   * \param streamed Whether doStreamedWork will be used, it never holds the uncompressed texture
+   * \return Bytes, not counting the file the texture is read from
+   */
+    static size_t estimateFootprint(const DirectX::TexMetadata &info, size_t tWidth, size_t tHeight, bool streamed);
+    /*!
+   * \brief Work out from the DDS header alone what the texture will look like once processed, for --plan
+   */
+    static DirectX::TexMetadata planTarget(const DirectX::TexMetadata &info, size_t tWidth, size_t tHeight);
+    /*!
+   * \brief Mip levels a texture ends up with once brought to width x height, by every work path
+   */
+    static size_t targetMipLevels(const DirectX::TexMetadata &info, size_t width, size_t height);
+    //! \brief Short name of a format for reports and stage names, such as "BC7_UNORM"
+    static std::string formatName(DXGI_FORMAT format);
+    /*!
+   * \brief The encoder format for a DXGI format
+   * \return False if no encoder session writes it
+   */
+    static bool encoderFormat(DXGI_FORMAT format, EncoderSession::Format &result);
+    /*!
+   * \brief Compress images with an encoder session, converting them to 8-bit RGBA first if needed
+   * \return False if an error happens
+   */
+    static bool encode(EncoderSession &session, const DirectX::Image *images, size_t nimages,
+                       const DirectX::TexMetadata &info, DXGI_FORMAT format, DirectX::ScratchImage &result);
+    /*!
+   * \brief Resize, generate mipmaps and compress in bands with the encoder session, without keeping the uncompressed
+   * texture in memory
+   * \return False if an error happens
+   */
+    bool doStreamedWork(const std::optional<size_t> &tWidth,
+                        const std::optional<size_t> &tHeight);
 
     bool resize(size_t targetWidth, size_t targetHeight);
 
@@ -94,8 +151,5 @@ private:
     std::string _name;
     TextureType _type;
 
-    Microsoft::WRL::ComPtr<ID3D11Device> _pDevice;
-
-    bool createDevice(uint32_t adapter, ID3D11Device **pDevice) const;
-    static bool getDXGIFactory(IDXGIFactory1 **pFactory) ;
+    EncoderSession *_encoder;
 };
@@ -0,0 +1,189 @@
+#include "trace.h"
+#include "report_text.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Trace::_enabled{false};
+
+namespace {
+    struct Event {
+        const char *name;
+        uint64_t start; // nanoseconds since traceStart
+        uint64_t duration;
+        char item[Trace::ItemLength];
+    };
+
+    // Written only by its thread, head is published after the slot so write() never reads a half filled event
+    struct Ring {
+        explicit Ring(size_t capacity, uint32_t tid)
+                : events(new Event[capacity]), capacity(capacity), tid(tid) {}
+
+        std::unique_ptr<Event[]> events;
+        size_t capacity;
+        uint32_t tid;
+        std::atomic<uint64_t> head{0};
+        std::string threadName;
+    };
+
+    const auto traceStart = std::chrono::steady_clock::now();
+    size_t ringCapacity = 0;
+
+    std::mutex ringsMutex;
+    // Owned here rather than by the threads, so the spans of threads that already exited are still written
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    thread_local Ring *threadRing = nullptr;
+
+    Ring &currentRing() {
+        if (!threadRing) {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(std::make_unique<Ring>(ringCapacity, static_cast<uint32_t>(rings.size() + 1)));
+            threadRing = rings.back().get();
+        }
+        return *threadRing;
+    }
+
+    uint64_t sinceStart(std::chrono::steady_clock::time_point time) {
+        if (time <= traceStart) {
+            return 0;
+        }
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - traceStart).count());
+    }
+
+    // Keeps the end of the name, the most specific part of a path
+    template<typename Char>
+    void copyItem(char (&target)[Trace::ItemLength], const Char *item, size_t length) {
+        const size_t kept = std::min(length, Trace::ItemLength - 1);
+        const Char *from = item + (length - kept);
+        for (size_t i = 0; i < kept; i++) {
+            const auto c = static_cast<uint32_t>(from[i]);
+            target[i] = c < 0x80 ? static_cast<char>(c) : '?';
+        }
+        target[kept] = '\0';
+    }
+
+    // Microseconds with the nanoseconds kept, what the trace format expects
+    void writeMicros(std::ostream &out, uint64_t nanos) {
+        out << nanos / 1000 << '.' << std::setw(3) << std::setfill('0') << nanos % 1000;
+    }
+}
+
+Trace::Span::Span(const char *name) : _name(name), _item{}, _active(enabled()) {
+    if (_active) {
+        _start = std::chrono::steady_clock::now();
+    }
+}
+
+Trace::Span::Span(const char *name, const std::string &item) : _name(name), _item{}, _active(enabled()) {
+    if (_active) {
+        copyItem(_item, item.data(), item.size());
+        _start = std::chrono::steady_clock::now();
+    }
+}
+
+Trace::Span::Span(const char *name, const std::wstring &item) : _name(name), _item{}, _active(enabled()) {
+    if (_active) {
+        copyItem(_item, item.data(), item.size());
+        _start = std::chrono::steady_clock::now();
+    }
+}
+
+Trace::Span::~Span() {
+    if (_active) {
+        record(_name, _start, std::chrono::steady_clock::now(), _item);
+    }
+}
+
+void Trace::enable(size_t eventsPerThread) {
+    ringCapacity = std::max<size_t>(eventsPerThread, 1);
+    _enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::nameThread(const std::string &name) {
+    if (!enabled()) {
+        return;
+    }
+    Ring &ring = currentRing();
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    ring.threadName = name;
+}
+
+void Trace::record(const char *name, std::chrono::steady_clock::time_point start,
+                   std::chrono::steady_clock::time_point end, const char *item) {
+    if (!enabled()) {
+        return;
+    }
+    Ring &ring = currentRing();
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+    Event &event = ring.events[head % ring.capacity];
+    event.name = name;
+    event.start = sinceStart(start);
+    event.duration = sinceStart(end) - event.start;
+    if (item) {
+        copyItem(event.item, item, std::strlen(item));
+    } else {
+        event.item[0] = '\0';
+    }
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+bool Trace::write(const std::filesystem::path &path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to write the trace to " << path << std::endl;
+        return false;
+    }
+
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first = true;
+    uint64_t dropped = 0;
+
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    for (const auto &ring : rings) {
+        if (!ring->threadName.empty()) {
+            out << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+                << ring->tid << ", \"args\": {\"name\": ";
+            writeJsonString(out, ring->threadName.c_str());
+            out << "}}";
+            first = false;
+        }
+
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        const uint64_t oldest = head > ring->capacity ? head - ring->capacity : 0;
+        dropped += oldest;
+        for (uint64_t i = oldest; i < head; i++) {
+            const Event &event = ring->events[i % ring->capacity];
+            out << (first ? "\n" : ",\n") << "{\"name\": ";
+            writeJsonString(out, event.name);
+            out << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << ring->tid << ", \"ts\": ";
+            writeMicros(out, event.start);
+            out << ", \"dur\": ";
+            writeMicros(out, event.duration);
+            if (event.item[0]) {
+                out << ", \"args\": {\"item\": ";
+                writeJsonString(out, event.item);
+                out << "}";
+            }
+            out << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write the trace to " << path << std::endl;
+        return false;
+    }
+    if (dropped > 0) {
+        std::cout << "The trace rings wrapped, the oldest " << dropped << " spans were dropped" << std::endl;
+    }
+    return true;
+}
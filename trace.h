@@ -0,0 +1,72 @@
+#ifndef STO_TRACE_H
+#define STO_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+/*!
+ * \brief Optional timeline of what every thread was doing, written as a Chrome Trace Event file that Perfetto and
+ * chrome://tracing open. Each thread records spans into its own fixed ring, without locks, so tracing barely slows the
+ * workers down; once a ring is full its oldest spans are overwritten. Nothing is recorded until enable() is called.
+ */
+class Trace {
+public:
+    //! \brief Item names are cut to their last characters, which for paths is the file name
+    static constexpr size_t ItemLength = 40;
+
+    /*!
+     * \brief Times a scope on the calling thread's timeline, optionally with the file it is working on
+     * \param name Must outlive the trace, a literal or a Metrics stage name
+     */
+    class Span {
+    public:
+        explicit Span(const char *name);
+        Span(const char *name, const std::string &item);
+        Span(const char *name, const std::wstring &item);
+        ~Span();
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+    private:
+        const char *_name;
+        std::chrono::steady_clock::time_point _start;
+        char _item[ItemLength];
+        bool _active;
+    };
+
+    /*!
+     * \brief Start recording, before the worker threads start
+     * \param eventsPerThread Ring size, the most recent spans kept for each thread
+     */
+    static void enable(size_t eventsPerThread = size_t(1) << 15u);
+
+    [[nodiscard]] static bool enabled() {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+
+    //! \brief Label for the calling thread in the timeline, such as "processor #3"
+    static void nameThread(const std::string &name);
+
+    /*!
+     * \brief Record a span that already ended, used by Metrics::Timer so every timed stage is on the timeline
+     * \param name Must outlive the trace
+     */
+    static void record(const char *name, std::chrono::steady_clock::time_point start,
+                       std::chrono::steady_clock::time_point end, const char *item = nullptr);
+
+    /*!
+     * \brief Write every thread's spans, call once the threads being traced are done
+     * \return False if the file can't be written
+     */
+    static bool write(const std::filesystem::path &path);
+
+private:
+    static std::atomic<bool> _enabled;
+};
+
+#endif //STO_TRACE_H